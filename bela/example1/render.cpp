@@ -1,4 +1,5 @@
 #include <Bela.h>
+#include <vector>
 
 #include "Resonator.h"
 
@@ -6,28 +7,30 @@
 
 Resonator res;
 ResonatorOptions options; // will initialise to default
+std::vector<float> block; // a block of excitation, rendered in place
 
 bool setup (BelaContext *context, void *userData) {
 
   res.setup(options, context->audioSampleRate, context->audioFrames);
   res.setParameters(440, 0.1, 0.5); // freq, gain, decay
   res.update(); // update the state of the resonator based on the new parameters
+  block.resize(context->audioFrames);
 
   return true;
 }
 
 void render (BelaContext *context, void *userData) { 
 
-  for (unsigned int n = 0; n < context->audioFrames; ++n) {
-
-    float in = audioRead(context, n, 0); // an excitation signal
-    float out = 0.0f;
+  for (unsigned int n = 0; n < context->audioFrames; ++n)
+    block[n] = audioRead(context, n, 0); // an excitation signal
 
-    out = res.render(in);
+  // the whole block at once, four samples at a time where the processor has
+  // vector instructions; res.render(in) renders a sample at a time
+  res.render(block.data(), block.data(), context->audioFrames);
 
-    audioWrite(context, n, 0, out);
-    audioWrite(context, n, 1, out);
-  
+  for (unsigned int n = 0; n < context->audioFrames; ++n) {
+    audioWrite(context, n, 0, block[n]);
+    audioWrite(context, n, 1, block[n]);
   }
 
 }
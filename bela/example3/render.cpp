@@ -3,47 +3,44 @@
 
 #include "ResonatorBank.h"
 #include "ModelLoader.h"
+#include "ModelLoadService.h"
+#include "ModelWatcher.h"
 
-// Example 3: a bank of resonators based on a model file, updating periodically
+// Example 3: a bank of resonators based on a model file, reloading it whenever it changes
 // This assumes you are e.g. sending updated models via `scp` to "models/tmp.json"
 
-std::vector<ResonatorBank> resBank;
+ResonatorBank resBank;
 ResonatorBankOptions resBankOptions = {};
 ModelLoader model;
+ModelLoadService loader; // loads and prepares models off the audio thread
 
-AuxiliaryTask updateModelTask;
-void updateModel (void*);
-unsigned int updateModelTaskInterval = 1000; // ms
-unsigned int updateModelTaskCounter = 0;
+ModelWatcher watcher; // reloads only once a new file has been completely written
 
 bool setup (BelaContext *context, void *userData) {
 
   model.load("models/marimba.json");
-  resBankOptions.total = model.getSize();
+  resBankOptions.total = resBankOptions.maxSize; // room for larger models later
 
   resBank.setup(resBankOptions, context->audioSampleRate, context->audioFrames);
+  resBank.setSize(model.getSize());
   resBank.setBank(model.getModel()); // pass the model parameters to the resonator bank
   resBank.update(); // update the state of the bank based on the model parameters
 
-  updateModelTaskInterval *= (int)(context->audioSampleRate / 1000); // ms to samples
+  loader.setup(1, context->audioSampleRate, context->audioFrames);
 
-  if ((updateModelTask = Bela_createAuxiliaryTask (&updateModel, 80, "update-model")) == 0) return false;
+  if (!watcher.setup()) return false;
+  watcher.watch("models/tmp.json", [](std::string const &path) {
+    rt_printf ("[ModelWatcher] Updating model...\n");
+    loader.loadAsync(path, 0, ""); // "" keeps the model's own fundamental
+  });
 
   return true;
 }
 
-void updateModel (void*) {
-
-  rt_printf ("[AuxTask] Updating model...\n");
-
-  model.load("models/tmp.json");
-  resBank.setBank(model.getModel());
-  resBank.update();
-
-}
-
 void render (BelaContext *context, void *userData) { 
 
+  loader.apply(0, resBank); // swap in a freshly loaded model, if there is one
+
   for (unsigned int n = 0; n < context->audioFrames; ++n) {
 
     float in = audioRead(context, n, 0); // an excitation signal
@@ -53,14 +50,9 @@ void render (BelaContext *context, void *userData) {
 
     audioWrite(context, n, 0, out);
     audioWrite(context, n, 1, out);
-  
-    if (++updateModelTaskCounter >= updateModelTaskInterval){
-      Bela_scheduleAuxiliaryTask (updateModelTask);
-      updateModelTaskCounter = 0;
-    }
 
   }
 
 }
 
-void cleanup (BelaContext *context, void *userData) { }
+void cleanup (BelaContext *context, void *userData) { watcher.cleanup(); loader.cleanup(); }
@@ -38,11 +38,8 @@ bool setup (BelaContext *context, void *userData) {
 
   }
 
-  audioPerAnalog = context->audioFrames / context->analogFrames;
-
-  updateModelTaskInterval *= (int)(context->audioSampleRate / 1000); // ms to samples
-
-  if ((updateModelTask = Bela_createAuxiliaryTask (&updateModel, 80, "update-model")) == 0) return false;
+  if (context->analogFrames)
+    audioPerAnalog = context->audioFrames / context->analogFrames;
 
   return true;
 }
@@ -52,7 +49,7 @@ void render (BelaContext *context, void *userData) {
   for (unsigned int n = 0; n < context->audioFrames; ++n) {
 
     if (audioPerAnalog && ! (n % audioPerAnalog))
-      for (int i = 0; i < pitches.size(); ++i) piezo[i] = analogRead(context, n, i);
+      for (int i = 0; i < pitches.size(); ++i) piezo[i] = analogRead(context, n / audioPerAnalog, i);
     
     float out = 0.0f;
     for (int i = 0; i < pitches.size(); ++i) out += resBank[i].render(piezo[i]);
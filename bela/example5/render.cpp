@@ -5,6 +5,8 @@
 
 #include "ResonatorBank.h"
 #include "ModelLoader.h"
+#include "ModelLoadService.h"
+#include "ModelWatcher.h"
 
 // Example 5: combination of examples 3 & 4, plus Bela scope for inputs
 
@@ -17,11 +19,9 @@ std::vector<std::string> pitches = {"c4", "d4", "e4", "f4"};
 std::vector<float> piezo;
 
 ModelLoader model;
+ModelLoadService loader; // loads and prepares models off the audio thread
 
-AuxiliaryTask updateModelTask;
-void updateModel (void*);
-unsigned int updateModelTaskInterval = 1000; // ms
-unsigned int updateModelTaskCounter = 0;
+ModelWatcher watcher; // reloads only once a new file has been completely written
 
 int audioPerAnalog;
 
@@ -30,7 +30,7 @@ bool setup (BelaContext *context, void *userData) {
   scope.setup(4, context->audioSampleRate);
 
   model.load("models/marimba.json");
-  resBankOptions.total = model.getSize();
+  resBankOptions.total = resBankOptions.maxSize; // room for larger models later
 
   resBank.reserve(pitches.size());
   piezo.reserve(pitches.size());
@@ -39,6 +39,7 @@ bool setup (BelaContext *context, void *userData) {
 
     ResonatorBank tmpRB;
     tmpRB.setup(resBankOptions, context->audioSampleRate, context->audioFrames);
+    tmpRB.setSize(model.getSize());
     tmpRB.setBank(model.getShiftedToNote(pitches[i]));
     tmpRB.update();
 
@@ -49,34 +50,30 @@ bool setup (BelaContext *context, void *userData) {
 
   }
 
-  audioPerAnalog = context->audioFrames / context->analogFrames;
+  if (context->analogFrames)
+    audioPerAnalog = context->audioFrames / context->analogFrames;
 
-  updateModelTaskInterval *= (int)(context->audioSampleRate / 1000); // ms to samples
+  loader.setup(pitches.size(), context->audioSampleRate, context->audioFrames);
 
-  if ((updateModelTask = Bela_createAuxiliaryTask (&updateModel, 80, "update-model")) == 0) return false;
+  if (!watcher.setup()) return false;
+  watcher.watch("models/tmp.json", [](std::string const &path) {
+    rt_printf ("[ModelWatcher] Updating model...\n");
+    for (int i = 0; i < pitches.size(); ++i)
+      loader.loadAsync(path, i, pitches[i]);
+  });
 
   return true;
 }
 
-void updateModel (void*) {
-
-  rt_printf ("[AuxTask] Updating model...\n");
-
-  model.load("models/tmp.json");
-
-  for (int i = 0; i < pitches.size(); ++i) {
-    resBank[i].setBank(model.getShiftedToNote(pitches[i]));
-    resBank[i].update();
-  }
-
-}
-
 void render (BelaContext *context, void *userData) { 
 
+  for (int i = 0; i < pitches.size(); ++i)
+    loader.apply(i, resBank[i]); // swap in freshly loaded models, if there are any
+
   for (unsigned int n = 0; n < context->audioFrames; ++n) {
 
     if (audioPerAnalog && ! (n % audioPerAnalog)) {
-      for (int i = 0; i < pitches.size(); ++i) piezo[i] = analogRead(context, n, i);
+      for (int i = 0; i < pitches.size(); ++i) piezo[i] = analogRead(context, n / audioPerAnalog, i);
       scope.log (piezo[0], piezo[1], piezo[2], piezo[3]);
     }
     
@@ -85,14 +82,9 @@ void render (BelaContext *context, void *userData) {
 
     audioWrite(context, n, 0, out);
     audioWrite(context, n, 1, out);
-  
-    if (++updateModelTaskCounter >= updateModelTaskInterval){
-      Bela_scheduleAuxiliaryTask (updateModelTask);
-      updateModelTaskCounter = 0;
-    }
 
   }
 
 }
 
-void cleanup (BelaContext *context, void *userData) { }
+void cleanup (BelaContext *context, void *userData) { watcher.cleanup(); loader.cleanup(); }
@@ -12,7 +12,7 @@ std::vector<std::string> modelPaths = {path+"handdrum.json", path+"handdrum.json
 std::vector<std::string> modelPitches = {"c3", "g3"};
 
 bool setup (BelaContext *context, void *userData) {
-  res.setup(modelPaths, modelPitches, context->audioSampleRate, context->audioFrames, true);
+  res.setup(modelPaths, modelPitches, context->audioSampleRate, context->audioFrames);
 
   // try these too:
   // res.setModel(0, path+"metallic.json");
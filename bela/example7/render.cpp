@@ -18,13 +18,17 @@ float inputIdleValue = 0.475; // set this to your sensor idle value after measur
 
 int gAudioFramesPerAnalogFrame = 0;
 
+Scope scope;
+
 bool setup (BelaContext *context, void *userData) {
-  res.setup(modelPaths, modelPitches, context->audioSampleRate, context->audioFrames, true);
+  res.setup(modelPaths, modelPitches, context->audioSampleRate, context->audioFrames);
 
   // try these too:
   // res.setModel(0, path+"metallic.json");
   // res.setPitch(0, "c4");
 
+  scope.setup(4, context->analogSampleRate);
+
   if(context->analogFrames)
     gAudioFramesPerAnalogFrame = context->audioFrames / context->analogFrames;
 
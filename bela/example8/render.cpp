@@ -5,14 +5,24 @@
 #include <libraries/Gui/Gui.h>
 
 #include "Resonators.h"
+#include "ModelLoadService.h"
+#include "ResonatorsOSC.h"
+#include "ResonatorsCoalescer.h"
+#include "ResonatorsTelemetry.h"
 
 #include "JSONUtils.h"
 #include "JSONOnUpdateParsers.h"
+#include "CommandRouter.h"
 
 float input_gain  = 0.5;
 float output_gain = 5.0;
 
 Resonators res;
+ModelLoadService loader; // GUI model updates are parsed off the audio and GUI threads
+ResonatorsCommandQueue commands; // GUI and OSC control changes for the audio thread
+ResonatorsCoalescer coalescer; // merges them so each is applied at most once per block
+ResonatorsTelemetry telemetry; // level meters for the GUI, see BelaResonators.onTelemetry()
+ResonatorsOSC osc; // e.g. `resonators-oscsend 192.168.7.2 7562 /resonators/gain i:0 f:0.5`
 std::string path = "models/";
 std::vector<std::string> modelPaths = {path+"handdrum.json", path+"handdrum.json", path+"handdrum.json", path+"handdrum.json"};
 std::vector<std::string> modelPitches = {"c3", "g3", "a3", "d4"};
@@ -22,23 +32,27 @@ float inputIdleValue = 0.475; // set this to your sensor idle value after measur
 
 int gAudioFramesPerAnalogFrame = 0;
 
+Scope scope;
+
 Gui gui;
 
 // JSON Utils
-JSONUtils           json_u;
 JSONOnUpdateParsers json_p;
+CommandRouter       router; // GUI commands, registered in setup()
 
-void onControl(JSONObject root) {
-  std::wstring cmd;
-  if (json_u.isCmd(root, cmd)) {
-    JSONValue *args = root[L"args"];
-    else if (json_u.isWS(cmd, L"updateModel")) json_p.onUpdateResModel(res, args);
-    else if (json_u.isWS(cmd, L"updatePitch")) json_p.onUpdateResPitch(res, args);
-  }
+void onControl(JSONObject &root) {
+  router.dispatch(root);
 }
 
 bool setup (BelaContext *context, void *userData) {
   res.setup(modelPaths, modelPitches, context->audioSampleRate, context->audioFrames);
+  loader.setup(modelPaths.size(), context->audioSampleRate, context->audioFrames);
+  commands.setup(256);
+  coalescer.setup(res.getTotalBanks());
+
+  json_p.addCommands(router, res, loader, commands);
+  if (!router.finalize()) return false;
+  osc.setup(res, commands, loader);
 
   // try these too:
   // res.setModel(0, path+"metallic.json");
@@ -50,6 +64,11 @@ bool setup (BelaContext *context, void *userData) {
     return true;
   });
 
+  telemetry.setup(res.getTotalBanks(), context->audioSampleRate);
+  telemetry.start([](int id, const float* data, int length) { gui.sendBuffer(id, data, length); });
+
+  scope.setup(4, context->analogSampleRate);
+
   if(context->analogFrames)
     gAudioFramesPerAnalogFrame = context->audioFrames / context->analogFrames;
 
@@ -57,6 +76,8 @@ bool setup (BelaContext *context, void *userData) {
 }
 
 void render (BelaContext *context, void *userData) { 
+  loader.apply(res); // swap in models loaded since the last block
+  coalescer.applyCommands(commands, res);
   for (unsigned int n = 0; n < context->audioFrames; ++n) {
     float out = 0.0;
     if(gAudioFramesPerAnalogFrame && !(n % gAudioFramesPerAnalogFrame)) {
@@ -70,6 +91,7 @@ void render (BelaContext *context, void *userData) {
     audioWrite(context, n, 0, out * output_gain);
     audioWrite(context, n, 1, out * output_gain);
   }
+  telemetry.process(res, context->audioFrames);
 }
 
-void cleanup (BelaContext *context, void *userData){}
+void cleanup (BelaContext *context, void *userData){ telemetry.stop(); osc.cleanup(); loader.cleanup(); }
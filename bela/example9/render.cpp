@@ -0,0 +1,56 @@
+#include <Bela.h>
+#include <vector>
+
+#include "ResonatorBankMIMO.h"
+#include "ModelLoader.h"
+
+// Example 9: one drum model struck in two places and heard from two, in
+// stereo, for the cost of one bank rather than one bank per sensor
+
+ResonatorBankMIMO drum;
+ResonatorBankMIMOOptions drumOptions = {}; // 2 inputs, 2 outputs
+ResonatorBankOptions resBankOptions = {};
+ModelLoader model;
+
+float input_gain  = 0.5;
+float output_gain = 5.0;
+
+std::vector<float> inputs, outputs; // interleaved frames
+
+bool setup (BelaContext *context, void *userData) {
+
+  model.load("models/handdrum.json");
+  resBankOptions.total = model.getSize();
+
+  if (!drum.setup(drumOptions, resBankOptions, context->audioSampleRate, context->audioFrames))
+    return false;
+  drum.getBank().setBank(model.getModel());
+  drum.getBank().update();
+
+  // sensors near the rim and in the middle, pickups either side of centre
+  drum.setInputPosition(0, 0.1);
+  drum.setInputPosition(1, 0.5);
+  drum.setOutputPosition(0, 0.3);
+  drum.setOutputPosition(1, 0.7);
+
+  inputs.resize(context->audioFrames * drum.getInputs());
+  outputs.resize(context->audioFrames * drum.getOutputs());
+
+  return true;
+}
+
+void render (BelaContext *context, void *userData) { 
+
+  for (unsigned int n = 0; n < context->audioFrames; ++n)
+    for (int i = 0; i < drum.getInputs(); ++i)
+      inputs[n * drum.getInputs() + i] = audioRead(context, n, i) * input_gain;
+
+  drum.render(inputs.data(), outputs.data(), context->audioFrames);
+
+  for (unsigned int n = 0; n < context->audioFrames; ++n)
+    for (int o = 0; o < drum.getOutputs(); ++o)
+      audioWrite(context, n, o, outputs[n * drum.getOutputs() + o] * output_gain);
+
+}
+
+void cleanup (BelaContext *context, void *userData) { }
@@ -0,0 +1,138 @@
+/*
+ * Resonators
+ * CommandRouter
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <stdio.h>
+#include <wchar.h>
+
+#include "CommandRouter.h"
+
+bool CommandRouter::add(const wchar_t* name, std::initializer_list<CommandArgSpec> args, CommandHandler handler){
+  if (_finalized)                  return invalid("add", "already finalized", name);
+  if (name == NULL || name[0] == 0) return invalid("add", "empty command name", L"");
+  if (!handler)                    return invalid("add", "no handler", name);
+  if (args.size() > kMaxArgs)      return invalid("add", "too many arguments", name);
+  for (unsigned int i = 0; i < _commands.size(); ++i)
+    if (_commands[i].name == name) return invalid("add", "duplicate command", name);
+
+  Command command;
+  command.name = name;
+  command.handler = handler;
+  for (const CommandArgSpec &arg : args) {
+    if (arg.name == NULL || arg.name[0] == 0)   return invalid("add", "empty argument name", name);
+    if (arg.type < kNumber || arg.type > kObject) return invalid("add", "invalid argument type", name);
+    for (unsigned int i = 0; i < command.args.size(); ++i)
+      if (wcscmp(command.args[i].name, arg.name) == 0) return invalid("add", "duplicate argument", name);
+    command.args.push_back(arg);
+  }
+  _commands.push_back(command);
+  return true;
+}
+
+bool CommandRouter::finalize(){
+  if (!_valid) return fail("finalize", "invalid command set", L"");
+
+  // Find a seed that gives every command its own slot, growing the table if
+  // none does within a reasonable search
+  uint32_t size = 2;
+  while (size < 2 * _commands.size()) size <<= 1;
+  while (true) {
+    for (uint32_t seed = 0; seed < 100000; ++seed) {
+      _table.assign(size, -1);
+      bool collision = false;
+      for (unsigned int i = 0; i < _commands.size() && !collision; ++i) {
+        int &slot = _table[hash(_commands[i].name.c_str(), seed) & (size - 1)];
+        if (slot >= 0) collision = true;
+        else           slot = i;
+      }
+      if (!collision) {
+        _seed = seed;
+        _mask = size - 1;
+        _finalized = true;
+        return true;
+      }
+    }
+    size <<= 1;
+  }
+}
+
+bool CommandRouter::dispatch(JSONObject const &root){
+  if (!_finalized) return fail("dispatch", "not finalized", L"");
+
+  // The messages are small, so scanning beats building keys for map lookups
+  const JSONValue *commandValue = NULL, *argsValue = NULL;
+  for (JSONObject::const_iterator it = root.begin(); it != root.end(); ++it) {
+    if      (it->first == L"command") commandValue = it->second;
+    else if (it->first == L"args")    argsValue = it->second;
+  }
+  if (commandValue == NULL || !commandValue->IsString()) {
+    ++_errors;
+    return fail("dispatch", "no command", L"");
+  }
+  const wchar_t* name = commandValue->AsString().c_str();
+  const Command *command = find(name);
+  if (command == NULL) {
+    ++_errors;
+    return fail("dispatch", "unknown command", name);
+  }
+
+  CommandArgs args;
+  for (int i = 0; i < kMaxArgs; ++i) args._values[i] = NULL;
+  if (argsValue != NULL && argsValue->IsObject()) {
+    const JSONObject &argsObj = argsValue->AsObject();
+    for (JSONObject::const_iterator it = argsObj.begin(); it != argsObj.end(); ++it)
+      for (unsigned int i = 0; i < command->args.size(); ++i)
+        if (wcscmp(command->args[i].name, it->first.c_str()) == 0) args._values[i] = it->second;
+  }
+
+  for (unsigned int i = 0; i < command->args.size(); ++i) {
+    const JSONValue *value = args._values[i];
+    bool ok;
+    switch (command->args[i].type) {
+      case kNumber: ok = value && value->IsNumber(); break;
+      case kString: ok = value && value->IsString(); break;
+      case kBool:   ok = value && value->IsBool();   break;
+      case kArray:  ok = value && value->IsArray();  break;
+      default:      ok = value && value->IsObject(); break;
+    }
+    if (!ok && value == NULL && command->args[i].optional) continue;
+    if (!ok) {
+      ++_errors;
+      return fail("dispatch", "missing or mistyped argument", command->args[i].name);
+    }
+  }
+
+  command->handler(args);
+  return true;
+}
+
+// private methods
+uint32_t CommandRouter::hash(const wchar_t* name, uint32_t seed){
+  uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u); // FNV-1a, seeded
+  for (; *name; ++name) {
+    h ^= (uint32_t) *name;
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+const CommandRouter::Command* CommandRouter::find(const wchar_t* name){
+  int slot = _table[hash(name, _seed) & _mask];
+  if (slot < 0 || _commands[slot].name != name) return NULL;
+  return &_commands[slot];
+}
+
+bool CommandRouter::invalid(const char* method, const char* error, const wchar_t* name){
+  _valid = false; // one bad registration invalidates the whole command set
+  return fail(method, error, name);
+}
+
+bool CommandRouter::fail(const char* method, const char* error, const wchar_t* name){
+  if (_v) printf("[CommandRouter] %s() Error: %s \'%ls\'\n", method, error, name);
+  return false;
+}
@@ -0,0 +1,104 @@
+/*
+ * Resonators
+ * CommandRouter
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef CommandRouter_H_
+#define CommandRouter_H_
+
+#include <stdint.h>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include <JSON.h>
+
+// Dispatches GUI control messages of the form {command: name, args: {...}}
+// (see JSONUtils.h) to handlers registered with their argument names and
+// types. Commands are looked up through a perfect hash built by finalize(),
+// and arguments are checked and handed over by pointer, so dispatching does
+// not copy or allocate. Mistakes in the command set are reported by add() and
+// finalize() rather than when a message arrives.
+//
+//   router.add(L"updatePitch", {{L"index", CommandRouter::kNumber, false}, {L"pitch", CommandRouter::kString, false}},
+//     [](CommandArgs const &args) { res.setPitch(args.getInt(0), args.getString(1)); });
+//   router.finalize();
+//   router.dispatch(root); // from the GUI control callback
+
+class CommandArgs;
+typedef std::function<void(CommandArgs const &args)> CommandHandler;
+
+class CommandRouter {
+public:
+    enum ArgType {
+        kNumber,
+        kString,
+        kBool,
+        kArray,
+        kObject
+    };
+
+    typedef struct _CommandArgSpec {
+        const wchar_t* name; // must outlive the router, e.g. a literal
+        ArgType type;
+        bool optional;
+    } CommandArgSpec;
+
+    static const int kMaxArgs = 8;
+
+    CommandRouter(){}
+    ~CommandRouter(){}
+
+    bool add(const wchar_t* name, std::initializer_list<CommandArgSpec> args, CommandHandler handler);
+    bool finalize(); // false if any add() failed
+    bool dispatch(JSONObject const &root);
+
+    unsigned int getErrors() { return _errors; }
+    void setVerbose(bool v) { _v = v; }
+
+private:
+    struct Command {
+        std::wstring name;
+        std::vector<CommandArgSpec> args;
+        CommandHandler handler;
+    };
+
+    std::vector<Command> _commands;
+    std::vector<int> _table; // hash slot -> command, or -1
+    uint32_t _seed = 0;
+    uint32_t _mask = 0;
+    bool _finalized = false;
+    bool _valid = true;
+    bool _v = true; // verbose printing
+    unsigned int _errors = 0;
+
+    static uint32_t hash(const wchar_t* name, uint32_t seed);
+    const Command* find(const wchar_t* name);
+    bool invalid(const char* method, const char* error, const wchar_t* name);
+    bool fail(const char* method, const char* error, const wchar_t* name);
+
+};
+
+// The arguments of one message, in the order they were registered. Only
+// optional arguments can be missing; all others have been type checked.
+class CommandArgs {
+public:
+    bool has(int i) const { return _values[i] != NULL; }
+    double getNumber(int i) const { return _values[i]->AsNumber(); }
+    int getInt(int i) const { return (int) _values[i]->AsNumber(); }
+    bool getBool(int i) const { return _values[i]->AsBool(); }
+    const std::wstring& getString(int i) const { return _values[i]->AsString(); }
+    const JSONArray& getArray(int i) const { return _values[i]->AsArray(); }
+    const JSONObject& getObject(int i) const { return _values[i]->AsObject(); }
+    JSONValue* getValue(int i) const { return _values[i]; }
+
+private:
+    friend class CommandRouter;
+    JSONValue* _values[CommandRouter::kMaxArgs];
+};
+
+#endif /* CommandRouter_H_ */
@@ -0,0 +1,120 @@
+/*
+ * Resonators
+ * FFT
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <stdio.h>
+#include <cmath>
+
+#include "FFT.h"
+
+FFT::FFT(){}
+FFT::~FFT(){}
+
+bool FFT::setup(int size){
+  if (size < 4 || (size & (size - 1)) != 0) {
+    printf("[FFT] setup() Error: size %d is not a power of two of at least 4\n", size);
+    return false;
+  }
+  _size = size;
+  _half = size / 2;
+
+  int bits = 0;
+  while ((1 << bits) < _half) ++bits;
+  _bitReverse.resize(_half);
+  for (int i = 0; i < _half; ++i) {
+    int r = 0;
+    for (int b = 0; b < bits; ++b) if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+    _bitReverse[i] = r;
+  }
+
+  _cos.resize(_half / 2 + 1);
+  _sin.resize(_half / 2 + 1);
+  for (int i = 0; i <= _half / 2; ++i) {
+    _cos[i] = cos(2.0 * M_PI * i / _half);
+    _sin[i] = -sin(2.0 * M_PI * i / _half);
+  }
+  _cosReal.resize(_half);
+  _sinReal.resize(_half);
+  for (int k = 0; k < _half; ++k) {
+    _cosReal[k] = cos(2.0 * M_PI * k / _size);
+    _sinReal[k] = -sin(2.0 * M_PI * k / _size);
+  }
+  _re.resize(_half);
+  _im.resize(_half);
+  return true;
+}
+
+void FFT::forward(const float* input, float* re, float* im){
+  // Pack even samples as real and odd samples as imaginary parts
+  for (int n = 0; n < _half; ++n) {
+    _re[_bitReverse[n]] = input[2 * n];
+    _im[_bitReverse[n]] = input[2 * n + 1];
+  }
+  transform(_re.data(), _im.data(), false);
+
+  // Split into the spectra of the even and odd samples and combine them:
+  // X[k] = E[k] + W^k O[k], W = e^(-2 pi i / N)
+  for (int k = 0; k <= _half; ++k) {
+    int a = (k == _half) ? 0 : k;
+    int b = (k == 0) ? 0 : _half - k;
+    float zr = _re[a], zi = _im[a];
+    float cr = _re[b], ci = -_im[b]; // conj(Z[N/2 - k])
+    float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+    float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+    float orr = di, oi = -dr; // O = (Z - conj(Z')) / 2i
+    float wr = (k == _half) ? -1.0f : _cosReal[k];
+    float wi = (k == _half) ?  0.0f : _sinReal[k];
+    re[k] = er + wr * orr - wi * oi;
+    im[k] = ei + wr * oi + wi * orr;
+  }
+}
+
+void FFT::inverse(const float* re, const float* im, float* output){
+  // E[k] = (X[k] + conj(X[N/2 - k])) / 2, O[k] = (X[k] - conj(X[N/2 - k])) / 2 W^-k,
+  // Z[k] = E[k] + i O[k]
+  for (int k = 0; k < _half; ++k) {
+    float xr = re[k], xi = im[k];
+    float cr = re[_half - k], ci = -im[_half - k];
+    float er = 0.5f * (xr + cr), ei = 0.5f * (xi + ci);
+    float dr = 0.5f * (xr - cr), di = 0.5f * (xi - ci);
+    float wr = _cosReal[k], wi = -_sinReal[k]; // W^-k
+    float orr = dr * wr - di * wi, oi = dr * wi + di * wr;
+    _re[_bitReverse[k]] = er - oi;
+    _im[_bitReverse[k]] = ei + orr;
+  }
+  transform(_re.data(), _im.data(), true);
+
+  float scale = 1.0f / _half;
+  for (int n = 0; n < _half; ++n) {
+    output[2 * n]     = _re[n] * scale;
+    output[2 * n + 1] = _im[n] * scale;
+  }
+}
+
+// private methods
+
+// Iterative radix-2 decimation in time, on bit-reversed input
+void FFT::transform(float* re, float* im, bool inverse){
+  float sign = inverse ? -1.0f : 1.0f;
+  for (int length = 2; length <= _half; length <<= 1) {
+    int step = _half / length;
+    int span = length / 2;
+    for (int start = 0; start < _half; start += length) {
+      for (int j = 0; j < span; ++j) {
+        float wr = _cos[j * step], wi = sign * _sin[j * step];
+        int a = start + j, b = a + span;
+        float tr = re[b] * wr - im[b] * wi;
+        float ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
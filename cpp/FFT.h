@@ -0,0 +1,45 @@
+/*
+ * Resonators
+ * FFT
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <vector>
+
+// Real FFT of a power-of-two size N, computed as a complex FFT of size N/2.
+// Spectra are N/2 + 1 bins with real and imaginary parts in separate arrays,
+// so that multiplying spectra is a plain loop over floats. Tables are built by
+// setup(); forward() and inverse() do not allocate. inverse() is scaled, so
+// inverse(forward(x)) == x.
+
+class FFT {
+public:
+    FFT();
+    ~FFT();
+
+    bool setup(int size);
+    int getSize() { return _size; }
+    int getBins() { return _size / 2 + 1; }
+
+    void forward(const float* input, float* re, float* im);
+    void inverse(const float* re, const float* im, float* output);
+
+private:
+    int _size = 0;
+    int _half = 0;
+    std::vector<int> _bitReverse; // _half entries
+    std::vector<float> _cos, _sin; // complex FFT twiddles, _half / 2 entries
+    std::vector<float> _cosReal, _sinReal; // real split twiddles, _half entries
+    std::vector<float> _re, _im; // complex work buffers
+
+    void transform(float* re, float* im, bool inverse);
+
+};
+
+#endif /* FFT_H_ */
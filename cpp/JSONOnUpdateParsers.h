@@ -1,11 +1,38 @@
 #include <iostream>
 
+#include "CommandRouter.h"
+
 class JSONOnUpdateParsers
 {
 public:
   JSONOnUpdateParsers(){}
   ~JSONOnUpdateParsers(){}
 
+  // Take each bank's pitch from `_res` before its audio thread starts; the
+  // queued handlers keep their own copy from then on, as ResonatorsOSC does,
+  // rather than read the one the audio thread writes
+  void setup(Resonators &_res) {
+    pitches.resize(_res.getTotalBanks());
+    for (int i = 0; i < _res.getTotalBanks(); ++i) pitches[i] = _res.getPitch(i);
+  }
+
+  // Register the handlers below with a CommandRouter, with pitch and resonator
+  // changes queued for the audio thread and models loaded by `_loader`.
+  // Calls setup().
+  void addCommands(CommandRouter &_router, Resonators &_res, ModelLoadService &_loader, ResonatorsCommandQueue &_queue) {
+    setup(_res);
+    _router.add(L"updateModel", {{L"index", CommandRouter::kNumber, false}, {L"model", CommandRouter::kObject, false}},
+      [this, &_loader](CommandArgs const &args) { loadModel(_loader, args.getInt(0), args.getValue(1)); });
+    _router.add(L"updatePitch", {{L"index", CommandRouter::kNumber, false}, {L"pitch", CommandRouter::kString, false}},
+      [this, &_queue](CommandArgs const &args) { pushPitch(_queue, args.getInt(0), args.getString(1)); });
+    _router.add(L"updateResonators", {{L"index", CommandRouter::kNumber, false}, {L"resonators", CommandRouter::kArray, false}},
+      [this, &_queue](CommandArgs const &args) {
+        if (!isBank(args.getInt(0))) return;
+        parseDeltas(args.getArray(1));
+        pushDeltas(_queue, args.getInt(0));
+      });
+  }
+
   // Resonators
   void onUpdateResModel(Resonators &_res, JSONValue *args) {
     JSONObject argsObj = args->AsObject();
@@ -14,23 +41,94 @@ public:
     _res.setModel(index, model);
   }
 
+  // Parses and prepares the model on the loader's thread instead of this one,
+  // at the pitch last queued for the bank (call setup() first)
+  void onUpdateResModel(ModelLoadService &_loader, JSONValue *args) {
+    JSONObject argsObj = args->AsObject();
+    loadModel(_loader, (int) argsObj[L"index"]->AsNumber(), args->Child(L"model"));
+  }
+
   void onUpdateResPitch(Resonators &_res, JSONValue *args) {
     JSONObject argsObj = args->AsObject();
     int index = (int) argsObj[L"index"]->AsNumber();
-    std::wstring wspitch = args->Child(L"pitch")->AsString();
-    std::string pitch (wspitch.begin(), wspitch.end());
-    _res.setPitch(index, pitch);
+    _res.setPitch(index, ModelLoader::encodeUTF8(args->Child(L"pitch")->AsString()));
   }
 
+  // Changes to individual resonators, only sending the fields that changed:
+  // {index: bank, resonators: [{index: 3, gain: 0.2}, {index: 7, freq: 440, decay: 0.5}]}
   void onUpdateResResonators(Resonators &_res, JSONValue *args) {
-    // JSONObject argsObj = args->AsObject();
-    // int bankIndex = (int) argsObj[L"bankIndex"]->AsNumber();
-    // int resIndexes[] = (int) argsObj[L"resIndexes"]->AsArray();
-    // JSONValue *params = args->Child(L"params");
-    // _res.setResonators(bankIndex, resIndexes, params);
+    JSONObject argsObj = args->AsObject();
+    parseDeltas(args->Child(L"resonators")->AsArray());
+    _res.setResonators((int) argsObj[L"index"]->AsNumber(), deltas.data(), deltas.size());
+  }
+
+  // As above, queued for the audio thread (e.g. through ResonatorsCoalescer)
+  void onUpdateResResonators(ResonatorsCommandQueue &_queue, JSONValue *args) {
+    JSONObject argsObj = args->AsObject();
+    int index = (int) argsObj[L"index"]->AsNumber();
+    if (!isBank(index)) return;
+    parseDeltas(args->Child(L"resonators")->AsArray());
+    pushDeltas(_queue, index);
+  }
+
+  void onUpdateResPitch(ResonatorsCommandQueue &_queue, JSONValue *args) {
+    JSONObject argsObj = args->AsObject();
+    pushPitch(_queue, (int) argsObj[L"index"]->AsNumber(), args->Child(L"pitch")->AsString());
   }
 
 private:
   JSONUtils json_u;
+  std::vector<ResonatorParamDelta> deltas; // reused between updates
+  std::vector<std::string> pitches; // per bank, as last queued from here
+
+  bool isBank(int index) { return index >= 0 && index < (int) pitches.size(); }
+
+  void loadModel(ModelLoadService &_loader, int index, JSONValue *model) {
+    if (!isBank(index) || model == NULL) return;
+    _loader.loadJSONAsync(ModelLoader::encodeUTF8(model->Stringify()), index, pitches[index]);
+  }
+
+  // Fills `deltas` from the resonators of an updateResonators message,
+  // comparing keys in place rather than building them for map lookups
+  void parseDeltas(JSONArray const &resArray) {
+    deltas.clear();
+    for (unsigned int i = 0; i < resArray.size(); ++i) {
+      if (!resArray[i]->IsObject()) continue;
+      JSONObject const &resObj = resArray[i]->AsObject();
+      ResonatorParamDelta delta = {};
+      delta.index = -1;
+      for (JSONObject::const_iterator it = resObj.begin(); it != resObj.end(); ++it) {
+        if (!it->second->IsNumber()) continue;
+        float value = it->second->AsNumber();
+        if      (it->first == L"index") delta.index = (int) value;
+        else if (it->first == L"freq")  { delta.mask |= 1 << Resonator::kFreq;  delta.params.freq  = value; }
+        else if (it->first == L"gain")  { delta.mask |= 1 << Resonator::kGain;  delta.params.gain  = value; }
+        else if (it->first == L"decay") { delta.mask |= 1 << Resonator::kDecay; delta.params.decay = value; }
+      }
+      if (delta.index >= 0) deltas.push_back(delta);
+    }
+  }
+
+  void pushDeltas(ResonatorsCommandQueue &_queue, int bank) {
+    ResonatorsCommand cmd = {};
+    cmd.type = ResonatorsCommand::kResonators;
+    cmd.bank = bank;
+    for (unsigned int i = 0; i < deltas.size(); i += ResonatorsCommand::kMaxDeltas) {
+      cmd.length = 0;
+      for (unsigned int j = i; j < deltas.size() && cmd.length < ResonatorsCommand::kMaxDeltas; ++j)
+        cmd.deltas[cmd.length++] = deltas[j];
+      _queue.push(cmd);
+    }
+  }
+
+  void pushPitch(ResonatorsCommandQueue &_queue, int bank, std::wstring const &wspitch) {
+    std::string pitch = ModelLoader::encodeUTF8(wspitch);
+    if (!isBank(bank) || pitch.size() >= ResonatorsCommand::kMaxPitch) return;
+    ResonatorsCommand cmd = {};
+    cmd.type = ResonatorsCommand::kPitch;
+    cmd.bank = bank;
+    memcpy(cmd.pitch, pitch.data(), pitch.size());
+    if (_queue.push(cmd)) pitches[bank] = pitch;
+  }
   
 };
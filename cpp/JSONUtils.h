@@ -16,6 +16,10 @@ void onControl(JSONObject root) {
 }
 ```
 
+For more than a few commands, prefer registering typed handlers with a
+`CommandRouter` (CommandRouter.h), which looks commands up by perfect hash and
+validates their arguments without copying.
+
 JSON of the following format is assumed:
 
 ```js
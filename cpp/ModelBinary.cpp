@@ -0,0 +1,206 @@
+/*
+ * Model:
+ * ModelBinary
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ModelBinary.h"
+#include "ResonatorBank.h"
+
+ModelBinary::ModelBinary(){ _name[0] = '\0'; }
+ModelBinary::~ModelBinary(){ close(); }
+
+bool ModelBinary::open(std::string const &path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    printf("[ModelBinary] open() Error: could not open \'%s\'\n", path.c_str());
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ModelBinaryHeader)) {
+    printf("[ModelBinary] open() Error: \'%s\' is too small to be a model\n", path.c_str());
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping keeps its own reference
+  if (map == MAP_FAILED) {
+    printf("[ModelBinary] open() Error: could not map \'%s\'\n", path.c_str());
+    return false;
+  }
+
+  if (!open(map, st.st_size)) {
+    munmap(map, st.st_size);
+    return false;
+  }
+  _map = map;
+  _mapSize = st.st_size;
+  return true;
+}
+
+bool ModelBinary::open(const void* data, size_t size) {
+  if (_map != NULL) close();
+  _header = NULL;
+
+  const ModelBinaryHeader* header = (const ModelBinaryHeader*) data;
+  const uint8_t* bytes = (const uint8_t*) data;
+
+  if (size < sizeof(ModelBinaryHeader) || memcmp(header->magic, kModelBinaryMagic, 4) != 0) {
+    printf("[ModelBinary] open() Error: not a binary model\n");
+    return false;
+  }
+  if (header->endian != kModelBinaryEndian) {
+    printf("[ModelBinary] open() Error: byte order does not match this machine\n");
+    return false;
+  }
+  if (header->version != kModelBinaryVersion || header->headerSize != sizeof(ModelBinaryHeader)) {
+    printf("[ModelBinary] open() Error: unsupported version %d\n", header->version);
+    return false;
+  }
+  uint64_t expected = align((uint64_t) header->resonators * sizeof(ResonatorParams))
+                    + header->coefficientSets * coefficientSetSize(header->resonators);
+  if (header->payloadSize != expected || size - sizeof(ModelBinaryHeader) < expected) {
+    printf("[ModelBinary] open() Error: truncated model\n");
+    return false;
+  }
+  if (crc32(bytes + sizeof(ModelBinaryHeader), header->payloadSize) != header->checksum) {
+    printf("[ModelBinary] open() Error: checksum mismatch\n");
+    return false;
+  }
+
+  _header       = header;
+  _params       = (const ResonatorParams*) (bytes + sizeof(ModelBinaryHeader));
+  _coefficients = bytes + sizeof(ModelBinaryHeader) + align(header->resonators * sizeof(ResonatorParams));
+  memcpy(_name, header->name, sizeof(header->name));
+  _name[sizeof(header->name)] = '\0';
+  return true;
+}
+
+void ModelBinary::close() {
+  if (_map != NULL) munmap(_map, _mapSize);
+  _map = NULL;
+  _mapSize = 0;
+  _header = NULL;
+  _params = NULL;
+  _coefficients = NULL;
+  _name[0] = '\0';
+}
+
+const ResonatorCoefficients* ModelBinary::getCoefficients(float sampleRate) {
+  if (_header == NULL) return NULL;
+  size_t setSize = coefficientSetSize(_header->resonators);
+  for (uint32_t i = 0; i < _header->coefficientSets; ++i) {
+    const ModelBinaryCoefficientsHeader* set = (const ModelBinaryCoefficientsHeader*) (_coefficients + i * setSize);
+    if (set->sampleRate == sampleRate)
+      return (const ResonatorCoefficients*) (set + 1);
+  }
+  return NULL;
+}
+
+float ModelBinary::getCoefficientsSampleRate(int set) {
+  if (_header == NULL || set < 0 || set >= (int) _header->coefficientSets) return 0.0f;
+  const ModelBinaryCoefficientsHeader* header = (const ModelBinaryCoefficientsHeader*) (_coefficients + set * coefficientSetSize(_header->resonators));
+  return header->sampleRate;
+}
+
+std::vector<uint8_t> ModelBinary::encode(std::string const &name, float fundamental,
+                                         const std::vector<ResonatorParams> &params, const std::vector<float> &sampleRates) {
+  uint32_t resonators = params.size();
+  size_t paramsSize = align(resonators * sizeof(ResonatorParams));
+  size_t setSize = coefficientSetSize(resonators);
+  size_t payloadSize = paramsSize + sampleRates.size() * setSize;
+
+  std::vector<uint8_t> data(sizeof(ModelBinaryHeader) + payloadSize, 0);
+  uint8_t* payload = data.data() + sizeof(ModelBinaryHeader);
+
+  if (resonators > 0)
+    memcpy(payload, params.data(), resonators * sizeof(ResonatorParams));
+
+  // Bake coefficients by running the same update() the bank would
+  std::vector<ResonatorCoefficients> coefficients(resonators);
+  for (unsigned int i = 0; i < sampleRates.size(); ++i) {
+    ResonatorBankOptions opt = {};
+    opt.v       = false;
+    opt.total   = resonators;
+    opt.maxSize = resonators;
+    ResonatorBank bank;
+    bank.setup(opt, sampleRates[i], 1);
+    bank.setBank(params);
+    bank.update();
+    bank.getCoefficients(coefficients.data(), resonators);
+
+    ModelBinaryCoefficientsHeader setHeader = {};
+    setHeader.sampleRate = sampleRates[i];
+    setHeader.resonators = resonators;
+    uint8_t* set = payload + paramsSize + i * setSize;
+    memcpy(set, &setHeader, sizeof(setHeader));
+    if (resonators > 0)
+      memcpy(set + sizeof(setHeader), coefficients.data(), resonators * sizeof(ResonatorCoefficients));
+  }
+
+  ModelBinaryHeader header = {};
+  memcpy(header.magic, kModelBinaryMagic, 4);
+  header.version         = kModelBinaryVersion;
+  header.endian          = kModelBinaryEndian;
+  header.headerSize      = sizeof(ModelBinaryHeader);
+  header.resonators      = resonators;
+  header.fundamental     = fundamental;
+  header.coefficientSets = sampleRates.size();
+  header.payloadSize     = payloadSize;
+  header.checksum        = crc32(payload, payloadSize);
+  // UTF-8, cut at a character boundary if it is too long
+  size_t nameSize = (name.size() < sizeof(header.name)) ? name.size() : sizeof(header.name);
+  while (nameSize < name.size() && nameSize > 0 && (name[nameSize] & 0xC0) == 0x80) --nameSize;
+  memcpy(header.name, name.data(), nameSize);
+  memcpy(data.data(), &header, sizeof(header));
+
+  return data;
+}
+
+bool ModelBinary::write(std::string const &path, std::string const &name, float fundamental,
+                        const std::vector<ResonatorParams> &params, const std::vector<float> &sampleRates) {
+  const uint16_t probe = 1;
+  if (*(const uint8_t*) &probe != 1) {
+    printf("[ModelBinary] write() Error: binary models are little-endian only\n");
+    return false;
+  }
+
+  std::vector<uint8_t> data = encode(name, fundamental, params, sampleRates);
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    printf("[ModelBinary] write() Error: could not open \'%s\'\n", path.c_str());
+    return false;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) printf("[ModelBinary] write() Error: could not write \'%s\'\n", path.c_str());
+  return ok;
+}
+
+uint32_t ModelBinary::crc32(const uint8_t* data, size_t size) {
+  static const struct Table {
+    uint32_t entries[256];
+    Table() {
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        entries[i] = c;
+      }
+    }
+  } table;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
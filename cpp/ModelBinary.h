@@ -0,0 +1,104 @@
+/*
+ * Model:
+ * ModelBinary
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ModelBinary_H_
+#define ModelBinary_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "Resonator.h"
+
+// Precompiled binary model format (`.resm`), version 1. Little-endian, with
+// every section starting on a 16 byte boundary:
+//
+//   ModelBinaryHeader                        64 bytes
+//   ResonatorParams[resonators]              freq, gain, decay (as in the JSON)
+//   for each baked sample rate:
+//     ModelBinaryCoefficientsHeader          16 bytes
+//     ResonatorCoefficients[resonators]      a1, b1, b2, a1Prime
+//
+// `name` is UTF-8, cut at a character boundary to fit and NUL-padded.
+// `checksum` is the CRC-32 of everything after the header. Baked coefficients
+// are computed at the model's own fundamental, so they only apply to a bank
+// that plays the model untransposed at that sample rate.
+
+static const char     kModelBinaryMagic[4] = {'R', 'E', 'S', 'M'};
+static const uint16_t kModelBinaryVersion  = 1;
+static const uint16_t kModelBinaryEndian   = 0x0102;
+static const size_t   kModelBinaryAlign    = 16;
+
+typedef struct _ModelBinaryHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t endian;
+    uint32_t headerSize;
+    uint32_t resonators;
+    float    fundamental;
+    uint32_t coefficientSets;
+    uint32_t payloadSize;
+    uint32_t checksum;
+    char     name[32];
+} ModelBinaryHeader;
+
+typedef struct _ModelBinaryCoefficientsHeader {
+    float    sampleRate;
+    uint32_t resonators;
+    uint32_t reserved[2];
+} ModelBinaryCoefficientsHeader;
+
+class ModelBinary {
+public:
+    ModelBinary();
+    ~ModelBinary();
+
+    // Memory-map a `.resm` file read-only, or view one already in memory
+    bool open(std::string const &path);
+    bool open(const void* data, size_t size);
+    void close();
+    bool isOpen() { return _header != NULL; }
+
+    const char* getName() { return _name; }
+    float getFundamental() { return _header->fundamental; }
+    int getSize() { return _header->resonators; }
+    const ResonatorParams* getParams() { return _params; }
+    // Baked coefficients for `sampleRate`, or NULL if none were stored
+    const ResonatorCoefficients* getCoefficients(float sampleRate);
+    int getCoefficientSets() { return _header->coefficientSets; }
+    float getCoefficientsSampleRate(int set);
+
+    // Serialise a model, baking coefficients for each of `sampleRates`
+    static bool write(std::string const &path, std::string const &name, float fundamental,
+                      const std::vector<ResonatorParams> &params, const std::vector<float> &sampleRates);
+    static std::vector<uint8_t> encode(std::string const &name, float fundamental,
+                                       const std::vector<ResonatorParams> &params, const std::vector<float> &sampleRates);
+    static uint32_t crc32(const uint8_t* data, size_t size);
+
+private:
+    ModelBinary(const ModelBinary&);
+    ModelBinary& operator=(const ModelBinary&);
+
+    void*  _map = NULL;
+    size_t _mapSize = 0;
+    const ModelBinaryHeader* _header = NULL;
+    const ResonatorParams*   _params = NULL;
+    const uint8_t*           _coefficients = NULL;
+    char _name[33]; // header name plus terminator
+
+    // 64-bit, so that counts read from a header cannot wrap on a 32-bit target
+    static uint64_t align(uint64_t size) { return (size + kModelBinaryAlign - 1) & ~(uint64_t) (kModelBinaryAlign - 1); }
+    static uint64_t coefficientSetSize(uint32_t resonators) {
+        return align(sizeof(ModelBinaryCoefficientsHeader) + (uint64_t) resonators * sizeof(ResonatorCoefficients));
+    }
+
+};
+
+#endif /* ModelBinary_H_ */
@@ -0,0 +1,232 @@
+/*
+ * Model:
+ * ModelLibrary
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ModelLibrary.h"
+
+static size_t alignModelLibrary(size_t size) { return (size + kModelBinaryAlign - 1) & ~(kModelBinaryAlign - 1); }
+
+ModelLibrary::ModelLibrary(){}
+ModelLibrary::~ModelLibrary(){ close(); }
+
+bool ModelLibrary::open(std::string const &path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    printf("[ModelLibrary] open() Error: could not open \'%s\'\n", path.c_str());
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ModelLibraryHeader)) {
+    printf("[ModelLibrary] open() Error: \'%s\' is too small to be a library\n", path.c_str());
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    printf("[ModelLibrary] open() Error: could not map \'%s\'\n", path.c_str());
+    return false;
+  }
+
+  const uint8_t* bytes = (const uint8_t*) map;
+  const ModelLibraryHeader* header = (const ModelLibraryHeader*) map;
+  size_t tablesSize = alignModelLibrary(header->buckets * sizeof(ModelLibraryBucket))
+                    + alignModelLibrary(header->entries * sizeof(ModelLibraryEntry))
+                    + alignModelLibrary(header->models * sizeof(ModelLibraryModel));
+
+  const char* error = NULL;
+  if (memcmp(header->magic, kModelLibraryMagic, 4) != 0)
+    error = "not a model library";
+  else if (header->endian != kModelBinaryEndian)
+    error = "byte order does not match this machine";
+  else if (header->version != kModelLibraryVersion || header->headerSize != sizeof(ModelLibraryHeader))
+    error = "unsupported version";
+  else if (header->buckets == 0 || (header->buckets & (header->buckets - 1)) != 0 || header->entries >= header->buckets)
+    error = "malformed index";
+  else if (header->indexSize < tablesSize || (size_t) st.st_size < sizeof(ModelLibraryHeader) + header->indexSize)
+    error = "truncated library";
+  else if (ModelBinary::crc32(bytes + sizeof(ModelLibraryHeader), header->indexSize) != header->indexChecksum)
+    error = "index checksum mismatch";
+
+  if (error != NULL) {
+    printf("[ModelLibrary] open() Error: \'%s\': %s\n", path.c_str(), error);
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  _map        = map;
+  _mapSize    = st.st_size;
+  _header     = header;
+  _buckets    = (const ModelLibraryBucket*) (bytes + sizeof(ModelLibraryHeader));
+  _entries    = (const ModelLibraryEntry*) ((const uint8_t*) _buckets + alignModelLibrary(header->buckets * sizeof(ModelLibraryBucket)));
+  _modelTable = (const ModelLibraryModel*) ((const uint8_t*) _entries + alignModelLibrary(header->entries * sizeof(ModelLibraryEntry)));
+  _names      = (const char*) _modelTable + alignModelLibrary(header->models * sizeof(ModelLibraryModel));
+
+  _cache.assign(header->models, NULL);
+  _invalid.assign(header->models, false);
+  return true;
+}
+
+void ModelLibrary::close() {
+  std::lock_guard<std::mutex> lock(_cacheMutex);
+  for (unsigned int i = 0; i < _cache.size(); ++i) delete _cache[i];
+  _cache.clear();
+  _invalid.clear();
+  if (_map != NULL) munmap(_map, _mapSize);
+  _map = NULL;
+  _mapSize = 0;
+  _header = NULL;
+  _buckets = NULL;
+  _entries = NULL;
+  _modelTable = NULL;
+  _names = NULL;
+}
+
+ModelBinary* ModelLibrary::find(std::string const &name) {
+  if (_header == NULL) return NULL;
+  size_t start = 0;
+  while (start < name.size()) {
+    int entry = findEntry(name.c_str() + start, name.size() - start);
+    if (entry >= 0) return getModel(_entries[entry].modelIndex);
+    size_t slash = name.find('/', start);
+    if (slash == std::string::npos) break;
+    start = slash + 1;
+  }
+  return NULL;
+}
+
+uint64_t ModelLibrary::hash(const char* name, size_t length) {
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= (uint8_t) name[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+bool ModelLibrary::write(std::string const &path, const std::vector<ModelLibraryItem> &items) {
+  // Index sized to at most half full, so probes stay short
+  uint32_t totalEntries = 0;
+  for (unsigned int i = 0; i < items.size(); ++i) totalEntries += items[i].names.size();
+  uint32_t buckets = 16;
+  while (buckets < totalEntries * 2) buckets *= 2;
+
+  std::vector<ModelLibraryBucket> bucketTable(buckets);
+  for (unsigned int i = 0; i < buckets; ++i) {
+    bucketTable[i].hash = 0;
+    bucketTable[i].entry = kModelLibraryEmpty;
+    bucketTable[i].reserved = 0;
+  }
+  std::vector<ModelLibraryEntry> entries;
+  std::vector<ModelLibraryModel> models(items.size());
+  std::string names;
+
+  for (unsigned int i = 0; i < items.size(); ++i) {
+    for (unsigned int j = 0; j < items[i].names.size(); ++j) {
+      std::string const &name = items[i].names[j];
+      uint64_t h = hash(name.c_str(), name.size());
+      uint32_t b = h & (buckets - 1);
+      while (bucketTable[b].entry != kModelLibraryEmpty) {
+        ModelLibraryEntry const &other = entries[bucketTable[b].entry];
+        if (bucketTable[b].hash == h && names.compare(other.nameOffset, other.nameLength, name) == 0) {
+          printf("[ModelLibrary] write() Error: duplicate model name \'%s\'\n", name.c_str());
+          return false;
+        }
+        b = (b + 1) & (buckets - 1);
+      }
+      ModelLibraryEntry entry = {(uint32_t) names.size(), (uint32_t) name.size(), i, 0};
+      bucketTable[b].hash = h;
+      bucketTable[b].entry = entries.size();
+      entries.push_back(entry);
+      names += name;
+    }
+  }
+
+  size_t indexSize = alignModelLibrary(buckets * sizeof(ModelLibraryBucket))
+                   + alignModelLibrary(entries.size() * sizeof(ModelLibraryEntry))
+                   + alignModelLibrary(models.size() * sizeof(ModelLibraryModel))
+                   + alignModelLibrary(names.size());
+  size_t offset = sizeof(ModelLibraryHeader) + indexSize;
+  for (unsigned int i = 0; i < items.size(); ++i) {
+    models[i].offset = offset;
+    models[i].size = items[i].model.size();
+    offset += alignModelLibrary(items[i].model.size());
+  }
+
+  std::vector<uint8_t> data(offset, 0);
+  uint8_t* p = data.data() + sizeof(ModelLibraryHeader);
+  memcpy(p, bucketTable.data(), buckets * sizeof(ModelLibraryBucket));
+  p += alignModelLibrary(buckets * sizeof(ModelLibraryBucket));
+  if (!entries.empty()) memcpy(p, entries.data(), entries.size() * sizeof(ModelLibraryEntry));
+  p += alignModelLibrary(entries.size() * sizeof(ModelLibraryEntry));
+  if (!models.empty()) memcpy(p, models.data(), models.size() * sizeof(ModelLibraryModel));
+  p += alignModelLibrary(models.size() * sizeof(ModelLibraryModel));
+  memcpy(p, names.data(), names.size());
+  for (unsigned int i = 0; i < items.size(); ++i)
+    memcpy(data.data() + models[i].offset, items[i].model.data(), items[i].model.size());
+
+  ModelLibraryHeader header = {};
+  memcpy(header.magic, kModelLibraryMagic, 4);
+  header.version       = kModelLibraryVersion;
+  header.endian        = kModelBinaryEndian;
+  header.headerSize    = sizeof(ModelLibraryHeader);
+  header.buckets       = buckets;
+  header.entries       = entries.size();
+  header.models        = models.size();
+  header.indexSize     = indexSize;
+  header.indexChecksum = ModelBinary::crc32(data.data() + sizeof(ModelLibraryHeader), indexSize);
+  memcpy(data.data(), &header, sizeof(header));
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    printf("[ModelLibrary] write() Error: could not open \'%s\'\n", path.c_str());
+    return false;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) printf("[ModelLibrary] write() Error: could not write \'%s\'\n", path.c_str());
+  return ok;
+}
+
+// private methods
+int ModelLibrary::findEntry(const char* name, size_t length) {
+  uint64_t h = hash(name, length);
+  uint32_t b = h & (_header->buckets - 1);
+  while (_buckets[b].entry != kModelLibraryEmpty) {
+    const ModelLibraryEntry &entry = _entries[_buckets[b].entry];
+    if (_buckets[b].hash == h && entry.nameLength == length && memcmp(_names + entry.nameOffset, name, length) == 0)
+      return _buckets[b].entry;
+    b = (b + 1) & (_header->buckets - 1);
+  }
+  return -1;
+}
+
+ModelBinary* ModelLibrary::getModel(uint32_t modelIndex) {
+  std::lock_guard<std::mutex> lock(_cacheMutex);
+  if (modelIndex >= _cache.size() || _invalid[modelIndex]) return NULL;
+  if (_cache[modelIndex] == NULL) {
+    const ModelLibraryModel &m = _modelTable[modelIndex];
+    ModelBinary* binary = new ModelBinary();
+    if (m.offset + (size_t) m.size > _mapSize || !binary->open((const uint8_t*) _map + m.offset, m.size)) {
+      printf("[ModelLibrary] find() Error: model %u is corrupt\n", modelIndex);
+      delete binary;
+      _invalid[modelIndex] = true;
+      return NULL;
+    }
+    _cache[modelIndex] = binary;
+  }
+  return _cache[modelIndex];
+}
@@ -0,0 +1,113 @@
+/*
+ * Model:
+ * ModelLibrary
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ModelLibrary_H_
+#define ModelLibrary_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ModelBinary.h"
+
+// Packed model library (`.resl`), version 1: many binary models (ModelBinary.h)
+// in one file behind a hashed name index. Little-endian, 16 byte aligned:
+//
+//   ModelLibraryHeader                      32 bytes
+//   ModelLibraryBucket[buckets]             open addressing, FNV-1a 64 hash
+//   ModelLibraryEntry[entries]              name -> model index
+//   ModelLibraryModel[models]               model image offset and size
+//   name pool                               not terminated
+//   `.resm` model images
+//
+// The file is memory-mapped read-only and shared, so every bank and process
+// using it shares the same pages. Models are validated on first lookup only,
+// so opening costs the same however large the library is.
+
+static const char     kModelLibraryMagic[4] = {'R', 'E', 'S', 'L'};
+static const uint16_t kModelLibraryVersion  = 1;
+static const uint32_t kModelLibraryEmpty    = 0xFFFFFFFF;
+
+typedef struct _ModelLibraryHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t endian;
+    uint32_t headerSize;
+    uint32_t buckets; // power of two
+    uint32_t entries;
+    uint32_t models;
+    uint32_t indexSize; // buckets, entries, model table and names
+    uint32_t indexChecksum;
+} ModelLibraryHeader;
+
+typedef struct _ModelLibraryBucket {
+    uint64_t hash;
+    uint32_t entry;
+    uint32_t reserved;
+} ModelLibraryBucket;
+
+typedef struct _ModelLibraryEntry {
+    uint32_t nameOffset; // into the name pool
+    uint32_t nameLength;
+    uint32_t modelIndex;
+    uint32_t reserved;
+} ModelLibraryEntry;
+
+typedef struct _ModelLibraryModel {
+    uint32_t offset; // from the start of the file
+    uint32_t size;
+} ModelLibraryModel;
+
+typedef struct _ModelLibraryItem {
+    std::vector<std::string> names;
+    std::vector<uint8_t> model; // as from ModelBinary::encode()
+} ModelLibraryItem;
+
+class ModelLibrary {
+public:
+    ModelLibrary();
+    ~ModelLibrary();
+
+    bool open(std::string const &path);
+    void close();
+    bool isOpen() { return _header != NULL; }
+    int getSize() { return _header ? _header->models : 0; }
+
+    // Look a model up by name. Leading directories are dropped until a name
+    // matches, so "models/handdrum.json" finds a model packed as "handdrum.json".
+    // Returns NULL if there is no such model or it fails validation.
+    ModelBinary* find(std::string const &name);
+
+    static bool write(std::string const &path, const std::vector<ModelLibraryItem> &items);
+    static uint64_t hash(const char* name, size_t length);
+
+private:
+    ModelLibrary(const ModelLibrary&);
+    ModelLibrary& operator=(const ModelLibrary&);
+
+    void*  _map = NULL;
+    size_t _mapSize = 0;
+    const ModelLibraryHeader* _header = NULL;
+    const ModelLibraryBucket* _buckets = NULL;
+    const ModelLibraryEntry*  _entries = NULL;
+    const ModelLibraryModel*  _modelTable = NULL;
+    const char*               _names = NULL;
+
+    std::mutex _cacheMutex;
+    std::vector<ModelBinary*> _cache; // one per model, opened on first lookup
+    std::vector<bool> _invalid;
+
+    int findEntry(const char* name, size_t length);
+    ModelBinary* getModel(uint32_t modelIndex);
+
+};
+
+#endif /* ModelLibrary_H_ */
@@ -0,0 +1,198 @@
+/*
+ * Model:
+ * ModelLoadService
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include "ModelLoadService.h"
+
+ModelLoadService::ModelLoadService(){}
+ModelLoadService::~ModelLoadService(){ cleanup(); }
+
+bool ModelLoadService::setup(int totalBanks, float sampleRate, float audioFrames, ModelLoadServiceOptions options){
+  cleanup();
+  _opt = options;
+  _totalBanks = totalBanks;
+  _sampleRate = sampleRate;
+
+  _slots.reset(new Slot[totalBanks * kSlotsPerBank]);
+  for (int i = 0; i < totalBanks * kSlotsPerBank; ++i) {
+    _slots[i].state.store(kFree);
+    _slots[i].size = 0;
+    _slots[i].fundamental = 0;
+    _slots[i].shiftRatio = 1.0f;
+    _slots[i].params.resize(_opt.maxSize);
+    _slots[i].coefficients.resize(_opt.maxSize);
+  }
+  _mailboxes.reset(new std::atomic<Slot*>[totalBanks]);
+  for (int i = 0; i < totalBanks; ++i) _mailboxes[i].store(NULL);
+
+  _loader.setVerbose(false);
+  _loader.reserve(_opt.maxSize);
+
+  ResonatorBankOptions bankOpt = {};
+  bankOpt.v       = false;
+  bankOpt.total   = _opt.maxSize;
+  bankOpt.maxSize = _opt.maxSize;
+  _scratchBank.setup(bankOpt, sampleRate, audioFrames);
+
+  _running = true;
+  _thread = std::thread(&ModelLoadService::run, this);
+  return true;
+}
+
+void ModelLoadService::cleanup(){
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+    _requests.clear();
+  }
+  _wake.notify_one();
+  if (_thread.joinable()) _thread.join();
+}
+
+bool ModelLoadService::loadAsync(std::string const &path, int bankIndex, std::string const &pitch){
+  Request req = {bankIndex, false, path, pitch};
+  return request(req);
+}
+
+bool ModelLoadService::loadJSONAsync(std::string const &json, int bankIndex, std::string const &pitch){
+  Request req = {bankIndex, true, json, pitch};
+  return request(req);
+}
+
+bool ModelLoadService::apply(int bankIndex, ResonatorBank &bank){
+  Slot *slot = takeReady(bankIndex);
+  if (slot == NULL) return false;
+  bank.setSize(slot->size);
+  bank.setBank(slot->params.data(), slot->size);
+  bank.setCoefficients(slot->coefficients.data(), slot->size);
+  release(slot);
+  return true;
+}
+
+bool ModelLoadService::apply(int bankIndex, Resonators &res){
+  Slot *slot = takeReady(bankIndex);
+  if (slot == NULL) return false;
+  res.setBankState(bankIndex, slot->params.data(), slot->coefficients.data(), slot->size, slot->fundamental, slot->shiftRatio);
+  release(slot);
+  return true;
+}
+
+int ModelLoadService::apply(Resonators &res){
+  int applied = 0;
+  int banks = (res.getTotalBanks() < _totalBanks) ? res.getTotalBanks() : _totalBanks;
+  for (int i = 0; i < banks; ++i)
+    if (apply(i, res)) ++applied;
+  return applied;
+}
+
+// private methods
+bool ModelLoadService::request(Request const &req){
+  if (req.bankIndex < 0 || req.bankIndex >= _totalBanks) {
+    rt_printf("[ModelLoadService] loadAsync() Error: invalid bank %d\n", req.bankIndex);
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_running) return false;
+    bool replaced = false;
+    for (unsigned int i = 0; i < _requests.size(); ++i) {
+      if (_requests[i].bankIndex == req.bankIndex) {
+        _requests[i] = req;
+        replaced = true;
+        break;
+      }
+    }
+    if (!replaced) {
+      if ((int) _requests.size() >= _opt.maxPending) {
+        rt_printf("[ModelLoadService] loadAsync() Error: too many pending requests\n");
+        return false;
+      }
+      _requests.push_back(req);
+    }
+  }
+  _wake.notify_one();
+  return true;
+}
+
+void ModelLoadService::run(){
+  while (true) {
+    Request req;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wake.wait(lock, [this]{ return !_running || !_requests.empty(); });
+      if (!_running) return;
+      req = _requests.front();
+      _requests.pop_front();
+    }
+
+    Slot *slot = acquireSlot(req.bankIndex);
+    if (slot == NULL) {
+      rt_printf("[ModelLoadService] Error: no free slot for bank %d\n", req.bankIndex);
+      continue;
+    }
+    if (!prepare(req, *slot)) {
+      release(slot);
+      continue;
+    }
+
+    // Post to the mailbox; a result the audio thread never picked up is recycled
+    slot->state.store(kReady, std::memory_order_release);
+    Slot *stale = _mailboxes[req.bankIndex].exchange(slot, std::memory_order_acq_rel);
+    if (stale != NULL) release(stale);
+  }
+}
+
+bool ModelLoadService::prepare(Request const &req, Slot &slot){
+  if (req.isJSON) {
+    if (!_loader.parse(req.source.c_str(), req.source.size())) return false;
+  } else {
+    ModelBinary *binary = (_library != NULL) ? _library->find(req.source) : NULL;
+    if (binary != NULL) _loader.parse(*binary);
+    else if (!_loader.load(req.source)) return false;
+  }
+  if (!req.pitch.empty()) _loader.shiftToNote(req.pitch);
+
+  int size = _loader.getSize();
+  if (size > _opt.maxSize) {
+    if (_opt.v) rt_printf("[ModelLoadService] Truncating model to %d resonators\n", _opt.maxSize);
+    size = _opt.maxSize;
+  }
+
+  const std::vector<ResonatorParams> &params = _loader.getModel();
+  const ResonatorCoefficients* baked = _loader.getBakedCoefficients(_sampleRate);
+  if (baked != NULL) {
+    for (int i = 0; i < size; ++i) slot.coefficients[i] = baked[i];
+  } else {
+    _scratchBank.setSize(size);
+    _scratchBank.setBank(params.data(), size);
+    _scratchBank.update();
+    _scratchBank.getCoefficients(slot.coefficients.data(), size);
+  }
+
+  slot.size = size;
+  slot.fundamental = _loader.getFundamental();
+  slot.shiftRatio = _loader.getShiftRatio();
+  for (int i = 0; i < size; ++i) slot.params[i] = params[i];
+
+  if (_opt.v) rt_printf("[ModelLoadService] Prepared bank %d (%d resonators)\n", req.bankIndex, size);
+  return true;
+}
+
+ModelLoadService::Slot* ModelLoadService::acquireSlot(int bankIndex){
+  for (int i = 0; i < kSlotsPerBank; ++i) {
+    Slot *slot = &_slots[bankIndex * kSlotsPerBank + i];
+    int expected = kFree;
+    if (slot->state.compare_exchange_strong(expected, kFilling, std::memory_order_acquire)) return slot;
+  }
+  return NULL;
+}
+
+ModelLoadService::Slot* ModelLoadService::takeReady(int bankIndex){
+  if (bankIndex < 0 || bankIndex >= _totalBanks) return NULL;
+  return _mailboxes[bankIndex].exchange(NULL, std::memory_order_acq_rel);
+}
@@ -0,0 +1,109 @@
+/*
+ * Model:
+ * ModelLoadService
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ModelLoadService_H_
+#define ModelLoadService_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Resonators.h"
+
+// Loads models on a background thread and hands the finished bank state to
+// the audio thread. loadAsync() only queues a request; the service thread does
+// the file I/O, parsing, transposition and coefficient computation, then posts
+// the result to the bank's mailbox. apply() is called from render() and swaps
+// a waiting result in with one atomic exchange, so it never blocks.
+//
+//   loader.setup(4, context->audioSampleRate, context->audioFrames);
+//   loader.loadAsync("models/metallic.json", 0, "c4"); // from any control thread
+//   loader.apply(res);                                 // at the top of render()
+
+typedef struct _ModelLoadServiceOptions {
+    int  maxSize = 40; // resonators per bank, as ResonatorBankOptions::maxSize
+    int  maxPending = 64; // queued requests before loadAsync() refuses more
+    bool v = true; // verbose printing
+} ModelLoadServiceOptions;
+
+class ModelLoadService {
+public:
+    ModelLoadService();
+    ~ModelLoadService();
+
+    bool setup(int totalBanks, float sampleRate, float audioFrames, ModelLoadServiceOptions options = ModelLoadServiceOptions());
+    void cleanup();
+    void setLibrary(ModelLibrary *library) { _library = library; }
+
+    // Control threads: queue a model file (or model JSON text) for a bank,
+    // transposed to `pitch` (a note name, or "" to keep the model's own).
+    // A newer request for the same bank replaces one still waiting.
+    bool loadAsync(std::string const &path, int bankIndex, std::string const &pitch);
+    bool loadJSONAsync(std::string const &json, int bankIndex, std::string const &pitch);
+
+    // Audio thread: apply a finished load if there is one; wait-free
+    bool apply(int bankIndex, ResonatorBank &bank);
+    bool apply(int bankIndex, Resonators &res);
+    int apply(Resonators &res); // all banks, returns how many changed
+
+private:
+    struct Request {
+        int bankIndex;
+        bool isJSON;
+        std::string source; // path or JSON text
+        std::string pitch;
+    };
+
+    enum SlotState { kFree, kFilling, kReady };
+
+    struct Slot {
+        std::atomic<int> state;
+        int size;
+        float fundamental;
+        float shiftRatio;
+        std::vector<ResonatorParams> params;
+        std::vector<ResonatorCoefficients> coefficients;
+    };
+
+    // Per bank: one slot being filled, one waiting in the mailbox and one
+    // being applied is the most that can be in use at once
+    static const int kSlotsPerBank = 3;
+
+    ModelLoadServiceOptions _opt = {};
+    int _totalBanks = 0;
+    float _sampleRate = 44100.0f;
+    ModelLibrary *_library = NULL;
+
+    std::unique_ptr<Slot[]> _slots;
+    std::unique_ptr<std::atomic<Slot*>[]> _mailboxes;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<Request> _requests;
+    bool _running = false;
+    std::thread _thread;
+
+    ModelLoader _loader;
+    ResonatorBank _scratchBank;
+
+    bool request(Request const &req);
+    void run();
+    bool prepare(Request const &req, Slot &slot);
+    Slot* acquireSlot(int bankIndex);
+    Slot* takeReady(int bankIndex);
+    void release(Slot *slot) { slot->state.store(kFree, std::memory_order_release); }
+
+};
+
+#endif /* ModelLoadService_H_ */
@@ -12,38 +12,122 @@
 
 #include <string>
 #include <vector>
-#include <fstream>
+#include <stdio.h>
 #include <map>
+#include <string.h>
 #include <JSON.h>
+#include <Bela.h> // rt_printf(); off-board, host/Bela.h
+
+#include "ModelBinary.h"
+#include "ModelParser.h"
 
 // TODO: Circular dependency issue:
 // #include "ResonatorsTypes.h"
 
 class ModelLoader {
 public:
-  ModelLoader(){}
+  ModelLoader(){ metadata.name.reserve(kMaxNameLength); }
   ~ModelLoader(){}
 
-  // Load a model file, expects a full path to a .json file
-  void load(std::string const &_modelPath) {
+  // Load a model file, expects a full path to a .json file or a binary .resm file
+  bool load(std::string const &_modelPath) {
 
     opt.path = _modelPath; // Store the model path for future reference
-    std::wstring data = L""; // Read the JSON file into a `wstring`
 
-    if (readJSONFile (opt.path, data) == false)
+    if (isBinaryPath(opt.path)) {
+      ModelBinary binary;
+      if (binary.open(opt.path) == false) {
+        rt_printf ("[ModelLoader] load() Error: could not load binary model file \'%s\'\n", opt.path.c_str());
+        return false;
+      }
+      parse(binary);
+      return true;
+    }
+
+    if (readFile (opt.path) == false) {
       rt_printf ("[ModelLoader] load() Error: could not load model JSON file \'%s\'\n", opt.path.c_str());
-    else {
-      JSONValue *parsedJSON = JSON::Parse(data.c_str());
-      parse(parsedJSON);
+      return false;
+    }
+    return parse(fileBuffer.data(), fileBuffer.size());
+
+  }
+
+  // Parse UTF-8 model JSON straight into the parameter array. This only
+  // allocates if `grow` is set and the model is larger than what has been
+  // reserve()d, so with `grow` off it is safe near the audio thread.
+  // On error the current model is left untouched.
+  bool parse(const char* json, size_t length, bool grow = true) {
+    scratch.resize(scratch.capacity()); // no allocation within capacity
+    ModelParser::ModelParserStatus status = parser.parse(json, length, scratch.data(), scratch.size());
+    if (status == ModelParser::kCapacityError && grow) {
+      scratch.resize(parser.getSize());
+      status = parser.parse(json, length, scratch.data(), scratch.size());
+    }
+    if (status != ModelParser::kOk) {
+      rt_printf ("[ModelLoader] parse() Error at byte %u: %s\n", (unsigned int) parser.getErrorOffset(), parser.getError());
+      return false;
+    }
+
+    int size = parser.getSize();
+    for (int i = 0; i < size; ++i) {
+      scratch[i].freq  = constrain(scratch[i].freq,  1.0f,    20000.0f);
+      scratch[i].gain  = constrain(scratch[i].gain,  0.0001f, 0.9999f);
+      scratch[i].decay = constrain(scratch[i].decay, 0.0001f, 0.9999f);
     }
+    scratch.resize(size);
+    model.swap(scratch); // the previous model becomes the next scratch space
+    shiftRatio = 1.0f;
+    clearBaked();
 
+    assignUTF8(metadata.name, parser.getName());
+    metadata.fundamental = parser.getFundamental();
+    int declared = parser.getDeclaredSize();
+    metadata.resonators = (declared >= 0 && declared < size) ? declared : size;
+
+    if (opt.v) {
+      prettyPrintModel();
+      rt_printf ("[ModelLoader] parse() Loaded model \'%ls\'\n", metadata.name.c_str());
+    }
+    return true;
   }
 
   void parse(JSONValue *parsedJSON) {
     parseMetadataJSON   (parsedJSON->Child(L"metadata"));
     parseResonatorsJSON (parsedJSON->Child(L"resonators"));
-    // if (opt.v)
-    rt_printf ("[ModelLoader] parse() Loaded model \'%ls\'\n", metadata.name.c_str());
+    shiftRatio = 1.0f;
+    clearBaked();
+    if (opt.v)
+      rt_printf ("[ModelLoader] parse() Loaded model \'%ls\'\n", metadata.name.c_str());
+  }
+
+  // Copy a memory-mapped binary model straight into the parameter array,
+  // keeping any coefficients baked into it (see getBakedCoefficients())
+  void parse(ModelBinary &binary) {
+    assignUTF8(metadata.name, binary.getName());
+    metadata.fundamental = binary.getFundamental();
+    metadata.resonators  = binary.getSize();
+    model.assign(binary.getParams(), binary.getParams() + binary.getSize());
+    shiftRatio = 1.0f;
+
+    clearBaked();
+    for (int i = 0; i < binary.getCoefficientSets(); ++i) {
+      float sampleRate = binary.getCoefficientsSampleRate(i);
+      const ResonatorCoefficients* coefficients = binary.getCoefficients(sampleRate);
+      if (coefficients == NULL) continue;
+      bakedRates.push_back(sampleRate);
+      baked.insert(baked.end(), coefficients, coefficients + binary.getSize());
+    }
+    if (opt.v) prettyPrintModel();
+  }
+
+  // Coefficients baked into the binary model this was loaded from, for a bank
+  // at `sampleRate`; NULL if there are none for that rate, or if the model has
+  // been transposed or edited since, so that they no longer match it
+  const ResonatorCoefficients* getBakedCoefficients(float sampleRate) {
+    if (shiftRatio != 1.0f) return NULL;
+    for (unsigned int i = 0; i < bakedRates.size(); ++i)
+      if (bakedRates[i] == sampleRate) return baked.data() + i * metadata.resonators;
+    return NULL;
   }
 
   ResonatorParams parseResonatorJSON(JSONObject resJSON){
@@ -58,14 +142,55 @@ public:
 
   // Some standard get functions for obtaining model information
   // TODO: equivalent set functions
-  std::vector<ResonatorParams> getModel(){ return model; }  
+  const std::vector<ResonatorParams>& getModel(){ return model; }
   ModelMetadata getMetadata() { return metadata; }
   std::wstring getName() { return metadata.name; }
+  std::string getNameUTF8() { return encodeUTF8(metadata.name); }
   float getFundamental() { return metadata.fundamental; }
   float getF0() { return getFundamental(); } // synonym
   float getPitch() { return getFundamental(); } // synonym
   // void setF0(std::string noteName)
   int getSize() { return metadata.resonators; }
+  bool getVerbose() { return opt.v; }
+  void setVerbose(bool v) { opt.v = v; }
+
+  // Replace the model's parameters, e.g. with ones prepared on another thread.
+  // `ratio` is how far they have been transposed from the model file.
+  // Does not allocate if `length` is within what has been reserve()d.
+  void setModel(const ResonatorParams* params, int length, float fundamental, float ratio = 1.0f) {
+    model.assign(params, params + length);
+    metadata.resonators = length;
+    metadata.fundamental = fundamental;
+    shiftRatio = ratio;
+    clearBaked();
+  }
+
+  // Apply a change to one resonator, given as in the model file (i.e. before
+  // transposition). `delta` is updated in place to the transposed and
+  // constrained values that were applied, ready to pass on to a bank.
+  bool applyDelta(ResonatorParamDelta &delta) {
+    if (delta.index < 0 || delta.index >= metadata.resonators) return false;
+    ResonatorParams &p = model[delta.index];
+    if (delta.mask & 1) p.freq  = delta.params.freq  = constrain(delta.params.freq * shiftRatio, 1.0f, 20000.0f);
+    if (delta.mask & 2) p.gain  = delta.params.gain  = constrain(delta.params.gain,  0.0001f, 0.9999f);
+    if (delta.mask & 4) p.decay = delta.params.decay = constrain(delta.params.decay, 0.0001f, 0.9999f);
+    clearBaked();
+    return true;
+  }
+
+  // Ratio between the current fundamental and the one the model was loaded with
+  float getShiftRatio() { return shiftRatio; }
+
+  // Array access to a single parameter across the model (0: freq, 1: gain, 2: decay)
+  void getParams(const int paramIndex, float* values, int length) {
+    if (length > (int) model.size()) length = model.size();
+    for (int i = 0; i < length; ++i) values[i] = *paramPtr(model[i], paramIndex);
+  }
+  void setParams(const int paramIndex, const float* values, int length) {
+    if (length > (int) model.size()) length = model.size();
+    for (int i = 0; i < length; ++i) *paramPtr(model[i], paramIndex) = values[i];
+    clearBaked();
+  }
 
   // Model transposition functions exist in two categories: `shift` and `getShifted`.
   // - `shift` functions will shift the loaded model directly
@@ -90,15 +215,24 @@ public:
         rt_printf("[ModelLoader] shiftToFreq() Shifted model to fundamental [ Name: \'%s\' | MIDI: %i | Freq: %.2f ]\n", targetNote.c_str(), targetMidi, targetFreq);
     }
 
-    float shiftRatio = targetFreq / metadata.fundamental;
-    for (int i = 0; i < metadata.resonators; i++) model[i].freq = shiftRatio * model[i].freq;
+    float ratio = targetFreq / metadata.fundamental;
+    for (int i = 0; i < metadata.resonators; i++) model[i].freq = ratio * model[i].freq;
     metadata.fundamental = targetFreq;
+    shiftRatio *= ratio;
+    if (ratio != 1.0f) clearBaked();
+  }
+  // Back to the model file's fundamental
+  void unshift() {
+    if (shiftRatio == 1.0f) return;
+    for (int i = 0; i < metadata.resonators; i++) model[i].freq = model[i].freq / shiftRatio;
+    metadata.fundamental /= shiftRatio;
+    shiftRatio = 1.0f;
   }
   void shiftByFreq(float shiftNote) { shiftToFreq(metadata.fundamental + shiftNote); } // does this work if negative? }
   void shiftToNote(float targetNote) { shiftToFreq(midiToFreq(targetNote)); }
   void shiftByNotes(float shiftNote) { shiftToFreq(metadata.fundamental + midiToFreq(shiftNote)); }
-  void shiftToNote(std::string targetNote) { return shiftToNote(noteNameToMidi(targetNote)); }
-  void shiftByNotes(std::string targetNote) { shiftToFreq(metadata.fundamental + midiToFreq(noteNameToMidi(targetNote))); }
+  void shiftToNote(std::string const &targetNote) { return shiftToNote(noteNameToMidi(targetNote)); }
+  void shiftByNotes(std::string const &targetNote) { shiftToFreq(metadata.fundamental + midiToFreq(noteNameToMidi(targetNote))); }
 
   std::vector<ResonatorParams> getShiftedToFreq(float targetFreq) {
 
@@ -108,18 +242,24 @@ public:
         rt_printf("[ModelLoader] getShiftedToFreq() Returning shifted model with fundamental [ Name: \'%s\' | MIDI: %i | Freq: %.2f ]\n", targetNote.c_str(), targetMidi, targetFreq);
     }
 
-    std::vector<ResonatorParams> shiftedModel;
-    shiftedModel.reserve(metadata.resonators);
+    std::vector<ResonatorParams> shiftedModel(metadata.resonators);
+    shiftedModel.resize(getShiftedToFreq(targetFreq, shiftedModel.data(), shiftedModel.size()));
+    return shiftedModel;
 
+  }
+  // Allocation-free versions, writing up to `capacity` resonators into `out`
+  // and returning how many were written
+  int getShiftedToFreq(float targetFreq, ResonatorParams* out, int capacity) {
     float shiftRatio = targetFreq / metadata.fundamental;
-    
-    for (int i = 0; i < metadata.resonators; i++) { 
+    int size = (metadata.resonators < capacity) ? metadata.resonators : capacity;
+    for (int i = 0; i < size; i++) { 
         ResonatorParams tmp_p = {shiftRatio * model[i].freq, model[i].gain, model[i].decay};
-        shiftedModel.push_back(tmp_p);
+        out[i] = tmp_p;
     }
-
-    return shiftedModel;
-
+    return size;
+  }
+  int getShiftedToNote(std::string const &targetNote, ResonatorParams* out, int capacity) {
+    return getShiftedToFreq(midiToFreq(noteNameToMidi(targetNote)), out, capacity);
   }
   std::vector<ResonatorParams> getShiftedByFreq(float shiftFreq) {
     return getShiftedToFreq(metadata.fundamental + shiftFreq); // does this work if negative?
@@ -130,15 +270,16 @@ public:
   std::vector<ResonatorParams> getShiftedByNotes(float shiftNote) {
     return getShiftedToFreq(metadata.fundamental + midiToFreq(shiftNote)); // does this work if negative?
   }
-  std::vector<ResonatorParams> getShiftedToNote(std::string targetNote) {
+  std::vector<ResonatorParams> getShiftedToNote(std::string const &targetNote) {
     return getShiftedToFreq(midiToFreq(noteNameToMidi(targetNote)));
   }
-  std::vector<ResonatorParams> getShiftedByNotes(std::string shiftNote) {
+  std::vector<ResonatorParams> getShiftedByNotes(std::string const &shiftNote) {
     return getShiftedToFreq(metadata.fundamental + midiToFreq(noteNameToMidi(shiftNote))); // does this work if negative?
   }
 
   void reserve(int i) {
     model.reserve(i);
+    scratch.reserve(i);
   }
 
   // TODO: delete at some point and provide better debug functions if needed
@@ -190,6 +331,21 @@ public:
     rt_printf("   -------------------------------\n");
   }
 
+  // Encode a wide string as UTF-8, anything that is not a character as U+FFFD
+  static std::string encodeUTF8(std::wstring const &in) {
+      std::string out;
+      out.reserve(in.size());
+      for (unsigned int i = 0; i < in.size(); ++i) {
+        unsigned int c = (unsigned int) in[i];
+        if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) c = 0xFFFD;
+        if (c < 0x80) out += (char) c;
+        else if (c < 0x800) { out += (char) (0xC0 | (c >> 6)); out += (char) (0x80 | (c & 0x3F)); }
+        else if (c < 0x10000) { out += (char) (0xE0 | (c >> 12)); out += (char) (0x80 | ((c >> 6) & 0x3F)); out += (char) (0x80 | (c & 0x3F)); }
+        else { out += (char) (0xF0 | (c >> 18)); out += (char) (0x80 | ((c >> 12) & 0x3F)); out += (char) (0x80 | ((c >> 6) & 0x3F)); out += (char) (0x80 | (c & 0x3F)); }
+      }
+      return out;
+  }
+
   // ---------------
 
 private:
@@ -198,23 +354,52 @@ private:
   ModelMetadata metadata = {};
 
   std::vector<ResonatorParams> model;
+  float shiftRatio = 1.0f; // current fundamental / the model file's
+
+  static const int kMaxNameLength = 64;
+  ModelParser parser;
+  std::vector<ResonatorParams> scratch; // parse target, swapped with `model` on success
+  std::vector<char> fileBuffer; // reused between loads
+  std::vector<float> bakedRates; // per set of baked coefficients
+  std::vector<ResonatorCoefficients> baked; // metadata.resonators per set
+
+  // Clearing keeps the capacity, so this never frees on the audio thread
+  void clearBaked() {
+    bakedRates.clear();
+    baked.clear();
+  }
 
-  // Used by load() to do the initial read of the JSON file
-  bool readJSONFile(std::string filename, std::wstring &data) {
-
-      // Create a wide input file stream and check that it opened correctly
-      std::wifstream in(filename.c_str());
-      if (in.is_open() == false) return false;
-      
-      // Iterate over the file and fill the contents into `data`
-      std::wstring line;
-      data = L"";
-      while (getline(in, line)) {
-          data += line;
-          if (!in.eof()) data += L"\n";
+  bool isBinaryPath(std::string const &path) {
+    return path.size() > 5 && path.compare(path.size() - 5, 5, ".resm") == 0;
+  }
+
+  // Used by load() to read the whole file into `fileBuffer`
+  bool readFile(std::string const &filename) {
+      FILE* in = fopen(filename.c_str(), "rb");
+      if (in == NULL) return false;
+
+      bool ok = fseek(in, 0, SEEK_END) == 0;
+      long size = ok ? ftell(in) : -1;
+      ok = size >= 0 && fseek(in, 0, SEEK_SET) == 0;
+      if (ok) {
+        fileBuffer.resize(size);
+        ok = fread(fileBuffer.data(), 1, size, in) == (size_t) size;
       }
+      fclose(in);
+      return ok;
+  }
 
-      return true;
+  // Decode UTF-8 into a wide string (without allocating within its capacity)
+  void assignUTF8(std::wstring &out, const char* in) {
+      out.clear();
+      const unsigned char* p = (const unsigned char*) in;
+      while (*p) {
+        unsigned int c = *p++;
+        int extra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+        if (extra) c &= 0x3F >> extra;
+        for (; extra > 0 && (*p & 0xC0) == 0x80; --extra) c = (c << 6) | (*p++ & 0x3F);
+        if ((int) out.size() < kMaxNameLength) out.push_back((wchar_t) c);
+      }
   }
 
   // Used by load() to parse the model metadata
@@ -254,6 +439,14 @@ private:
 
   }
 
+  float* paramPtr(ResonatorParams &p, const int paramIndex) {
+    switch (paramIndex) {
+      case 1:  return &p.gain;
+      case 2:  return &p.decay;
+      default: return &p.freq;
+    }
+  }
+
   template<class T>
   const T& constrain(const T& val, const T& min, const T& max) {
     if      (val < min) return min;
@@ -278,7 +471,7 @@ private:
 
   float midiToFreq (int _note) { return 27.5 * pow(2, (((float)_note - 21)/12)); }
   int freqToMidi (float _freq) { return (12/log(2)) * log(_freq/27.5) + 21; }
-  int noteNameToMidi (std::string noteName) {
+  int noteNameToMidi (std::string const &noteName) {
       auto findNote = midiNoteNames.find(noteName);
       if (findNote != midiNoteNames.end()){
           return findNote->second;
@@ -288,7 +481,7 @@ private:
           return -1;
       }
   }
-  float noteNameToFreq (std::string noteName) { return midiToFreq(noteNameToMidi(noteName)); }
+  float noteNameToFreq (std::string const &noteName) { return midiToFreq(noteNameToMidi(noteName)); }
   std::string midiToNoteName(int _note) {
       std::map<std::string, int>::const_iterator it;
 
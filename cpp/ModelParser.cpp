@@ -0,0 +1,343 @@
+/*
+ * Model:
+ * ModelParser
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "ModelParser.h"
+
+ModelParser::ModelParser(){ _name[0] = '\0'; }
+ModelParser::~ModelParser(){}
+
+ModelParser::ModelParserStatus ModelParser::parse(const char* data, size_t length, ResonatorParams* params, int capacity) {
+  _begin = _p = data;
+  _end = data + length;
+  _name[0] = '\0';
+  _fundamental = 0;
+  _declaredSize = -1;
+  _size = 0;
+  _error = NULL;
+  _errorOffset = 0;
+
+  // Skip a UTF-8 byte order mark
+  if (length >= 3 && (unsigned char) _p[0] == 0xEF && (unsigned char) _p[1] == 0xBB && (unsigned char) _p[2] == 0xBF) _p += 3;
+
+  bool hasMetadata = false, hasResonators = false;
+  char key[kMaxKeyLength];
+
+  skipWhitespace();
+  if (!expect('{')) return kError;
+  skipWhitespace();
+  if (_p < _end && *_p == '}') ++_p;
+  else {
+    while (true) {
+      skipWhitespace();
+      if (!parseString(key, kMaxKeyLength)) return kError;
+      skipWhitespace();
+      if (!expect(':')) return kError;
+      skipWhitespace();
+      if (strcmp(key, "metadata") == 0) {
+        if (!parseMetadata()) return kError;
+        hasMetadata = true;
+      } else if (strcmp(key, "resonators") == 0) {
+        if (!parseResonators(params, capacity)) return kError;
+        hasResonators = true;
+      } else if (!skipValue(1)) {
+        return kError;
+      }
+      skipWhitespace();
+      if (_p < _end && *_p == ',') { ++_p; continue; }
+      if (!expect('}')) return kError;
+      break;
+    }
+  }
+  skipWhitespace();
+  if (_p != _end) { fail("trailing characters"); return kError; }
+
+  if (!hasMetadata)   { _p = _begin; fail("missing \"metadata\""); return kError; }
+  if (!hasResonators) { _p = _begin; fail("missing \"resonators\""); return kError; }
+  if (_size > capacity) { fail("too many resonators"); return kCapacityError; }
+  return kOk;
+}
+
+// private methods
+bool ModelParser::fail(const char* message) {
+  // Keep the first (innermost) error
+  if (_error == NULL) {
+    _error = message;
+    _errorOffset = _p - _begin;
+  }
+  return false;
+}
+
+void ModelParser::skipWhitespace() {
+  while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) ++_p;
+}
+
+bool ModelParser::expect(char c) {
+  if (_p >= _end) return fail("unexpected end of input");
+  if (*_p != c) {
+    switch (c) {
+      case '{': return fail("expected '{'");
+      case '}': return fail("expected '}' or ','");
+      case '[': return fail("expected '['");
+      case ']': return fail("expected ']' or ','");
+      case ':': return fail("expected ':'");
+      default:  return fail("unexpected character");
+    }
+  }
+  ++_p;
+  return true;
+}
+
+// Copies the string's UTF-8 bytes into `out` (truncated, always terminated);
+// `out` may be NULL to skip the string
+bool ModelParser::parseString(char* out, int capacity) {
+  if (!expect('"')) return fail("expected a string");
+  int n = 0;
+  while (true) {
+    if (_p >= _end) return fail("unterminated string");
+    unsigned char c = *_p++;
+    if (c == '"') break;
+    if (c < 0x20) { --_p; return fail("control character in string"); }
+    unsigned int codepoint = c;
+    if (c == '\\') {
+      if (_p >= _end) return fail("unterminated string");
+      char e = *_p++;
+      switch (e) {
+        case '"':  codepoint = '"';  break;
+        case '\\': codepoint = '\\'; break;
+        case '/':  codepoint = '/';  break;
+        case 'b':  codepoint = '\b'; break;
+        case 'f':  codepoint = '\f'; break;
+        case 'n':  codepoint = '\n'; break;
+        case 'r':  codepoint = '\r'; break;
+        case 't':  codepoint = '\t'; break;
+        case 'u': {
+          if (!parseHex(codepoint)) return false;
+          if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) return fail("unpaired surrogate");
+          if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+            // A character beyond the BMP, as a high then a low surrogate
+            unsigned int low;
+            if (_end - _p < 2 || _p[0] != '\\' || _p[1] != 'u') return fail("unpaired surrogate");
+            _p += 2;
+            if (!parseHex(low)) return false;
+            if (low < 0xDC00 || low > 0xDFFF) return fail("unpaired surrogate");
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          }
+          break;
+        }
+        default: --_p; return fail("invalid escape");
+      }
+    }
+    if (out == NULL) continue;
+    // Re-encode escapes as UTF-8; raw bytes are copied as they are
+    char bytes[4];
+    int count = 1;
+    if (c == '\\' && codepoint >= 0x80) {
+      if (codepoint < 0x800) {
+        bytes[0] = 0xC0 | (codepoint >> 6);
+        bytes[1] = 0x80 | (codepoint & 0x3F);
+        count = 2;
+      } else if (codepoint < 0x10000) {
+        bytes[0] = 0xE0 | (codepoint >> 12);
+        bytes[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+        bytes[2] = 0x80 | (codepoint & 0x3F);
+        count = 3;
+      } else {
+        bytes[0] = 0xF0 | (codepoint >> 18);
+        bytes[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+        bytes[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+        bytes[3] = 0x80 | (codepoint & 0x3F);
+        count = 4;
+      }
+    } else {
+      bytes[0] = (char) codepoint;
+    }
+    if (n + count < capacity) {
+      memcpy(out + n, bytes, count);
+      n += count;
+    }
+  }
+  if (out != NULL) out[n] = '\0';
+  return true;
+}
+
+// The four hex digits of a \u escape
+bool ModelParser::parseHex(unsigned int &value) {
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (_p >= _end) return fail("unterminated string");
+    char h = *_p++;
+    value <<= 4;
+    if      (h >= '0' && h <= '9') value |= h - '0';
+    else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+    else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+    else { --_p; return fail("invalid \\u escape"); }
+  }
+  return true;
+}
+
+bool ModelParser::parseNumber(double &value) {
+  const char* start = _p;
+  bool negative = false;
+  if (_p < _end && *_p == '-') { negative = true; ++_p; }
+  if (_p >= _end || *_p < '0' || *_p > '9') { _p = start; return fail("expected a number"); }
+
+  double mantissa = 0;
+  int exponent = 0;
+  while (_p < _end && *_p >= '0' && *_p <= '9') mantissa = mantissa * 10 + (*_p++ - '0');
+  if (_p < _end && *_p == '.') {
+    ++_p;
+    if (_p >= _end || *_p < '0' || *_p > '9') return fail("expected a digit");
+    while (_p < _end && *_p >= '0' && *_p <= '9') {
+      mantissa = mantissa * 10 + (*_p++ - '0');
+      --exponent;
+    }
+  }
+  if (_p < _end && (*_p == 'e' || *_p == 'E')) {
+    ++_p;
+    bool negativeExponent = false;
+    if (_p < _end && (*_p == '+' || *_p == '-')) negativeExponent = (*_p++ == '-');
+    if (_p >= _end || *_p < '0' || *_p > '9') return fail("expected a digit");
+    int e = 0;
+    while (_p < _end && *_p >= '0' && *_p <= '9') {
+      if (e < 10000) e = e * 10 + (*_p - '0');
+      ++_p;
+    }
+    exponent += negativeExponent ? -e : e;
+  }
+
+  double scale = 1.0;
+  int magnitude = (exponent < 0) ? -exponent : exponent;
+  for (double p10 = 10.0; magnitude > 0 && scale < 1e308; magnitude >>= 1, p10 *= p10)
+    if (magnitude & 1) scale *= p10;
+  value = (exponent < 0) ? mantissa / scale : mantissa * scale;
+  if (negative) value = -value;
+  return true;
+}
+
+bool ModelParser::skipValue(int depth) {
+  if (depth > kMaxDepth) return fail("nested too deeply");
+  skipWhitespace();
+  if (_p >= _end) return fail("unexpected end of input");
+  char c = *_p;
+  if (c == '"') return parseString(NULL, 0);
+  if (c == '{' || c == '[') {
+    char close = (c == '{') ? '}' : ']';
+    ++_p;
+    skipWhitespace();
+    if (_p < _end && *_p == close) { ++_p; return true; }
+    while (true) {
+      skipWhitespace();
+      if (c == '{') {
+        if (!parseString(NULL, 0)) return false;
+        skipWhitespace();
+        if (!expect(':')) return false;
+      }
+      if (!skipValue(depth + 1)) return false;
+      skipWhitespace();
+      if (_p < _end && *_p == ',') { ++_p; continue; }
+      return expect(close);
+    }
+  }
+  static const char* literals[] = {"true", "false", "null"};
+  for (int i = 0; i < 3; ++i) {
+    size_t n = strlen(literals[i]);
+    if ((size_t) (_end - _p) >= n && memcmp(_p, literals[i], n) == 0) { _p += n; return true; }
+  }
+  double ignored;
+  return parseNumber(ignored);
+}
+
+bool ModelParser::parseMetadata() {
+  char key[kMaxKeyLength];
+  if (!expect('{')) return false;
+  skipWhitespace();
+  if (_p < _end && *_p == '}') { ++_p; return true; }
+  while (true) {
+    skipWhitespace();
+    if (!parseString(key, kMaxKeyLength)) return false;
+    skipWhitespace();
+    if (!expect(':')) return false;
+    skipWhitespace();
+    double number;
+    if (strcmp(key, "name") == 0) {
+      if (!parseString(_name, kMaxNameLength)) return false;
+    } else if (strcmp(key, "fundamental") == 0) {
+      if (!parseNumber(number)) return false;
+      _fundamental = number;
+    } else if (strcmp(key, "resonators") == 0) {
+      if (!parseNumber(number)) return false;
+      if (!(number >= 0.0 && number <= INT_MAX)) return fail("resonators out of range"); // NaN too
+      _declaredSize = (int) number;
+    } else if (!skipValue(2)) {
+      return false;
+    }
+    skipWhitespace();
+    if (_p < _end && *_p == ',') { ++_p; continue; }
+    return expect('}');
+  }
+}
+
+bool ModelParser::parseResonators(ResonatorParams* params, int capacity) {
+  if (!expect('[')) return false;
+  skipWhitespace();
+  if (_p < _end && *_p == ']') { ++_p; return true; }
+  ResonatorParams overflow;
+  while (true) {
+    skipWhitespace();
+    // Past capacity, keep counting so the caller knows how much room is needed
+    if (!parseResonator(_size < capacity ? params[_size] : overflow)) return false;
+    ++_size;
+    skipWhitespace();
+    if (_p < _end && *_p == ',') { ++_p; continue; }
+    return expect(']');
+  }
+}
+
+bool ModelParser::parseResonator(ResonatorParams &params) {
+  char key[kMaxKeyLength];
+  const char* start = _p;
+  int found = 0;
+  if (!expect('{')) return false;
+  skipWhitespace();
+  if (_p < _end && *_p == '}') ++_p;
+  else {
+    while (true) {
+      skipWhitespace();
+      if (!parseString(key, kMaxKeyLength)) return false;
+      skipWhitespace();
+      if (!expect(':')) return false;
+      skipWhitespace();
+      double number;
+      float* target = NULL;
+      int bit = 0;
+      if      (strcmp(key, "freq")  == 0) { target = &params.freq;  bit = 1; }
+      else if (strcmp(key, "gain")  == 0) { target = &params.gain;  bit = 2; }
+      else if (strcmp(key, "decay") == 0) { target = &params.decay; bit = 4; }
+      if (target != NULL) {
+        if (!parseNumber(number)) return false;
+        *target = number;
+        found |= bit;
+      } else if (!skipValue(2)) {
+        return false;
+      }
+      skipWhitespace();
+      if (_p < _end && *_p == ',') { ++_p; continue; }
+      if (!expect('}')) return false;
+      break;
+    }
+  }
+  if (found != 7) {
+    _p = start;
+    return fail("resonator needs \"freq\", \"gain\" and \"decay\"");
+  }
+  return true;
+}
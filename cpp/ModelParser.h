@@ -0,0 +1,77 @@
+/*
+ * Model:
+ * ModelParser
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ModelParser_H_
+#define ModelParser_H_
+
+#include <stddef.h>
+
+#include "Resonator.h"
+
+// Streaming parser for UTF-8 model JSON:
+//
+//   { "metadata": { "name": ..., "fundamental": ..., "resonators": ... },
+//     "resonators": [ { "freq": ..., "gain": ..., "decay": ... }, ... ] }
+//
+// Values are written straight into caller-provided storage as they are read;
+// nothing is allocated, so it is safe to call close to the audio thread.
+// Unknown keys are skipped. Errors carry the byte offset they occurred at.
+
+class ModelParser {
+public:
+    ModelParser();
+    ~ModelParser();
+
+    enum ModelParserStatus {
+        kOk,
+        kError,        // see getError() and getErrorOffset()
+        kCapacityError // more resonators than `capacity`; getSize() has the count
+    };
+
+    // Parse `length` bytes into `params`, which has room for `capacity` resonators
+    ModelParserStatus parse(const char* data, size_t length, ResonatorParams* params, int capacity);
+
+    // Results of the last parse()
+    const char* getName() { return _name; } // UTF-8
+    float getFundamental() { return _fundamental; }
+    int getDeclaredSize() { return _declaredSize; } // metadata "resonators"
+    int getSize() { return _size; } // entries in the "resonators" array
+    const char* getError() { return _error; }
+    size_t getErrorOffset() { return _errorOffset; }
+
+private:
+    static const int kMaxNameLength = 64;
+    static const int kMaxKeyLength  = 16;
+    static const int kMaxDepth      = 32;
+
+    const char* _begin = NULL;
+    const char* _p = NULL;
+    const char* _end = NULL;
+
+    char  _name[kMaxNameLength];
+    float _fundamental = 0;
+    int   _declaredSize = 0;
+    int   _size = 0;
+    const char* _error = NULL;
+    size_t _errorOffset = 0;
+
+    bool fail(const char* message);
+    void skipWhitespace();
+    bool expect(char c);
+    bool parseString(char* out, int capacity);
+    bool parseHex(unsigned int &value);
+    bool parseNumber(double &value);
+    bool skipValue(int depth);
+    bool parseMetadata();
+    bool parseResonators(ResonatorParams* params, int capacity);
+    bool parseResonator(ResonatorParams &params);
+
+};
+
+#endif /* ModelParser_H_ */
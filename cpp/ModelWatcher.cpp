@@ -0,0 +1,178 @@
+/*
+ * Model:
+ * ModelWatcher
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "ModelWatcher.h"
+#include "ModelBinary.h"
+
+ModelWatcher::ModelWatcher(){}
+ModelWatcher::~ModelWatcher(){ cleanup(); }
+
+bool ModelWatcher::setup(int debounceMs){
+#ifdef __linux__
+  cleanup();
+  _debounce = std::chrono::milliseconds(debounceMs);
+  _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  _stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (_fd < 0 || _stopFd < 0) {
+    printf("[ModelWatcher] setup() Error: could not initialise inotify\n");
+    cleanup();
+    return false;
+  }
+  _thread = std::thread(&ModelWatcher::run, this);
+  return true;
+#else
+  printf("[ModelWatcher] setup() Error: file watching needs Linux inotify\n");
+  return false;
+#endif
+}
+
+void ModelWatcher::cleanup(){
+#ifdef __linux__
+  if (_thread.joinable()) {
+    uint64_t one = 1;
+    if (write(_stopFd, &one, sizeof(one)) != sizeof(one)) printf("[ModelWatcher] cleanup() Error: could not stop\n");
+    _thread.join();
+  }
+  if (_fd >= 0) close(_fd);
+  if (_stopFd >= 0) close(_stopFd);
+  _fd = _stopFd = -1;
+  std::lock_guard<std::mutex> lock(_mutex);
+  _watches.clear();
+  _pending.clear();
+  _checksums.clear();
+#endif
+}
+
+bool ModelWatcher::watch(std::string const &path, ModelWatcherCallback onChange){
+#ifdef __linux__
+  if (_fd < 0) return false;
+
+  // Files are watched through their directory, which also sees them being
+  // replaced by a rename rather than written in place
+  Watch w;
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    w.dir = path;
+  } else {
+    size_t slash = path.rfind('/');
+    w.dir  = (slash == std::string::npos) ? "." : path.substr(0, slash);
+    w.name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+  }
+  w.onChange = onChange;
+  w.wd = inotify_add_watch(_fd, w.dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_CREATE | IN_MASK_ADD);
+  if (w.wd < 0) {
+    printf("[ModelWatcher] watch() Error: could not watch \'%s\'\n", w.dir.c_str());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _watches.push_back(w);
+  std::string file = w.dir + "/" + w.name;
+  if (!w.name.empty()) changedSinceLast(file); // remember what is there now
+  return true;
+#else
+  return false;
+#endif
+}
+
+// private methods
+void ModelWatcher::run(){
+#ifdef __linux__
+  struct pollfd fds[2] = {{_fd, POLLIN, 0}, {_stopFd, POLLIN, 0}};
+  while (true) {
+    int timeout = -1;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_pending.empty()) {
+        Clock::time_point next = _pending.begin()->second;
+        for (auto const &p : _pending) if (p.second < next) next = p.second;
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+        timeout = (wait > 0) ? (int) wait + 1 : 0;
+      }
+    }
+    if (poll(fds, 2, timeout) < 0) continue;
+    if (fds[1].revents & POLLIN) return;
+    if (fds[0].revents & POLLIN) readEvents();
+    firePending();
+  }
+#endif
+}
+
+void ModelWatcher::readEvents(){
+#ifdef __linux__
+  alignas(struct inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read(_fd, buffer, sizeof(buffer))) > 0) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*) p)->len) {
+      const struct inotify_event *event = (const struct inotify_event*) p;
+      if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+      for (unsigned int i = 0; i < _watches.size(); ++i) {
+        const Watch &w = _watches[i];
+        if (w.wd != event->wd || (!w.name.empty() && w.name != event->name)) continue;
+        std::string file = w.dir + "/" + event->name;
+        // A finished write or a rename starts the settle period; further
+        // writes only push back one that has already started
+        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+          _pending[file] = Clock::now() + _debounce;
+        else if (_pending.count(file))
+          _pending[file] = Clock::now() + _debounce;
+      }
+    }
+  }
+#endif
+}
+
+void ModelWatcher::firePending(){
+  std::vector<std::pair<std::string, ModelWatcherCallback>> ready;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Clock::time_point now = Clock::now();
+    for (auto it = _pending.begin(); it != _pending.end();) {
+      if (it->second > now) { ++it; continue; }
+      if (changedSinceLast(it->first)) {
+        for (unsigned int i = 0; i < _watches.size(); ++i) {
+          const Watch &w = _watches[i];
+          bool match = w.name.empty() ? it->first.compare(0, w.dir.size() + 1, w.dir + "/") == 0
+                                      : it->first == w.dir + "/" + w.name;
+          if (match) ready.push_back(std::make_pair(it->first, w.onChange));
+        }
+      }
+      it = _pending.erase(it);
+    }
+  }
+  // Call back without the lock, so callbacks may add watches
+  for (unsigned int i = 0; i < ready.size(); ++i) ready[i].second(ready[i].first);
+}
+
+bool ModelWatcher::changedSinceLast(std::string const &path){
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) return false;
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+
+  uint32_t checksum = ModelBinary::crc32(data.data(), data.size());
+  auto last = _checksums.find(path);
+  if (last != _checksums.end() && last->second == checksum) return false;
+  _checksums[path] = checksum;
+  return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * Model:
+ * ModelWatcher
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ModelWatcher_H_
+#define ModelWatcher_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches model files (or whole directories of them) with Linux inotify and
+// calls back once a file has settled after a change. Files are only reported
+// when closed after writing or renamed into place, never half-written, and
+// bursts of events are debounced. A file whose contents are the same as at
+// the last callback is not reported again. Callbacks run on the watcher's
+// thread, so pass them on, e.g. to ModelLoadService::loadAsync().
+//
+//   watcher.setup();
+//   watcher.watch("models/tmp.json", [](std::string const &path) { loader.loadAsync(path, 0, ""); });
+
+typedef std::function<void(std::string const &path)> ModelWatcherCallback;
+
+class ModelWatcher {
+public:
+    ModelWatcher();
+    ~ModelWatcher();
+
+    bool setup(int debounceMs = 50);
+    void cleanup();
+
+    // Watch a file, or every file in a directory
+    bool watch(std::string const &path, ModelWatcherCallback onChange);
+
+private:
+    struct Watch {
+        int wd;
+        std::string dir;
+        std::string name; // empty: any file in `dir`
+        ModelWatcherCallback onChange;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    int _fd = -1;
+    int _stopFd = -1;
+    std::chrono::milliseconds _debounce;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::vector<Watch> _watches;
+    std::map<std::string, Clock::time_point> _pending; // path -> settle deadline
+    std::map<std::string, uint32_t> _checksums; // path -> contents at last callback
+
+    void run();
+    void readEvents();
+    void firePending();
+    bool changedSinceLast(std::string const &path);
+
+};
+
+#endif /* ModelWatcher_H_ */
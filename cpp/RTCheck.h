@@ -0,0 +1,199 @@
+/*
+ * Resonators
+ * RTCheck
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef RTCheck_H_
+#define RTCheck_H_
+
+#include <stddef.h>
+#include <atomic>
+
+// Real-time safety checks for tests: counts heap allocations, frees, mutex
+// locks and console or file output made by a thread while it is inside an
+// RTCheck::Scope, e.g. around the calls a render() callback makes. Output
+// counts because stdio takes the stream's lock inside glibc, where the
+// pthread_mutex_lock() hook cannot see it, and write() is a system call; on
+// the host rt_printf() is a plain vprintf().
+//
+// The counting hooks replace malloc() and friends, pthread_mutex_lock(),
+// write() and the stdio output functions, so they are only installed where RESONATORS_RT_CHECK_HOOKS is defined
+// before including this header, in exactly one file of a test program (see
+// tools/test_rt_safety.cpp). Never define it in a Bela project. glibc only.
+
+namespace RTCheck {
+
+enum Kind {
+  kMalloc,
+  kFree,
+  kLock,
+  kWrite,
+  kKinds
+};
+
+inline std::atomic<unsigned int>* counters() {
+  static std::atomic<unsigned int> counts[kKinds]; // zero-initialised, no guard
+  return counts;
+}
+
+inline int& depth() {
+  static thread_local int d = 0;
+  return d;
+}
+
+inline bool active() { return depth() > 0; }
+inline void record(Kind kind) { counters()[kind].fetch_add(1, std::memory_order_relaxed); }
+
+inline unsigned int getViolations(Kind kind) { return counters()[kind].load(std::memory_order_relaxed); }
+inline unsigned int getViolations() { return getViolations(kMalloc) + getViolations(kFree) + getViolations(kLock) + getViolations(kWrite); }
+inline void reset() { for (int i = 0; i < kKinds; ++i) counters()[i].store(0); }
+
+// Marks the current thread as real-time for its lifetime
+class Scope {
+public:
+  Scope() { ++depth(); }
+  ~Scope() { --depth(); }
+};
+
+} // namespace RTCheck
+
+#ifdef RESONATORS_RT_CHECK_HOOKS
+
+#include <errno.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace RTCheck {
+
+// The next definition of a hooked function, i.e. glibc's
+template <typename Function>
+inline Function next(Function &real, const char* name) {
+  if (real == NULL) real = (Function) dlsym(RTLD_NEXT, name);
+  return real;
+}
+
+} // namespace RTCheck
+
+// Definitions repeat glibc's exception specifications (__THROW)
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* ptr);
+
+void* malloc(size_t size) __THROW {
+  if (RTCheck::active()) RTCheck::record(RTCheck::kMalloc);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) __THROW {
+  if (RTCheck::active()) RTCheck::record(RTCheck::kMalloc);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) __THROW {
+  if (RTCheck::active()) RTCheck::record(RTCheck::kMalloc);
+  return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) __THROW {
+  if (RTCheck::active()) RTCheck::record(RTCheck::kMalloc);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) __THROW {
+  if (RTCheck::active()) RTCheck::record(RTCheck::kMalloc);
+  *ptr = __libc_memalign(alignment, size);
+  return (*ptr != NULL) ? 0 : ENOMEM;
+}
+
+void free(void* ptr) __THROW {
+  if (ptr != NULL && RTCheck::active()) RTCheck::record(RTCheck::kFree);
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) __THROWNL {
+  typedef int (*LockFunction)(pthread_mutex_t*);
+  static LockFunction realLock = NULL; // constant-initialised, no guard
+  if (realLock == NULL) realLock = (LockFunction) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+  if (RTCheck::active()) RTCheck::record(RTCheck::kLock);
+  return realLock(mutex);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+  static ssize_t (*real)(int, const void*, size_t) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "write")(fd, buf, count);
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+  static size_t (*real)(const void*, size_t, size_t, FILE*) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "fwrite")(ptr, size, count, stream);
+}
+
+int fputs(const char* s, FILE* stream) {
+  static int (*real)(const char*, FILE*) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "fputs")(s, stream);
+}
+
+int puts(const char* s) {
+  static int (*real)(const char*) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "puts")(s);
+}
+
+int fputc(int c, FILE* stream) {
+  static int (*real)(int, FILE*) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "fputc")(c, stream);
+}
+
+int putchar(int c) {
+  static int (*real)(int) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "putchar")(c);
+}
+
+int vfprintf(FILE* stream, const char* format, va_list args) {
+  static int (*real)(FILE*, const char*, va_list) = NULL;
+  if (RTCheck::active()) RTCheck::record(RTCheck::kWrite);
+  return RTCheck::next(real, "vfprintf")(stream, format, args);
+}
+
+int vprintf(const char* format, va_list args) {
+  return vfprintf(stdout, format, args);
+}
+
+int fprintf(FILE* stream, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int written = vfprintf(stream, format, args);
+  va_end(args);
+  return written;
+}
+
+int printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int written = vfprintf(stdout, format, args);
+  va_end(args);
+  return written;
+}
+
+} // extern "C"
+
+#endif /* RESONATORS_RT_CHECK_HOOKS */
+
+#endif /* RTCheck_H_ */
@@ -60,6 +60,23 @@ float Resonator::render (float excitation) {
     return _min(renderUtils.out1 * opt.outGain, utils.hardLimit);
 }
 
+void Resonator::render (const float* excitation, float* output, int frames) {
+    ResonatorKernelData d = {};
+    d.a1 = &state.a1;
+    d.b1 = &state.b1;
+    d.b2 = &state.b2;
+    d.a1Prev = &state.a1Prev;
+    d.b1Prev = &state.b1Prev;
+    d.b2Prev = &state.b2Prev;
+    d.out1 = &renderUtils.out1;
+    d.out2 = &renderUtils.out2;
+    d.lookAhead = lookAhead;
+    d.outGain = opt.outGain;
+    d.hardLimit = utils.hardLimit;
+    if (ResonatorKernels::renderLookAhead(d, 1, excitation, output, frames)) return;
+    for (int n = 0; n < frames; ++n) output[n] = render(excitation[n]);
+}
+
 // get and set: main functions
 void Resonator::setParam(void* theResonator, const int index, const float value){
     Resonator* resonator = (Resonator*) theResonator;
@@ -116,18 +133,45 @@ const ResonatorParams Resonator::getParameters() {
   return params;
 }
 
+const ResonatorCoefficients Resonator::getCoefficients() {
+  ResonatorCoefficients coefficients = {state.a1, state.b1, state.b2, state.a1Prime};
+  return coefficients;
+}
+void Resonator::setCoefficients(ResonatorCoefficients coefficients) {
+  state.a1      = coefficients.a1;
+  state.b1      = coefficients.b1;
+  state.b2      = coefficients.b2;
+  state.a1Prime = coefficients.a1Prime;
+}
+
+float Resonator::getAmplitude() {
+  // For y[n] = A r^n sin(wn + p), the last two outputs give A without having
+  // to track peaks per sample; b1 = 2r cos(w) and b2 = -r^2
+  float r2 = -state.b2;
+  if (r2 <= 0.0f) return 0.0f;
+  float r = sqrtf(r2);
+  float c = state.b1 / (2.0f * r);
+  float s2 = 1.0f - c * c;
+  float y1 = renderUtils.out1;
+  float y2 = renderUtils.out2 * r;
+  if (s2 < 1e-6f) return fabsf(y1) * opt.outGain;
+  float a2 = (y1 * y1 + y2 * y2 - 2.0f * c * y1 * y2) / s2;
+  return (a2 > 0.0f) ? sqrtf(a2) * opt.outGain : 0.0f;
+}
+
 // private methods
 void Resonator::setState(){
 
-  // map from normalised input values to param ranges
-  params.gain  = mapGain(params.gain); // 0-1 -> 0-0.3
-  params.decay = mapDecay(params.decay); // 0-1 -> 0.5-50
+  // map from normalised input values to param ranges, leaving `params`
+  // normalised so that update() can be called again without remapping
+  float gain  = mapGain(params.gain); // 0-1 -> 0-0.3
+  float decay = mapDecay(params.decay); // 0-1 -> 0.5-50
 
   state.freqPrev  = params.freq;
-  state.gainPrev  = params.gain;
-  state.decayPrev = params.decay;
+  state.gainPrev  = gain;
+  state.decayPrev = decay;
   
-  utils.decaySamples = exp (-params.decay * utils.sampleInterval);
+  utils.decaySamples = exp (-decay * utils.sampleInterval);
   
   if (0.0 >= params.freq || params.freq >= utils.nyquistLimit ||
       0.0 >= utils.decaySamples || utils.decaySamples > 1.0) {
@@ -135,7 +179,7 @@ void Resonator::setState(){
   }
   else {
       state.freqPrime = params.freq * utils.M_2PI * utils.sampleInterval; // w / pole angle?
-      float ts = params.gain * sin (state.freqPrime); // q / pole magnitude?
+      float ts = gain * sin (state.freqPrime); // q / pole magnitude?
       state.a1 = ts * (1.0 - utils.decaySamples);
       state.b2 = -utils.decaySamples * utils.decaySamples; // r?
       state.b1 = utils.decaySamples * cos (state.freqPrime) * 2.0; // c? / cutoff?
@@ -16,6 +16,7 @@
 
 // TODO: Circular dependency issue:
 #include "ResonatorsTypes.h"
+#include "ResonatorKernels.h"
 
 class Resonator {
 public:
@@ -39,6 +40,9 @@ public:
     void update();
     void impulse (float impulse);
     float render (float excitation);
+    // render() for each frame, a few frames at a time where the processor
+    // allows (see ResonatorKernels::renderLookAhead()); in place if excitation == output
+    void render (const float* excitation, float* output, int frames);
     
     // get and set: main functions
     void setParam(void* theResonator, const int index, const float value);
@@ -50,6 +54,13 @@ public:
     void setParameters(ResonatorParams resParams);
     void setParameters(float _freq, float _gain, float _decay);
     const ResonatorParams getParameters();
+
+    // Coefficients as computed by update(), e.g. to bake them or restore them without recomputing
+    const ResonatorCoefficients getCoefficients();
+    void setCoefficients(ResonatorCoefficients coefficients);
+
+    // Amplitude the resonator is currently ringing at (as rendered), from its state
+    float getAmplitude();
     
 private:
     ResonatorOptions opt = {};
@@ -80,6 +91,7 @@ private:
         float out2;
     };
     RenderUtils renderUtils = {};
+    float lookAhead[ResonatorKernels::kLookAheadStride] = {};
     
     // private methods
     void setState();
@@ -100,8 +112,6 @@ private:
     
 };
 
-#endif /* Resonator_H_ */
-
 static inline float _map(float x, float in_min, float in_max, float out_min, float out_max)
 {
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
@@ -111,3 +121,5 @@ static inline float _min(float x, float y)
 {
     return (x < y)? x : y;
 }
+
+#endif /* Resonator_H_ */
@@ -6,6 +6,8 @@
  * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
  */
 
+#include <string.h>
+
 #include "ResonatorBank.h"
 
 ResonatorBank::ResonatorBank(){}
@@ -14,10 +16,13 @@ ResonatorBank::ResonatorBank(ResonatorBankOptions options, float sampleRate, flo
 }
 ResonatorBank::~ResonatorBank(){}
 
-void ResonatorBank::setup(ResonatorBankOptions options, float sampleRate, float framesPerBlock){
+void ResonatorBank::setup(ResonatorBankOptions options, float sampleRate, float framesPerBlock, ResonatorsArena *arena){
     opt = options;
     utils = setupResonatorUtils (sampleRate, framesPerBlock);
-    setupResonators();
+    setupResonators(arena);
+    _snapshotParams.resize(resBank.size());
+    _snapshotCoefficients.resize(resBank.size());
+    publishSnapshot();
 }
 
 ResonatorUtils ResonatorBank::setupResonatorUtils (float sampleRate, float framesPerBlock) {
@@ -32,48 +37,75 @@ ResonatorUtils ResonatorBank::setupResonatorUtils (float sampleRate, float frame
 }
 
 void ResonatorBank::setResonatorParam(const int resIndex, const int paramIndex, const float value) {
-    resBank[resIndex].setParameter(paramIndex, value);
+    float* values = getParamArray(paramIndex);
+    if (values == NULL) return;
+    values[resIndex] = value;
+    _snapshotDirty = true;
 }
 
 const float ResonatorBank::getResonatorParam(const int resIndex, const int paramIndex) {
-    return resBank[resIndex].getParameter(paramIndex);
+    float* values = getParamArray(paramIndex);
+    return (values != NULL) ? values[resIndex] : -1.0f;
 }
 
 void ResonatorBank::setResonator(const int index, const ResonatorParams params) {
-    resBank[index].setParameters(params); // &params?
+    ResonatorKernelData d = kernelData();
+    d.freq[index]  = params.freq;
+    d.gain[index]  = params.gain;
+    d.decay[index] = params.decay;
+    _snapshotDirty = true;
 }
 
 const ResonatorParams ResonatorBank::getResonator(const int index) {
-    return resBank[index].getParameters();
+    ResonatorKernelData d = kernelData();
+    ResonatorParams params = {d.freq[index], d.gain[index], d.decay[index]};
+    return params;
 }
 
-void ResonatorBank::setBank(std::vector<ResonatorParams> bankParams) {
-  for (int i = 0; i < opt.total; ++i) {
-    // rt_printf("setBank() %d\n", i);
-    setResonator(i, bankParams[i]);
+void ResonatorBank::setResonators(const ResonatorParamDelta* deltas, int length) {
+  for (int i = 0; i < length; ++i) {
+    int index = deltas[i].index;
+    if (index < 0 || index >= opt.total) continue;
+    if (deltas[i].mask & (1 << Resonator::kFreq))  setResonatorParam(index, Resonator::kFreq,  deltas[i].params.freq);
+    if (deltas[i].mask & (1 << Resonator::kGain))  setResonatorParam(index, Resonator::kGain,  deltas[i].params.gain);
+    if (deltas[i].mask & (1 << Resonator::kDecay)) setResonatorParam(index, Resonator::kDecay, deltas[i].params.decay);
+    updateResonator(index);
   }
 }
 
+void ResonatorBank::setBank(std::vector<ResonatorParams> const &bankParams) {
+  setBank(bankParams.data(), bankParams.size());
+}
+
+void ResonatorBank::setBank(const ResonatorParams* bankParams, int length) {
+  if (length > opt.total) length = opt.total;
+  for (int i = 0; i < length; ++i) setResonator(i, bankParams[i]);
+}
+
 const std::vector<float> ResonatorBank::getFreqs() {
   std::vector<float> freqs;
+  freqs.reserve(opt.total);
   for (int i = 0; i < opt.total; ++i) freqs.push_back(getResonatorParam(i, 0));
   return freqs;
 }
 
 const std::vector<float> ResonatorBank::getGains() {
   std::vector<float> gains;
+  gains.reserve(opt.total);
   for (int i = 0; i < opt.total; ++i) gains.push_back(getResonatorParam(i, 1));
   return gains;
 }
 
 const std::vector<float> ResonatorBank::getDecays() {
   std::vector<float> decays;
+  decays.reserve(opt.total);
   for (int i = 0; i < opt.total; ++i) decays.push_back(getResonatorParam(i, 2));
   return decays;
 }
 
 const std::vector<ResonatorParams> ResonatorBank::getBankAsParams() {
   std::vector<ResonatorParams> resBankParams;
+  resBankParams.reserve(opt.total);
   for (int i = 0; i < opt.total; ++i) resBankParams.push_back(getResonator(i));
   return resBankParams;
 }
@@ -86,40 +118,244 @@ const ResonatorParamVects ResonatorBank::getBankAsVects(){
   return resParamVects;
 }
 
+void ResonatorBank::getParams(const int paramIndex, float* values, int length) {
+  if (length > opt.total) length = opt.total;
+  for (int i = 0; i < length; ++i) values[i] = getResonatorParam(i, paramIndex);
+}
+
+void ResonatorBank::setParams(const int paramIndex, const float* values, int length) {
+  if (length > opt.total) length = opt.total;
+  for (int i = 0; i < length; ++i) setResonatorParam(i, paramIndex, values[i]);
+}
+
+void ResonatorBank::getCoefficients(ResonatorCoefficients* coefficients, int length) {
+  if (length > opt.total) length = opt.total;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < length; ++i) {
+    ResonatorCoefficients c = {d.a1[i], d.b1[i], d.b2[i], d.a1Prime[i]};
+    coefficients[i] = c;
+  }
+}
+
+void ResonatorBank::setCoefficients(const ResonatorCoefficients* coefficients, int length) {
+  if (length > opt.total) length = opt.total;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < length; ++i) {
+    d.a1[i]      = coefficients[i].a1;
+    d.b1[i]      = coefficients[i].b1;
+    d.b2[i]      = coefficients[i].b2;
+    d.a1Prime[i] = coefficients[i].a1Prime;
+  }
+  _snapshotDirty = true;
+}
+
+void ResonatorBank::getAmplitudes(float* amplitudes, int length) {
+  if (length > opt.total) length = opt.total;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < length; ++i) {
+    ResonatorCoefficients c = {d.a1[i], d.b1[i], d.b2[i], d.a1Prime[i]};
+    amplitudes[i] = getAmplitude(c, d.out1[i], d.out2[i], d.outGain);
+  }
+}
+
+float ResonatorBank::getAmplitude(ResonatorCoefficients const &coefficients, float out1, float out2, float outGain) {
+  // As Resonator::getAmplitude()
+  float r2 = -coefficients.b2;
+  if (r2 <= 0.0f) return 0.0f;
+  float r = sqrtf(r2);
+  float c = coefficients.b1 / (2.0f * r);
+  float s2 = 1.0f - c * c;
+  float y1 = out1;
+  float y2 = out2 * r;
+  if (s2 < 1e-6f) return fabsf(y1) * outGain;
+  float a2 = (y1 * y1 + y2 * y2 - 2.0f * c * y1 * y2) / s2;
+  return (a2 > 0.0f) ? sqrtf(a2) * outGain : 0.0f;
+}
+
+void ResonatorBank::getRenderState(ResonatorRenderState* states, int length) {
+  if (length > opt.total) length = opt.total;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < length; ++i) {
+    ResonatorRenderState state = {d.out1[i], d.out2[i], d.a1Prev[i], d.b1Prev[i], d.b2Prev[i]};
+    states[i] = state;
+  }
+}
+
+void ResonatorBank::setRenderState(const ResonatorRenderState* states, int length) {
+  if (length > opt.total) length = opt.total;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < length; ++i) {
+    d.out1[i]   = states[i].out1;
+    d.out2[i]   = states[i].out2;
+    d.a1Prev[i] = states[i].a1Prev;
+    d.b1Prev[i] = states[i].b1Prev;
+    d.b2Prev[i] = states[i].b2Prev;
+  }
+}
+
+void ResonatorBank::impulse(float amount){
+  // As Resonator::impulse()
+  if (amount >= 0.1) return;
+  ResonatorKernelData d = kernelData();
+  for (int i = 0; i < opt.total; ++i) d.out2[i] += d.a1Prime[i] * amount;
+}
+
 float ResonatorBank::renderResonator(int index, float excitation){
-  return resBank[index].render(excitation);
+  // As Resonator::render()
+  ResonatorKernelData d = kernelData();
+  float term1 = d.b1Prev[index] * d.out1[index];
+  float term2 = d.b2Prev[index] * d.out2[index];
+  float term3 = d.a1Prev[index] * excitation;
+  d.out2[index] = d.out1[index];
+  d.out1[index] = term1 + term2 + term3;
+  d.a1Prev[index] = d.a1[index];
+  d.b1Prev[index] = d.b1[index];
+  d.b2Prev[index] = d.b2[index];
+  return _min(d.out1[index] * d.outGain, utils.hardLimit);
 }
 
 float ResonatorBank::render(float excitation){
-  float out = 0.0f;
-  for (int i = 0; i < opt.total; ++i) 
-    out += renderResonator(i, excitation);
+  if (_snapshotDirty) publishSnapshot();
+  float out;
+  ResonatorKernels::render(kernelData(), opt.total, &excitation, &out, 1);
   return _min(out, utils.hardLimit);
 }
 
+void ResonatorBank::render(const float* excitation, float* output, int frames){
+  if (_snapshotDirty) publishSnapshot();
+  ResonatorKernels::render(kernelData(), opt.total, excitation, output, frames);
+  for (int n = 0; n < frames; ++n)
+    output[n] = _min(output[n], utils.hardLimit);
+}
+
+void ResonatorBank::render(ResonatorKernelMatrix const &matrix, const float* inputs, float* outputs, int frames){
+  if (_snapshotDirty) publishSnapshot();
+  ResonatorKernels::renderMatrix(kernelData(), opt.total, matrix, inputs, outputs, frames);
+  for (int n = 0; n < frames * matrix.outputs; ++n)
+    outputs[n] = _min(outputs[n], utils.hardLimit);
+}
+
 void ResonatorBank::update(){
-  for (int i = 0; i < opt.total; ++i) resBank[i].update();
+  ResonatorKernels::update(kernelData(), 0, opt.total);
+  _snapshotDirty = true;
+}
+
+void ResonatorBank::update(int begin, int end){
+  if (begin < 0) begin = 0;
+  if (end > opt.total) end = opt.total;
+  if (begin >= end) return;
+  ResonatorKernels::update(kernelData(), begin, end);
+  _snapshotDirty = true;
+}
+
+void ResonatorBank::updateResonator(int index){
+  ResonatorKernels::update(kernelData(), index, index + 1);
+  _snapshotDirty = true;
+}
+
+bool ResonatorBank::getSnapshot(ResonatorBankSnapshot &snapshot, int retries){
+  for (int attempt = 0; attempt <= retries; ++attempt) {
+    unsigned int before = _snapshotSequence.value.load(std::memory_order_acquire);
+    if (before & 1) continue; // being published
+
+    int size = _snapshotSize;
+    if (size < 0 || size > (int) _snapshotParams.size()) continue;
+    snapshot.params.resize(size);
+    snapshot.coefficients.resize(size);
+    for (int i = 0; i < size; ++i) {
+      snapshot.params[i]       = _snapshotParams[i];
+      snapshot.coefficients[i] = _snapshotCoefficients[i];
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_snapshotSequence.value.load(std::memory_order_relaxed) == before) {
+      snapshot.size = size;
+      snapshot.version = before / 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ResonatorBank::publishSnapshot(){
+  unsigned int sequence = _snapshotSequence.value.load(std::memory_order_relaxed);
+  _snapshotSequence.value.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  _snapshotSize = (opt.total < (int) _snapshotParams.size()) ? opt.total : _snapshotParams.size();
+  getCoefficients(_snapshotCoefficients.data(), _snapshotSize);
+  for (int i = 0; i < _snapshotSize; ++i) _snapshotParams[i] = getResonator(i);
+
+  _snapshotSequence.value.store(sequence + 2, std::memory_order_release);
+  _snapshotDirty = false;
 }
 
 void ResonatorBank::setOptions (ResonatorBankOptions _options) {
   if (_options.total > opt.maxSize) {
     _options.total = opt.maxSize;
   }
+  if (_options.total > resBank.size()) _options.total = resBank.size();
   opt = _options;
+  _snapshotDirty = true;
 }
 
 void ResonatorBank::setSize (int _total) {
-  if (_total <= opt.maxSize) opt.total = _total;
+  // Never beyond the resonators created in setup()
+  if (_total <= opt.maxSize && _total <= (int) resBank.size()) opt.total = _total;
+  _snapshotDirty = true;
 }
 
 // private methods
-void ResonatorBank::setupResonators(){
+void ResonatorBank::setupResonators(ResonatorsArena *arena){
   if (opt.v) printf ("[ResonatorBank] Initialising bank of %d\n", opt.total);
   opt.updateRTRate *= (utils.sampleRate / 1000.0);
-  for (int i = 0; i < opt.total; ++i) {
-    Resonator res;
-    res.setup (opt.resOpt, utils.sampleRate, utils.framesPerBlock);
-    resBank.push_back (res);
+  ResonatorKernels::getInfo(); // chooses the kernels, if nothing has yet
+  int stride = getStride(opt.total);
+  size_t size = getBlockSize(stride);
+  resBank.owned.clear();
+  resBank.block = (arena != NULL) ? (float*) arena->allocate(size * sizeof(float)) : NULL;
+  resBank.capacity = opt.total;
+  resBank.stride = stride;
+  if (resBank.block == NULL) {
+    if (arena != NULL) printf ("[ResonatorBank] setup() Warning: arena is full, allocating %d resonators on the heap\n", opt.total);
+    resBank.owned.resize(size);
+    resBank.block = resBank.owned.data();
   }
+  memset(resBank.block, 0, size * sizeof(float));
+}
+
+ResonatorKernelData ResonatorBank::kernelData(){
+  float *block = resBank.block;
+  int stride = resBank.stride;
+  ResonatorKernelData d;
+  d.freq    = block;
+  d.gain    = block + stride;
+  d.decay   = block + 2 * stride;
+  d.a1      = block + 3 * stride;
+  d.b1      = block + 4 * stride;
+  d.b2      = block + 5 * stride;
+  d.a1Prime = block + 6 * stride;
+  d.a1Prev  = block + 7 * stride;
+  d.b1Prev  = block + 8 * stride;
+  d.b2Prev  = block + 9 * stride;
+  d.out1    = block + 10 * stride;
+  d.out2    = block + 11 * stride;
+  d.lookAhead = block + ResonatorKernels::kFields * stride;
+  d.outGain        = opt.resOpt.outGain;
+  d.hardLimit      = utils.hardLimit;
+  d.sampleInterval = utils.sampleInterval;
+  d.nyquistLimit   = utils.nyquistLimit;
+  d.twoPi          = utils.M_2PI;
+  return d;
 }
 
+float* ResonatorBank::getParamArray(const int paramIndex){
+  ResonatorKernelData d = kernelData();
+  switch (paramIndex) {
+    case Resonator::kFreq :  return d.freq;
+    case Resonator::kGain :  return d.gain;
+    case Resonator::kDecay : return d.decay;
+  }
+  printf("[ResonatorBank] Invalid Parameter Requested.\n");
+  return NULL;
+}
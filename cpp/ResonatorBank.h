@@ -11,10 +11,14 @@
 
 #include <cmath>
 #include <stdio.h>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <string> 
 
 #include "Resonator.h"
+#include "ResonatorKernels.h"
+#include "ResonatorsArena.h"
 
 class ResonatorBank {
 public:
@@ -22,7 +26,10 @@ public:
     ResonatorBank(ResonatorBankOptions options, float sampleRate, float framesPerBlock);
     ~ResonatorBank();
     
-    void setup(ResonatorBankOptions options, float sampleRate, float framesPerBlock);
+    // With an arena, the resonators are placed in it (see ResonatorsArena.h),
+    // falling back to the heap if it is full
+    void setup(ResonatorBankOptions options, float sampleRate, float framesPerBlock, ResonatorsArena *arena = NULL);
+    static size_t getArenaSize(ResonatorBankOptions const &options) { return ResonatorsArena::align(getBlockSize(getStride(options.total)) * sizeof(float)); }
 
     ResonatorUtils setupResonatorUtils (float sampleRate, float framesPerBlock);
 
@@ -30,31 +37,109 @@ public:
     const float getResonatorParam(const int resIndex, const int paramIndex);
     void setResonator(const int index, const ResonatorParams params);
     const ResonatorParams getResonator(const int index);
-    void setResonators(std::vector<int> indexes, const ResonatorParamVects paramVects){
+    void setResonators(std::vector<int> const &indexes, ResonatorParamVects const &paramVects){
         // TODO: Implement setting groups of resonators (process as vectorised groups of 4?)
     }
+    // Apply a batch of changes and recompute only the resonators they touch
+    void setResonators(const ResonatorParamDelta* deltas, int length);
     const std::vector<float> getFreqs();
     const std::vector<float> getGains();
     const std::vector<float> getDecays();
-    void setBank(std::vector<ResonatorParams> bankParams);
+    void setBank(std::vector<ResonatorParams> const &bankParams);
+    void setBank(const ResonatorParams* bankParams, int length);
     const std::vector<ResonatorParams> getBankAsParams();
     const ResonatorParamVects getBankAsVects();
 
+    // Array access to a single parameter (Resonator::kFreq, kGain or kDecay)
+    // across the bank, e.g. for binding to NumPy arrays without copies
+    void getParams(const int paramIndex, float* values, int length);
+    void setParams(const int paramIndex, const float* values, int length);
+
+    // Coefficients for the whole bank, e.g. baked into a binary model (ModelBinary.h)
+    void getCoefficients(ResonatorCoefficients* coefficients, int length);
+    void setCoefficients(const ResonatorCoefficients* coefficients, int length);
+
+    // Current amplitude of each resonator, e.g. for metering (see ResonatorsTelemetry.h)
+    void getAmplitudes(float* amplitudes, int length);
+    static float getAmplitude(ResonatorCoefficients const &coefficients, float out1, float out2, float outGain);
+
+    // Render state of the whole bank, to hand it to another renderer and
+    // back without a discontinuity (see ResonatorLanes.h)
+    void getRenderState(ResonatorRenderState* states, int length);
+    void setRenderState(const ResonatorRenderState* states, int length);
+
+    // The getters above read the live bank, so only the thread that changes
+    // it should use them. Other threads (GUI, monitoring, preset saving) can
+    // read a consistent snapshot of the bank as of the last rendered sample
+    // instead: changes are published by render() (or publishSnapshot()) under
+    // a sequence lock, so the audio thread never waits for readers. Returns
+    // false if the bank kept changing while it was being read.
+    bool getSnapshot(ResonatorBankSnapshot &snapshot, int retries = 16);
+    unsigned int getSnapshotVersion() { return _snapshotSequence.value.load(std::memory_order_acquire) / 2; }
+    void publishSnapshot();
+    // For banks that are not rendered themselves (e.g. see ResonatorConvolver.h)
+    void publishChanges() { if (_snapshotDirty) publishSnapshot(); }
+
     ResonatorBankOptions getOptions() { return opt; }
     void setOptions (ResonatorBankOptions _options);
     void setSize (int _total);
+    int getSize() { return opt.total; }
     
+    // Resonator::impulse() for every resonator
+    void impulse(float amount);
     float renderResonator(int index, float excitation);
     float render(float excitation);    
+    void render(const float* excitation, float* output, int frames); // in-place if excitation == output
+    // Fed and read through gain matrices (see ResonatorBankMIMO.h), interleaved frames
+    void render(ResonatorKernelMatrix const &matrix, const float* inputs, float* outputs, int frames);
     void update();
+    void update(int begin, int end); // resonators [begin, end), in one pass
+    void updateResonator(int index);
 
 private:
     ResonatorBankOptions opt = {};
     ResonatorUtils utils = {};
     
-    std::vector<Resonator> resBank;
+    // The resonators are stored one array per field (see ResonatorKernels.h),
+    // `stride` floats apart, in an arena if the bank was set up with one and
+    // otherwise in `owned`; a copy of a bank always owns its resonators
+    struct Storage {
+        float* block;
+        int capacity;
+        int stride;
+        std::vector<float> owned;
+        Storage() : block(NULL), capacity(0), stride(0) {}
+        Storage(const Storage &other) : block(NULL), capacity(0), stride(0) { copy(other); }
+        Storage& operator=(const Storage &other) { if (this != &other) copy(other); return *this; }
+        void copy(const Storage &other) {
+            owned.assign(getBlockSize(other.stride), 0.0f);
+            if (other.block != NULL) std::copy(other.block, other.block + owned.size(), owned.begin());
+            block = owned.data();
+            capacity = other.capacity;
+            stride = other.stride;
+        }
+        int size() const { return capacity; }
+    };
+    Storage resBank;
+    ResonatorKernelData kernelData();
+    static int getStride(int capacity) { return (capacity + 15) & ~15; } // whole cache lines, and whole registers for the kernels
+    static size_t getBlockSize(int stride) { return ResonatorKernels::kFields * stride + ResonatorKernels::kLookAheadSize; } // the fields, then the look-ahead table
+
+    // std::atomic is not copyable, but banks are copied (e.g. into vectors) before they run
+    struct Sequence {
+        std::atomic<unsigned int> value;
+        Sequence() : value(0) {}
+        Sequence(const Sequence &other) : value(other.value.load()) {}
+        Sequence& operator=(const Sequence &other) { value.store(other.value.load()); return *this; }
+    };
+    Sequence _snapshotSequence; // odd while publishing
+    bool _snapshotDirty = true;
+    int _snapshotSize = 0;
+    std::vector<ResonatorParams> _snapshotParams;
+    std::vector<ResonatorCoefficients> _snapshotCoefficients;
     
-    void setupResonators();
+    void setupResonators(ResonatorsArena *arena);
+    float* getParamArray(const int paramIndex);
     
 };
 
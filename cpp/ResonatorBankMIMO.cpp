@@ -0,0 +1,69 @@
+/*
+ * Resonators
+ * ResonatorBankMIMO
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include "ResonatorBankMIMO.h"
+
+ResonatorBankMIMO::ResonatorBankMIMO(){}
+ResonatorBankMIMO::~ResonatorBankMIMO(){}
+
+bool ResonatorBankMIMO::setup(ResonatorBankMIMOOptions options, ResonatorBankOptions bankOptions, float sampleRate, float framesPerBlock, ResonatorsArena *arena){
+  const int maxPorts = ResonatorKernels::kMaxPorts;
+  if (options.inputs < 1 || options.inputs > maxPorts || options.outputs < 1 || options.outputs > maxPorts) {
+    printf("[ResonatorBankMIMO] setup() Error: %d inputs and %d outputs, 1 to %d each\n", options.inputs, options.outputs, maxPorts);
+    return false;
+  }
+  _opt = options;
+  _bank.setup(bankOptions, sampleRate, framesPerBlock, arena);
+
+  // Padded with zeros to whole registers, for the kernels to read whole
+  const int width = ResonatorKernels::kMaxWidth;
+  _stride = (bankOptions.total + width - 1) / width * width;
+  _inputGains.assign(_opt.inputs * _stride, 0.0f);
+  _outputGains.assign(_opt.outputs * _stride, 0.0f);
+  for (int i = 0; i < _opt.inputs; ++i)
+    std::fill(_inputGains.begin() + i * _stride, _inputGains.begin() + i * _stride + bankOptions.total, 1.0f);
+  for (int o = 0; o < _opt.outputs; ++o)
+    std::fill(_outputGains.begin() + o * _stride, _outputGains.begin() + o * _stride + bankOptions.total, 1.0f);
+
+  if (_opt.v) printf("[ResonatorBankMIMO] %d resonators, %d inputs, %d outputs\n", bankOptions.total, _opt.inputs, _opt.outputs);
+  return true;
+}
+
+void ResonatorBankMIMO::setInputGains(int input, const float* gains, int length){
+  if (input < 0 || input >= _opt.inputs) return;
+  if (length > _bank.getSize()) length = _bank.getSize();
+  std::copy(gains, gains + length, _inputGains.begin() + input * _stride);
+}
+
+void ResonatorBankMIMO::setOutputGains(int output, const float* gains, int length){
+  if (output < 0 || output >= _opt.outputs) return;
+  if (length > _bank.getSize()) length = _bank.getSize();
+  std::copy(gains, gains + length, _outputGains.begin() + output * _stride);
+}
+
+void ResonatorBankMIMO::setInputPosition(int input, float position){
+  if (input >= 0 && input < _opt.inputs) setPosition(&_inputGains[input * _stride], position);
+}
+
+void ResonatorBankMIMO::setOutputPosition(int output, float position){
+  if (output >= 0 && output < _opt.outputs) setPosition(&_outputGains[output * _stride], position);
+}
+
+void ResonatorBankMIMO::render(const float* inputs, float* outputs, int frames){
+  ResonatorKernelMatrix matrix = {_inputGains.data(), _opt.inputs, _outputGains.data(), _opt.outputs, _stride};
+  _bank.render(matrix, inputs, outputs, frames);
+}
+
+// private methods
+
+void ResonatorBankMIMO::setPosition(float* gains, float position){
+  const float pi = 3.14159265358979f;
+  int size = _bank.getSize();
+  for (int m = 0; m < size; ++m) gains[m] = sinf((m + 1) * pi * position);
+}
@@ -0,0 +1,76 @@
+/*
+ * Resonators
+ * ResonatorBankMIMO
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorBankMIMO_H_
+#define ResonatorBankMIMO_H_
+
+#include <vector>
+
+#include "ResonatorBank.h"
+
+// One bank with several inputs and outputs: several strike positions or
+// sensors on one instrument, and several pickups or a stereo spread, all
+// sharing one set of resonators rather than a bank each. Input i excites
+// resonator m by getInputGain(i, m), and output o hears resonator m by
+// getOutputGain(o, m); every gain is 1 until set, which is the bank
+// rendered on its own. Positions along an ideal string or bar give gains
+// from the shapes of its modes.
+//
+//   mimo.setup(mimoOptions, bankOptions, context->audioSampleRate, context->audioFrames);
+//   mimo.getBank().setBank(model.getModel());
+//   mimo.getBank().update();
+//   mimo.setInputPosition(0, 0.1f); // near the edge
+//   mimo.setInputPosition(1, 0.5f); // in the middle
+//   mimo.render(inputs, outputs, context->audioFrames); // in render(), interleaved frames
+
+typedef struct _ResonatorBankMIMOOptions {
+    int inputs = 2; // up to ResonatorKernels::kMaxPorts
+    int outputs = 2; // up to ResonatorKernels::kMaxPorts
+    bool v = true; // verbose printing
+} ResonatorBankMIMOOptions;
+
+class ResonatorBankMIMO {
+public:
+    ResonatorBankMIMO();
+    ~ResonatorBankMIMO();
+
+    bool setup(ResonatorBankMIMOOptions options, ResonatorBankOptions bankOptions, float sampleRate, float framesPerBlock, ResonatorsArena *arena = NULL);
+
+    // The resonators, to set up and change as any bank
+    ResonatorBank& getBank() { return _bank; }
+    int getInputs() { return _opt.inputs; }
+    int getOutputs() { return _opt.outputs; }
+
+    // Gains per resonator, for the first `length` resonators; the rest keep theirs
+    void setInputGains(int input, const float* gains, int length);
+    void setOutputGains(int output, const float* gains, int length);
+    float getInputGain(int input, int resIndex) { return _inputGains[input * _stride + resIndex]; }
+    float getOutputGain(int output, int resIndex) { return _outputGains[output * _stride + resIndex]; }
+    // Resonator m taken as mode m + 1 of an ideal string or simply supported
+    // bar, position 0-1 along it: gain sin((m + 1) pi position)
+    void setInputPosition(int input, float position);
+    void setOutputPosition(int output, float position);
+
+    // Audio thread: frames of getInputs() interleaved inputs, and of
+    // getOutputs() interleaved outputs. Not in place. Gains changed between
+    // calls apply from the next call.
+    void render(const float* inputs, float* outputs, int frames);
+
+private:
+    ResonatorBankMIMOOptions _opt = {};
+    ResonatorBank _bank;
+    int _stride = 0; // the bank's capacity, in whole registers
+    std::vector<float> _inputGains; // _opt.inputs rows of _stride
+    std::vector<float> _outputGains; // _opt.outputs rows of _stride
+
+    void setPosition(float* gains, float position);
+
+};
+
+#endif /* ResonatorBankMIMO_H_ */
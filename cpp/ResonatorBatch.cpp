@@ -0,0 +1,122 @@
+/*
+ * Resonators
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include "ResonatorBatch.h"
+
+ResonatorBatch::ResonatorBatch(){
+  _nextJob.store(0);
+}
+ResonatorBatch::ResonatorBatch(float sampleRate, int threads){
+  _nextJob.store(0);
+  setup(sampleRate, threads);
+}
+ResonatorBatch::~ResonatorBatch(){ cleanup(); }
+
+void ResonatorBatch::setup(float sampleRate, int threads){
+  cleanup();
+  _sampleRate = sampleRate;
+  if (threads <= 0) threads = std::thread::hardware_concurrency();
+  _threads = (threads > 0) ? threads : 1;
+
+  _running = true;
+  _workers.reserve(_threads - 1);
+  for (int i = 1; i < _threads; ++i) _workers.push_back(std::thread(&ResonatorBatch::run, this, _generation));
+}
+
+void ResonatorBatch::cleanup(){
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _wake.notify_all();
+  for (unsigned int i = 0; i < _workers.size(); ++i) _workers[i].join();
+  _workers.clear();
+}
+
+int ResonatorBatch::addJob(ModelLoader &model, std::string pitch){
+  bool v = model.getVerbose();
+  model.setVerbose(false); // one line per job is too much for thousands of jobs
+  _jobs.push_back(model.getShiftedToNote(pitch));
+  model.setVerbose(v);
+  return _jobs.size() - 1;
+}
+
+int ResonatorBatch::addJob(ModelLoader &model, float freq){
+  bool v = model.getVerbose();
+  model.setVerbose(false);
+  _jobs.push_back(model.getShiftedToFreq(freq));
+  model.setVerbose(v);
+  return _jobs.size() - 1;
+}
+
+void ResonatorBatch::clear(){
+  _jobs.clear();
+}
+
+void ResonatorBatch::render(const float* excitations, float* outputs, int frames){
+  _excitations = excitations;
+  _outputs = outputs;
+  _frames = frames;
+  _nextJob.store(0);
+
+  // A single job, or no workers, is not worth waking anyone for
+  bool wake = !_workers.empty() && _jobs.size() > 1;
+  if (wake) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _busy = _workers.size();
+  }
+  if (wake) _wake.notify_all();
+
+  takeJobs(); // the calling thread takes jobs too
+
+  if (wake) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this]() { return _busy == 0; });
+  }
+}
+
+// private methods
+void ResonatorBatch::run(unsigned int generation){
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wake.wait(lock, [&]() { return !_running || _generation != generation; });
+      if (!_running) return;
+      generation = _generation;
+    }
+    takeJobs();
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      last = (--_busy == 0);
+    }
+    if (last) _done.notify_one();
+  }
+}
+
+void ResonatorBatch::takeJobs(){
+  int totalJobs = _jobs.size();
+  for (int j = _nextJob++; j < totalJobs; j = _nextJob++)
+    renderJob(j, _excitations + (size_t) j * _frames, _outputs + (size_t) j * _frames, _frames);
+}
+
+void ResonatorBatch::renderJob(int index, const float* excitation, float* output, int frames){
+  std::vector<ResonatorParams> &params = _jobs[index];
+
+  ResonatorBankOptions opt = {};
+  opt.v       = false;
+  opt.total   = params.size();
+  opt.maxSize = params.size();
+
+  ResonatorBank bank;
+  bank.setup(opt, _sampleRate, frames);
+  bank.setBank(params);
+  bank.update();
+  bank.render(excitation, output, frames);
+}
@@ -0,0 +1,71 @@
+/*
+ * Resonators
+ * https://github.com/jarmitage/resonators
+ * 
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorBatch_H_
+#define ResonatorBatch_H_
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "ResonatorBank.h"
+#include "ModelLoader.h"
+
+// Offline rendering of many model/pitch/excitation jobs, spread over a set of
+// worker threads. Each job gets its own ResonatorBank, so jobs are independent
+// and render() needs no locking beyond handing out job indexes. The workers
+// are started by setup() and wait between calls, so many small render() calls
+// don't each pay for starting threads.
+
+class ResonatorBatch {
+public:
+    ResonatorBatch();
+    ResonatorBatch(float sampleRate, int threads = 0);
+    ~ResonatorBatch();
+
+    void setup(float sampleRate, int threads = 0); // threads <= 0: one per core
+    void cleanup(); // stops the workers; setup() starts them again
+
+    int addJob(ModelLoader &model, std::string pitch);
+    int addJob(ModelLoader &model, float freq);
+    void clear();
+    int getSize() { return _jobs.size(); }
+    int getThreads() { return _threads; }
+
+    // `excitations` and `outputs` hold `frames` samples per job, job after job
+    void render(const float* excitations, float* outputs, int frames);
+
+private:
+    float _sampleRate = 44100.0f;
+    int   _threads = 1;
+    std::vector<std::vector<ResonatorParams>> _jobs;
+
+    // The calling thread and _threads - 1 workers take jobs from _nextJob
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    bool _running = false;
+    unsigned int _generation = 0; // one per render() call
+    int _busy = 0; // workers still on this call's jobs
+    std::atomic<int> _nextJob;
+    const float* _excitations = NULL;
+    float* _outputs = NULL;
+    int _frames = 0;
+
+    void run(unsigned int generation);
+    void takeJobs();
+    void renderJob(int index, const float* excitation, float* output, int frames);
+
+};
+
+#endif /* ResonatorBatch_H_ */
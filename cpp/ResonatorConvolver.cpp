@@ -0,0 +1,223 @@
+/*
+ * Resonators
+ * ResonatorConvolver
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+#include <chrono>
+#include <cmath>
+
+#include "ResonatorConvolver.h"
+
+ResonatorConvolver::ResonatorConvolver() : _mailbox(NULL), _running(false), _builds(0) {}
+ResonatorConvolver::~ResonatorConvolver(){ cleanup(); }
+
+bool ResonatorConvolver::setup(ResonatorBank &bank, float sampleRate, ResonatorConvolverOptions options){
+  cleanup();
+  int size = options.partitionSize;
+  if (size < 4 || (size & (size - 1)) != 0) {
+    printf("[ResonatorConvolver] setup() Error: partition size %d is not a power of two of at least 4\n", size);
+    return false;
+  }
+  _opt = options;
+  _bank = &bank;
+  _bank->publishChanges(); // build from the bank as it is now
+  _sampleRate = sampleRate;
+  _fft.setup(2 * size);
+  _bins = size + 1;
+  _maxPartitions = (int) ceil(_opt.maxLength * sampleRate / size);
+  if (_maxPartitions < 1) _maxPartitions = 1;
+
+  _slots.reset(new Slot[kSlots]);
+  for (int i = 0; i < kSlots; ++i) {
+    _slots[i].state.store(kFree);
+    _slots[i].length = 0;
+    _slots[i].partitions = 0;
+    _slots[i].re.assign(_maxPartitions * _bins, 0.0f);
+    _slots[i].im.assign(_maxPartitions * _bins, 0.0f);
+  }
+  _mailbox.store(NULL);
+  _current = NULL;
+
+  _input.assign(2 * size, 0.0f);
+  _output.assign(size, 0.0f);
+  _delayRe.assign(_maxPartitions * _bins, 0.0f);
+  _delayIm.assign(_maxPartitions * _bins, 0.0f);
+  _sumRe.assign(_bins, 0.0f);
+  _sumIm.assign(_bins, 0.0f);
+  _time.assign(2 * size, 0.0f);
+  _fade.assign(size, 0.0f);
+  _position = 0;
+  _head = 0;
+
+  if (_opt.v) printf("[ResonatorConvolver] Up to %d partitions of %d samples\n", _maxPartitions, size);
+
+  _builds.store(0);
+  _running = true;
+  _thread = std::thread(&ResonatorConvolver::run, this);
+  return true;
+}
+
+void ResonatorConvolver::cleanup(){
+  _running = false;
+  if (_thread.joinable()) _thread.join();
+}
+
+void ResonatorConvolver::render(const float* input, float* output, int frames){
+  for (int n = 0; n < frames; ++n)
+    output[n] = render(input[n]);
+}
+
+float ResonatorConvolver::render(float in){
+  if (_bins == 0) return 0.0f;
+  float out = _output[_position];
+  _input[_opt.partitionSize + _position] = in;
+  if (++_position == _opt.partitionSize) {
+    _position = 0;
+    processPartition();
+  }
+  return _min(out, _hardLimit);
+}
+
+int ResonatorConvolver::getCrossover(int partitionSize, int length){
+  // Operations per partition: a forward and an inverse real FFT of twice the
+  // partition size (about 2.5 N log2 N each), and a complex multiply-add per
+  // bin and partition of the response. The recursive form costs about 8 per
+  // resonator and sample.
+  double n = 2.0 * partitionSize;
+  double partitions = ceil((double) length / partitionSize);
+  double perPartition = 2.0 * 2.5 * n * log2(n) + partitions * (partitionSize + 1) * 8.0;
+  return (int) ceil(perPartition / partitionSize / 8.0);
+}
+
+// private methods
+void ResonatorConvolver::processPartition(){
+  int size = _opt.partitionSize;
+  _bank->publishChanges(); // so that the builder sees changes to a bank nobody renders
+
+  Slot *next = (_mailbox.load(std::memory_order_relaxed) != NULL) ? _mailbox.exchange(NULL, std::memory_order_acq_rel) : NULL;
+  Slot *previous = _current;
+  if (next != NULL) _current = next;
+
+  _fft.forward(_input.data(), &_delayRe[_head * _bins], &_delayIm[_head * _bins]);
+  if (_current != NULL) convolve(*_current, _output.data());
+
+  // Crossfade from the previous response over one partition
+  if (next != NULL && previous != NULL) {
+    convolve(*previous, _fade.data());
+    for (int n = 0; n < size; ++n) {
+      float t = (float) (n + 1) / size;
+      _output[n] = _fade[n] + t * (_output[n] - _fade[n]);
+    }
+    previous->state.store(kFree, std::memory_order_release);
+  }
+
+  memcpy(_input.data(), _input.data() + size, size * sizeof(float));
+  if (++_head == _maxPartitions) _head = 0;
+}
+
+void ResonatorConvolver::convolve(Slot const &slot, float* output){
+  float *sumRe = _sumRe.data(), *sumIm = _sumIm.data();
+  memset(sumRe, 0, _bins * sizeof(float));
+  memset(sumIm, 0, _bins * sizeof(float));
+
+  // Newest input partition with the first response partition, and so on back
+  for (int p = 0; p < slot.partitions; ++p) {
+    int index = _head - p;
+    if (index < 0) index += _maxPartitions;
+    const float *xr = &_delayRe[index * _bins], *xi = &_delayIm[index * _bins];
+    const float *hr = &slot.re[p * _bins],      *hi = &slot.im[p * _bins];
+    for (int k = 0; k < _bins; ++k) {
+      sumRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+      sumIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+  }
+
+  // Overlap-save: only the second half is free of circular wrap-around
+  _fft.inverse(sumRe, sumIm, _time.data());
+  memcpy(output, _time.data() + _opt.partitionSize, _opt.partitionSize * sizeof(float));
+}
+
+void ResonatorConvolver::run(){
+  int size = _opt.partitionSize;
+  FFT fft;
+  fft.setup(2 * size);
+  std::vector<float> response(_maxPartitions * size);
+  std::vector<float> time(2 * size);
+  int maxSize = _bank->getOptions().maxSize;
+  float outGain = _bank->getOptions().resOpt.outGain;
+  ResonatorBankSnapshot snapshot;
+  snapshot.params.reserve(maxSize);
+  snapshot.coefficients.reserve(maxSize);
+
+  bool built = false;
+  unsigned int builtVersion = 0;
+  while (_running) {
+    if (!built || _bank->getSnapshotVersion() != builtVersion) {
+      Slot *slot = NULL;
+      for (int i = 0; i < kSlots && slot == NULL; ++i) {
+        int expected = kFree;
+        if (_slots[i].state.compare_exchange_strong(expected, kFilling, std::memory_order_acquire)) slot = &_slots[i];
+      }
+      if (slot != NULL && _bank->getSnapshot(snapshot)) {
+        build(snapshot, outGain, *slot, fft, response, time);
+        built = true;
+        builtVersion = snapshot.version;
+
+        // Post to the mailbox; a response the audio thread never picked up is recycled
+        slot->state.store(kReady, std::memory_order_release);
+        Slot *stale = _mailbox.exchange(slot, std::memory_order_acq_rel);
+        if (stale != NULL) stale->state.store(kFree, std::memory_order_release);
+        _builds.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.v) printf("[ResonatorConvolver] Built a response of %d samples from %d resonators\n", slot->length, snapshot.size);
+      }
+      else if (slot != NULL) {
+        slot->state.store(kFree, std::memory_order_release);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(_opt.pollInterval));
+  }
+}
+
+void ResonatorConvolver::build(ResonatorBankSnapshot const &snapshot, float outGain, Slot &slot, FFT &fft, std::vector<float> &response, std::vector<float> &time){
+  int size = _opt.partitionSize;
+
+  // Long enough for the slowest resonator to decay by `threshold`; the pole
+  // radius r = sqrt(-b2), so the envelope falls by r per sample
+  float slowest = 0.0f;
+  for (int i = 0; i < snapshot.size; ++i)
+    if (-snapshot.coefficients[i].b2 > slowest) slowest = -snapshot.coefficients[i].b2;
+  int maxLength = _maxPartitions * size;
+  int length = maxLength;
+  if (slowest < 1.0f) {
+    double samples = (slowest > 0.0f) ? log(_opt.threshold) / (0.5 * log(slowest)) : 0.0;
+    if (samples + 2 < maxLength) length = (int) samples + 2;
+  }
+
+  // The impulse response, as Resonator::render() computes it
+  int partitions = (length + size - 1) / size;
+  memset(response.data(), 0, partitions * size * sizeof(float));
+  for (int i = 0; i < snapshot.size; ++i) {
+    ResonatorCoefficients const &c = snapshot.coefficients[i];
+    float y1 = 0.0f, y2 = 0.0f;
+    for (int n = 0; n < length; ++n) {
+      float y = c.b1 * y1 + c.b2 * y2 + ((n == 0) ? c.a1 : 0.0f);
+      response[n] += y * outGain;
+      y2 = y1;
+      y1 = y;
+    }
+  }
+
+  // Zero-padded to twice the partition size, for overlap-save
+  for (int p = 0; p < partitions; ++p) {
+    memcpy(time.data(), &response[p * size], size * sizeof(float));
+    memset(time.data() + size, 0, size * sizeof(float));
+    fft.forward(time.data(), &slot.re[p * _bins], &slot.im[p * _bins]);
+  }
+  slot.length = length;
+  slot.partitions = partitions;
+}
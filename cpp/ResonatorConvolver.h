@@ -0,0 +1,115 @@
+/*
+ * Resonators
+ * ResonatorConvolver
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorConvolver_H_
+#define ResonatorConvolver_H_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "FFT.h"
+#include "ResonatorBank.h"
+
+// Renders a bank through its impulse response instead of resonator by
+// resonator, for very large banks (modal reverbs, dense gong models) whose
+// parameters rarely change. The response is computed from the bank's
+// coefficients and convolved with uniformly partitioned overlap-save FFT
+// convolution, so the cost per sample depends on the length of the response
+// and not on the number of resonators; above getCrossover() resonators it is
+// the cheaper way to render a bank.
+//
+// A background thread watches the bank's snapshots (see
+// ResonatorBank::getSnapshot()) and rebuilds the response whenever the bank
+// changes; the audio thread picks the new response up at the next partition
+// boundary and crossfades to it over one partition. The output is delayed by
+// getLatency() samples, one partition.
+//
+//   convolver.setup(res.getBank(0), context->audioSampleRate); // the bank itself is not rendered
+//   convolver.render(input, output, context->audioFrames);   // in render()
+
+typedef struct _ResonatorConvolverOptions {
+    int partitionSize = 256; // samples, a power of two; also the latency
+    float maxLength = 4.0f; // longest response in seconds
+    float threshold = 1e-5f; // level at which the response is cut off (-100 dB)
+    int pollInterval = 10; // ms between checks for changes to the bank
+    bool v = true; // verbose printing
+} ResonatorConvolverOptions;
+
+class ResonatorConvolver {
+public:
+    ResonatorConvolver();
+    ~ResonatorConvolver();
+
+    bool setup(ResonatorBank &bank, float sampleRate, ResonatorConvolverOptions options = ResonatorConvolverOptions());
+    void cleanup();
+
+    // Audio thread; silent until the first response has been built.
+    // In place if input == output.
+    void render(const float* input, float* output, int frames);
+    float render(float in);
+
+    bool isReady() { return _current != NULL; }
+    int getLength() { return (_current != NULL) ? _current->length : 0; } // audio thread
+    int getLatency() { return _opt.partitionSize; }
+    unsigned int getBuilds() { return _builds.load(std::memory_order_relaxed); }
+
+    // Resonators above which convolving a response of `length` samples takes
+    // fewer operations per sample than the recursive form. An estimate:
+    // measure on the target to choose between them.
+    static int getCrossover(int partitionSize, int length);
+
+private:
+    enum SlotState { kFree, kFilling, kReady };
+
+    // One impulse response, as the spectra of its partitions
+    struct Slot {
+        std::atomic<int> state;
+        int length;
+        int partitions;
+        std::vector<float> re, im; // partition after partition, _bins each
+    };
+    static const int kSlots = 3; // being built, waiting, in use
+
+    ResonatorConvolverOptions _opt = {};
+    ResonatorBank* _bank = NULL;
+    float _sampleRate = 44100.0f;
+    float _hardLimit = ResonatorUtils().hardLimit;
+    int _bins = 0;
+    int _maxPartitions = 0;
+    FFT _fft; // audio thread
+
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<Slot*> _mailbox;
+    Slot* _current = NULL;
+
+    // Audio thread: input and output of the partition being collected, and
+    // the spectra of past input partitions (the frequency-domain delay line)
+    std::vector<float> _input; // previous and current partition
+    std::vector<float> _output;
+    std::vector<float> _delayRe, _delayIm;
+    std::vector<float> _sumRe, _sumIm;
+    std::vector<float> _time, _fade;
+    int _position = 0;
+    int _head = 0;
+
+    // Background thread
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<unsigned int> _builds;
+
+    void processPartition();
+    void convolve(Slot const &slot, float* output);
+    void run();
+    void build(ResonatorBankSnapshot const &snapshot, float outGain, Slot &slot, FFT &fft, std::vector<float> &response, std::vector<float> &time);
+
+};
+
+#endif /* ResonatorConvolver_H_ */
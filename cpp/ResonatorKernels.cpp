@@ -0,0 +1,328 @@
+/*
+ * Resonators
+ * ResonatorKernels
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <cmath>
+
+#if defined(__arm__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "Resonator.h"
+#include "ResonatorKernels.h"
+
+// Resonator::paramRanges
+static const float kGainMin = 0.0f, kGainMax = 0.3f;
+static const float kDecayMin = 0.05f, kDecayMax = 50.0f;
+
+// Resonator::render() and Resonator::setState(), one resonator after another
+namespace ResonatorKernelsScalar {
+
+// Adds the outputs of resonators [begin, end) to output[0 .. frames). With
+// `first`, the first frame is rendered with the coefficients of the last one.
+static void renderRange(ResonatorKernelData const &d, int begin, int end, const float* input, float* output, int frames, bool first) {
+  if (frames == 1 && first) { // one sample at a time, as Resonators renders: sum in a register
+    float sum = 0.0f;
+    for (int i = begin; i < end; ++i) {
+      float term1 = d.b1Prev[i] * d.out1[i];
+      float term2 = d.b2Prev[i] * d.out2[i];
+      float term3 = d.a1Prev[i] * input[0];
+      float y = term1 + term2 + term3;
+      d.out2[i] = d.out1[i];
+      d.out1[i] = y;
+      sum += _min(y * d.outGain, d.hardLimit);
+    }
+    output[0] += sum;
+    return;
+  }
+  for (int i = begin; i < end; ++i) {
+    float y1 = d.out1[i], y2 = d.out2[i];
+    int n = 0;
+    if (first && frames > 0) {
+      float term1 = d.b1Prev[i] * y1;
+      float term2 = d.b2Prev[i] * y2;
+      float term3 = d.a1Prev[i] * input[0];
+      float y = term1 + term2 + term3;
+      y2 = y1;
+      y1 = y;
+      output[0] += _min(y * d.outGain, d.hardLimit);
+      n = 1;
+    }
+    for (float a1 = d.a1[i], b1 = d.b1[i], b2 = d.b2[i]; n < frames; ++n) {
+      float term1 = b1 * y1;
+      float term2 = b2 * y2;
+      float term3 = a1 * input[n];
+      float y = term1 + term2 + term3;
+      y2 = y1;
+      y1 = y;
+      output[n] += _min(y * d.outGain, d.hardLimit);
+    }
+    d.out1[i] = y1;
+    d.out2[i] = y2;
+  }
+}
+
+static void latch(ResonatorKernelData const &d, int size) {
+  for (int i = 0; i < size; ++i) {
+    d.a1Prev[i] = d.a1[i];
+    d.b1Prev[i] = d.b1[i];
+    d.b2Prev[i] = d.b2[i];
+  }
+}
+
+static void render(ResonatorKernelData const &d, int size, const float* input, float* output, int frames) {
+  if (frames <= 0) return;
+  const int tile = ResonatorKernels::kTile;
+  for (int start = 0; start < frames; start += tile) {
+    int count = (frames - start < tile) ? frames - start : tile;
+    float x[tile];
+    memcpy(x, input + start, count * sizeof(float));
+    memset(output + start, 0, count * sizeof(float));
+    renderRange(d, 0, size, x, output + start, count, start == 0);
+  }
+  latch(d, size);
+}
+
+// Inlined into the vector kernels, which use it for what is left over, so
+// that they make no calls to code built for another instruction set
+static inline __attribute__((always_inline)) void update(ResonatorKernelData const &d, int begin, int end) {
+  for (int i = begin; i < end; ++i) {
+    float gain = _map(d.gain[i], 0.0, 1.0, kGainMin, kGainMax);
+    if (kGainMin > gain) gain = kGainMin;
+    if (kGainMax < gain) gain = kGainMax;
+    float decay = _map(d.decay[i], 0.0, 1.0, kDecayMin, kDecayMax);
+    if (kDecayMin > decay) decay = kDecayMin;
+    if (kDecayMax < decay) decay = kDecayMax;
+
+    float decaySamples = exp (-decay * d.sampleInterval);
+    if (0.0 >= d.freq[i] || d.freq[i] >= d.nyquistLimit ||
+        0.0 >= decaySamples || decaySamples > 1.0) {
+      d.b1[i] = d.b2[i] = d.a1Prime[i] = 0.0;
+    }
+    else {
+      float freqPrime = d.freq[i] * d.twoPi * d.sampleInterval;
+      float ts = gain * sin (freqPrime);
+      d.a1[i] = ts * (1.0 - decaySamples);
+      d.b2[i] = -decaySamples * decaySamples;
+      d.b1[i] = decaySamples * cos (freqPrime) * 2.0;
+      d.a1Prime[i] = ts / d.b2[i];
+    }
+  }
+}
+
+static void renderLanes(ResonatorKernelData const &d, int size, const float* outGains, const float* input, float* output) {
+  float sum = 0.0f;
+  for (int i = 0; i < size; ++i) {
+    float term1 = d.b1Prev[i] * d.out1[i];
+    float term2 = d.b2Prev[i] * d.out2[i];
+    float term3 = d.a1Prev[i] * input[0];
+    float y = term1 + term2 + term3;
+    d.out2[i] = d.out1[i];
+    d.out1[i] = y;
+    sum += _min(y * outGains[0], d.hardLimit);
+  }
+  output[0] = sum;
+}
+
+static void renderMatrix(ResonatorKernelData const &d, int size, ResonatorKernelMatrix const &mx, const float* input, float* output, int frames) {
+  for (int n = 0; n < frames; ++n) {
+    const float *x = input + n * mx.inputs;
+    float acc[ResonatorKernels::kMaxPorts] = {};
+    for (int i = 0; i < size; ++i) {
+      float e = 0.0f;
+      for (int k = 0; k < mx.inputs; ++k) e += mx.inputGains[k * mx.stride + i] * x[k];
+      float term1 = d.b1Prev[i] * d.out1[i];
+      float term2 = d.b2Prev[i] * d.out2[i];
+      float term3 = d.a1Prev[i] * e;
+      float y = term1 + term2 + term3;
+      d.out2[i] = d.out1[i];
+      d.out1[i] = y;
+      float out = _min(y * d.outGain, d.hardLimit);
+      for (int o = 0; o < mx.outputs; ++o) acc[o] += mx.outputGains[o * mx.stride + i] * out;
+    }
+    for (int o = 0; o < mx.outputs; ++o) output[n * mx.outputs + o] = acc[o];
+    if (n == 0) latch(d, size); // coefficients take effect a sample late
+  }
+}
+
+static bool supported() { return true; }
+
+} // namespace ResonatorKernelsScalar
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define KERNEL_NAMESPACE ResonatorKernelsSSE42
+#define KERNEL_TARGET __attribute__((target("sse4.2")))
+#define KERNEL_WIDTH 4
+#include "ResonatorKernelsVector.h"
+#undef KERNEL_NAMESPACE
+#undef KERNEL_TARGET
+#undef KERNEL_WIDTH
+
+#define KERNEL_NAMESPACE ResonatorKernelsAVX2
+#define KERNEL_TARGET __attribute__((target("avx2,fma")))
+#define KERNEL_WIDTH 8
+#include "ResonatorKernelsVector.h"
+#undef KERNEL_NAMESPACE
+#undef KERNEL_TARGET
+#undef KERNEL_WIDTH
+
+#define KERNEL_NAMESPACE ResonatorKernelsAVX512
+#define KERNEL_TARGET __attribute__((target("avx512f")))
+#define KERNEL_WIDTH 16
+#include "ResonatorKernelsVector.h"
+#undef KERNEL_NAMESPACE
+#undef KERNEL_TARGET
+#undef KERNEL_WIDTH
+
+static bool supportsSSE42() { __builtin_cpu_init(); return __builtin_cpu_supports("sse4.2"); }
+static bool supportsAVX2() { __builtin_cpu_init(); return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+static bool supportsAVX512() { __builtin_cpu_init(); return __builtin_cpu_supports("avx512f"); }
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+// Built with NEON enabled (-mfpu=neon on 32-bit ARM, always on AArch64), so
+// the attribute is not needed; the check is for 32-bit builds run on cores
+// without it
+#define KERNEL_NAMESPACE ResonatorKernelsNEON
+#define KERNEL_TARGET
+#define KERNEL_WIDTH 4
+#include "ResonatorKernelsVector.h"
+#undef KERNEL_NAMESPACE
+#undef KERNEL_TARGET
+#undef KERNEL_WIDTH
+
+#if defined(__aarch64__)
+static bool supportsNEON() { return true; }
+#else
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+static bool supportsNEON() { return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0; }
+#endif
+
+#endif
+
+// Widest first
+static const ResonatorKernels::Variant kVariants[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  {"avx512", 16, supportsAVX512, ResonatorKernelsAVX512::render, ResonatorKernelsAVX512::update, ResonatorKernelsAVX512::renderLanes, ResonatorKernelsAVX512::renderMatrix, ResonatorKernelsAVX512::renderLookAhead},
+  {"avx2",    8, supportsAVX2,   ResonatorKernelsAVX2::render,   ResonatorKernelsAVX2::update, ResonatorKernelsAVX2::renderLanes, ResonatorKernelsAVX2::renderMatrix, ResonatorKernelsAVX2::renderLookAhead},
+  {"sse4.2",  4, supportsSSE42,  ResonatorKernelsSSE42::render,  ResonatorKernelsSSE42::update, ResonatorKernelsSSE42::renderLanes, ResonatorKernelsSSE42::renderMatrix, ResonatorKernelsSSE42::renderLookAhead},
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  {"neon",    4, supportsNEON,   ResonatorKernelsNEON::render,   ResonatorKernelsNEON::update, ResonatorKernelsNEON::renderLanes, ResonatorKernelsNEON::renderMatrix, ResonatorKernelsNEON::renderLookAhead},
+#endif
+  {"scalar",  1, ResonatorKernelsScalar::supported, ResonatorKernelsScalar::render, ResonatorKernelsScalar::update, ResonatorKernelsScalar::renderLanes, ResonatorKernelsScalar::renderMatrix, NULL},
+};
+static const int kTotalVariants = sizeof(kVariants) / sizeof(kVariants[0]);
+
+static std::atomic<const ResonatorKernels::Variant*> s_variant(NULL);
+
+static const ResonatorKernels::Variant* find(std::string const &isa) {
+  for (int i = 0; i < kTotalVariants; ++i)
+    if (kVariants[i].supported() && (isa == "auto" || isa == kVariants[i].isa)) return &kVariants[i];
+  return NULL;
+}
+
+// For k = 0-3, y[n+k] = P[k] y[n-1] + Q[k] y[n-2] + the sum over j of
+// C_j[k] x[n+j], from y[n] = b1 y[n-1] + b2 y[n-2] + a1 x[n]: per resonator,
+// P, Q, C_0-C_3, what rounding P and Q to float left out, and the a1, b1 and
+// b2 they were computed from. A low resonator's poles sit close together
+// near 1, where P and Q rounded alone would move them audibly.
+static void updateLookAhead(ResonatorKernelData const &d, int size) {
+  for (int i = 0; i < size; ++i) {
+    float *t = d.lookAhead + i * ResonatorKernels::kLookAheadStride;
+    if (t[32] == d.a1[i] && t[33] == d.b1[i] && t[34] == d.b2[i]) continue;
+    double a1 = d.a1[i], b1 = d.b1[i], b2 = d.b2[i];
+    double p[6] = {0.0, 1.0}, q[6] = {1.0, 0.0}, g[4] = {1.0, b1}; // p and q from k = -2
+    for (int k = 0; k < 4; ++k) {
+      p[k + 2] = b1 * p[k + 1] + b2 * p[k];
+      q[k + 2] = b1 * q[k + 1] + b2 * q[k];
+      if (k >= 2) g[k] = b1 * g[k - 1] + b2 * g[k - 2]; // impulse response
+    }
+    for (int k = 0; k < 4; ++k) {
+      t[k] = p[k + 2];
+      t[4 + k] = q[k + 2];
+      for (int j = 0; j < 4; ++j) t[8 + 4 * j + k] = (k >= j) ? a1 * g[k - j] : 0.0;
+      t[24 + k] = p[k + 2] - t[k];
+      t[28 + k] = q[k + 2] - t[4 + k];
+    }
+    t[32] = d.a1[i];
+    t[33] = d.b1[i];
+    t[34] = d.b2[i];
+  }
+}
+
+void ResonatorKernels::render(ResonatorKernelData const &data, int size, const float* input, float* output, int frames){
+  if (renderLookAhead(data, size, input, output, frames)) return;
+  variant().render(data, size, input, output, frames);
+}
+
+void ResonatorKernels::renderMatrix(ResonatorKernelData const &data, int size, ResonatorKernelMatrix const &matrix, const float* input, float* output, int frames){
+  variant().renderMatrix(data, size, matrix, input, output, frames);
+}
+
+bool ResonatorKernels::renderLookAhead(ResonatorKernelData const &data, int size, const float* input, float* output, int frames){
+  const Variant &v = variant();
+  if (v.renderLookAhead == NULL || data.lookAhead == NULL || size > kLookAheadMax || frames < kLookAhead) return false;
+  updateLookAhead(data, size);
+  v.renderLookAhead(data, size, input, output, frames);
+  return true;
+}
+
+void ResonatorKernels::update(ResonatorKernelData const &data, int begin, int end){
+  variant().update(data, begin, end);
+}
+
+void ResonatorKernels::renderLanes(ResonatorKernelData const &data, int size, const float* outGains, const float* input, float* output){
+  variant().renderLanes(data, size, outGains, input, output);
+}
+
+ResonatorKernelInfo ResonatorKernels::getInfo(){
+  const Variant &v = variant();
+  ResonatorKernelInfo info = {v.isa, v.width};
+  return info;
+}
+
+bool ResonatorKernels::select(std::string const &isa){
+  const Variant *v = find(isa);
+  if (v == NULL) {
+    printf("[ResonatorKernels] select() Error: %s is not supported here\n", isa.c_str());
+    return false;
+  }
+  s_variant.store(v, std::memory_order_release);
+  return true;
+}
+
+std::vector<std::string> ResonatorKernels::getSupported(){
+  std::vector<std::string> names;
+  for (int i = 0; i < kTotalVariants; ++i)
+    if (kVariants[i].supported()) names.push_back(kVariants[i].isa);
+  return names;
+}
+
+// private methods
+
+// Chosen on first use, which ResonatorBank::setup() makes sure is not in the
+// audio thread
+const ResonatorKernels::Variant& ResonatorKernels::variant(){
+  const Variant *v = s_variant.load(std::memory_order_acquire);
+  if (v != NULL) return *v;
+
+  const char *isa = getenv("RESONATORS_ISA");
+  if (isa != NULL) v = find(isa);
+  if (isa != NULL && v == NULL) printf("[ResonatorKernels] Warning: RESONATORS_ISA=%s is not supported here\n", isa);
+  if (v == NULL) v = find("auto");
+  s_variant.store(v, std::memory_order_release);
+  return *v;
+}
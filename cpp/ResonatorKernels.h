@@ -0,0 +1,115 @@
+/*
+ * Resonators
+ * ResonatorKernels
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorKernels_H_
+#define ResonatorKernels_H_
+
+#include <string>
+#include <vector>
+
+// The loops that render a bank and recompute its coefficients, over the
+// bank's resonators stored one array per field. One build carries a scalar
+// version and, for the processors it targets, SSE4.2, AVX2 and AVX-512 (x86)
+// or NEON (ARM) versions, each compiled for its instruction set alone; the
+// widest one the processor supports is chosen once, the first time a bank is
+// set up. The scalar version gives exactly the output of Resonator; the
+// vector ones sum the resonators in a different order and compute sines,
+// cosines and exponentials with polynomials, to within a few units in the
+// last place.
+//
+// Set RESONATORS_ISA=scalar (sse4.2, avx2, avx512, neon) in the environment,
+// or call select() before setup, to force a version, e.g. to compare them.
+
+// A bank's parameters, coefficients and render state
+typedef struct _ResonatorKernelData {
+    float *freq, *gain, *decay; // as set, gain and decay 0-1
+    float *a1, *b1, *b2, *a1Prime; // as computed by update()
+    float *a1Prev, *b1Prev, *b2Prev; // what the next sample is rendered with
+    float *out1, *out2; // the last two outputs
+    float *lookAhead; // ResonatorKernels::kLookAheadSize floats, or NULL
+    float outGain;
+    float hardLimit;
+    float sampleInterval;
+    float nyquistLimit;
+    float twoPi;
+} ResonatorKernelData;
+
+// Gains from several inputs to each resonator, and from each resonator to
+// several outputs, one row per input or output, `stride` floats apart
+typedef struct _ResonatorKernelMatrix {
+    const float *inputGains; // inputGains[i * stride + m], input i to resonator m
+    int inputs;
+    const float *outputGains; // outputGains[o * stride + m], resonator m to output o
+    int outputs;
+    int stride; // a whole number of registers, at least the bank's size
+} ResonatorKernelMatrix;
+
+typedef struct _ResonatorKernelInfo {
+    const char* isa; // "scalar", "sse4.2", "avx2", "avx512" or "neon"
+    int width; // resonators per instruction
+} ResonatorKernelInfo;
+
+class ResonatorKernels {
+public:
+    static const int kFields = 12; // arrays in ResonatorKernelData
+    static const int kTile = 64; // frames rendered per pass over the bank
+    static const int kMaxWidth = 16;
+    static const int kMaxPorts = 8; // inputs or outputs of a ResonatorKernelMatrix
+    static const int kMatrixTile = 16; // frames rendered per pass by renderMatrix()
+    static const int kLookAhead = 4; // samples per step of renderLookAhead()
+    static const int kLookAheadMax = 4; // largest bank rendered that way
+    static const int kLookAheadStride = 40; // floats per resonator in ResonatorKernelData::lookAhead
+    static const int kLookAheadSize = kLookAheadMax * kLookAheadStride;
+
+    // output[n] = the sum over the first `size` resonators of
+    // min(y * outGain, hardLimit), for input[n]. In place if input == output.
+    static void render(ResonatorKernelData const &data, int size, const float* input, float* output, int frames);
+    // render(), kLookAhead samples at a time: each resonator's next four
+    // outputs follow from its last two and the next four inputs through
+    // powers of its coefficient matrix, kept in data.lookAhead and rebuilt
+    // whenever its coefficients change. For banks too small to fill a
+    // register across resonators, with blocks of kLookAhead frames or more;
+    // render() takes it when it can. Returns false, rendering nothing, if it
+    // cannot (or the kernels chosen are scalar).
+    static bool renderLookAhead(ResonatorKernelData const &data, int size, const float* input, float* output, int frames);
+    // render() with each resonator fed the sum of the inputs through
+    // matrix.inputGains, and each output the sum of the resonators through
+    // matrix.outputGains (see ResonatorBankMIMO.h). Frames are interleaved:
+    // input[n * inputs + i], output[n * outputs + o]. Not in place.
+    static void renderMatrix(ResonatorKernelData const &data, int size, ResonatorKernelMatrix const &matrix, const float* input, float* output, int frames);
+    // Coefficients of resonators [begin, end) from their parameters
+    static void update(ResonatorKernelData const &data, int begin, int end);
+    // One sample of getInfo().width banks side by side, a bank per lane: the
+    // arrays hold resonator m of lane l at m * width + l, and input, output
+    // and outGains hold a value per lane. Renders with the *Prev
+    // coefficients and leaves them as they are (see ResonatorLanes.h).
+    static void renderLanes(ResonatorKernelData const &data, int size, const float* outGains, const float* input, float* output);
+
+    static ResonatorKernelInfo getInfo();
+    // "auto" for the widest supported; false if `isa` is unknown or not supported here
+    static bool select(std::string const &isa);
+    static std::vector<std::string> getSupported(); // widest first
+
+    struct Variant {
+        const char* isa;
+        int width;
+        bool (*supported)();
+        void (*render)(ResonatorKernelData const &data, int size, const float* input, float* output, int frames);
+        void (*update)(ResonatorKernelData const &data, int begin, int end);
+        void (*renderLanes)(ResonatorKernelData const &data, int size, const float* outGains, const float* input, float* output);
+        void (*renderMatrix)(ResonatorKernelData const &data, int size, ResonatorKernelMatrix const &matrix, const float* input, float* output, int frames);
+        void (*renderLookAhead)(ResonatorKernelData const &data, int size, const float* input, float* output, int frames); // or NULL
+    };
+
+private:
+    static const Variant& variant();
+
+};
+
+#endif /* ResonatorKernels_H_ */
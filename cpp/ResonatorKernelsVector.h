@@ -0,0 +1,302 @@
+/*
+ * Resonators
+ * ResonatorKernelsVector
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+// The vector kernels, written once with compiler vector extensions and
+// included by ResonatorKernels.cpp once per instruction set, with
+// KERNEL_NAMESPACE, KERNEL_TARGET (the function attribute enabling the
+// instruction set) and KERNEL_WIDTH (floats per register) defined.
+// No include guard, on purpose.
+
+namespace KERNEL_NAMESPACE {
+
+typedef float Vec __attribute__((vector_size(KERNEL_WIDTH * sizeof(float))));
+typedef int Mask __attribute__((vector_size(KERNEL_WIDTH * sizeof(float))));
+static const int kWidth = KERNEL_WIDTH;
+
+KERNEL_TARGET static inline Vec load(const float* p) { Vec v; memcpy(&v, p, sizeof(v)); return v; }
+KERNEL_TARGET static inline void store(float* p, Vec v) { memcpy(p, &v, sizeof(v)); }
+KERNEL_TARGET static inline Vec splat(float s) { Vec v = {}; return v + s; }
+KERNEL_TARGET static inline Vec select(Mask m, Vec a, Vec b) { return (Vec) (((Mask) a & m) | ((Mask) b & ~m)); }
+KERNEL_TARGET static inline Vec clamp(Vec x, float lo, float hi) {
+  x = select(x < lo, splat(lo), x);
+  return select(x > hi, splat(hi), x);
+}
+KERNEL_TARGET static inline float sum(Vec v) {
+  float s = 0.0f;
+  for (int k = 0; k < kWidth; ++k) s += v[k];
+  return s;
+}
+
+// e^x for x <= 0: x = n ln2 + g, |g| <= ln2 / 2, e^x = 2^n e^g (Cephes expf)
+KERNEL_TARGET static inline Vec exponential(Vec x) {
+  x = select(x < -87.0f, splat(-87.0f), x);
+  Mask n = -__builtin_convertvector(0.5f - x * 1.44269504088896341f, Mask); // round(x / ln2)
+  Vec fn = __builtin_convertvector(n, Vec);
+  Vec g = x - fn * 0.693359375f + fn * 2.12194440e-4f;
+  Vec p = 1.9875691500e-4f * g + 1.3981999507e-3f;
+  p = p * g + 8.3334519073e-3f;
+  p = p * g + 4.1665795894e-2f;
+  p = p * g + 1.6666665459e-1f;
+  p = p * g + 5.0000001201e-1f;
+  p = p * g * g + g + 1.0f;
+  return p * (Vec) ((n + 127) << 23);
+}
+
+// sin w and cos w for 0 <= w < pi, by Taylor series about 0 of pi/2 - |pi/2 - w|
+KERNEL_TARGET static inline void sincos(Vec w, Vec &s, Vec &c) {
+  const float pi = 3.14159265358979f;
+  Mask upper = w > 0.5f * pi;
+  Vec t = select(upper, pi - w, w);
+  Vec t2 = t * t;
+  s = splat(-1.0f / 39916800.0f);
+  s = s * t2 + 1.0f / 362880.0f;
+  s = s * t2 - 1.0f / 5040.0f;
+  s = s * t2 + 1.0f / 120.0f;
+  s = s * t2 - 1.0f / 6.0f;
+  s = (s * t2 + 1.0f) * t;
+  c = splat(1.0f / 479001600.0f);
+  c = c * t2 - 1.0f / 3628800.0f;
+  c = c * t2 + 1.0f / 40320.0f;
+  c = c * t2 - 1.0f / 720.0f;
+  c = c * t2 + 1.0f / 24.0f;
+  c = c * t2 - 0.5f;
+  c = c * t2 + 1.0f;
+  c = select(upper, -c, c);
+}
+
+// The coefficients the next sample is rendered with
+KERNEL_TARGET static inline void latch(ResonatorKernelData const &d, int size) {
+  Mask lane;
+  for (int k = 0; k < kWidth; ++k) lane[k] = k;
+  for (int i = 0; i < size; i += kWidth) {
+    Mask live = lane < size - i;
+    store(d.a1Prev + i, select(live, load(d.a1 + i), load(d.a1Prev + i)));
+    store(d.b1Prev + i, select(live, load(d.b1 + i), load(d.b1Prev + i)));
+    store(d.b2Prev + i, select(live, load(d.b2 + i), load(d.b2Prev + i)));
+  }
+}
+
+// A register's worth of resonators at a time, through a tile of frames, so
+// that their state stays in registers; the per-frame sums are kept as
+// vectors and added across only once per tile. The arrays are padded to a
+// whole number of registers (see ResonatorBank::getStride()), so the last,
+// partial register is rendered whole, with the lanes past `size` silenced
+// going in and left as they were coming out.
+KERNEL_TARGET static void render(ResonatorKernelData const &d, int size, const float* input, float* output, int frames) {
+  if (frames <= 0) return;
+  const int tile = ResonatorKernels::kTile;
+  Vec gain = splat(d.outGain), limit = splat(d.hardLimit), zero = splat(0.0f);
+  Mask lane;
+  for (int k = 0; k < kWidth; ++k) lane[k] = k;
+
+  if (frames == 1) { // one sample at a time, as Resonators renders: sum in a register
+    float x = input[0];
+    Vec acc = zero;
+    for (int i = 0; i < size; i += kWidth) {
+      Mask live = lane < size - i;
+      Vec y1 = load(d.out1 + i), y2 = load(d.out2 + i);
+      Vec y = select(live, load(d.b1Prev + i) * y1 + load(d.b2Prev + i) * y2 + load(d.a1Prev + i) * x, zero);
+      store(d.out2 + i, select(live, y1, y2));
+      store(d.out1 + i, select(live, y, y1));
+      Vec out = y * gain;
+      acc += select(out < limit, out, limit);
+    }
+    output[0] = sum(acc);
+    latch(d, size);
+    return;
+  }
+
+  for (int start = 0; start < frames; start += tile) {
+    int count = (frames - start < tile) ? frames - start : tile;
+    float x[tile];
+    memcpy(x, input + start, count * sizeof(float));
+    Vec acc[tile];
+    for (int n = 0; n < count; ++n) acc[n] = zero;
+
+    for (int i = 0; i < size; i += kWidth) {
+      Mask live = lane < size - i;
+      Vec a1 = select(live, load(d.a1 + i), zero), b1 = select(live, load(d.b1 + i), zero), b2 = select(live, load(d.b2 + i), zero);
+      Vec first1 = load(d.out1 + i), first2 = load(d.out2 + i);
+      Vec y1 = select(live, first1, zero), y2 = select(live, first2, zero);
+      int n = 0;
+      if (start == 0) { // coefficients take effect a sample late
+        Vec y = load(d.b1Prev + i) * y1 + load(d.b2Prev + i) * y2 + select(live, load(d.a1Prev + i), zero) * x[0];
+        y2 = y1;
+        y1 = y;
+        Vec out = y * gain;
+        acc[0] += select(out < limit, out, limit);
+        n = 1;
+      }
+      for (; n < count; ++n) {
+        Vec y = b1 * y1 + b2 * y2 + a1 * x[n];
+        y2 = y1;
+        y1 = y;
+        Vec out = y * gain;
+        acc[n] += select(out < limit, out, limit);
+      }
+      store(d.out1 + i, select(live, y1, first1));
+      store(d.out2 + i, select(live, y2, first2));
+    }
+
+    for (int n = 0; n < count; ++n) output[start + n] = sum(acc[n]);
+  }
+  latch(d, size);
+}
+
+// A resonator of every lane at a time; the sums stay in their lanes
+KERNEL_TARGET static void renderLanes(ResonatorKernelData const &d, int size, const float* outGains, const float* input, float* output) {
+  Vec x = load(input), gain = load(outGains), limit = splat(d.hardLimit), acc = splat(0.0f);
+  for (int m = 0; m < size; ++m) {
+    int i = m * kWidth;
+    Vec y1 = load(d.out1 + i);
+    Vec y = load(d.b1Prev + i) * y1 + load(d.b2Prev + i) * load(d.out2 + i) + load(d.a1Prev + i) * x;
+    store(d.out2 + i, y1);
+    store(d.out1 + i, y);
+    Vec out = y * gain;
+    acc += select(out < limit, out, limit);
+  }
+  store(output, acc);
+}
+
+// As render(): a register's worth of resonators at a time through a tile of
+// frames, with their state and their rows of both matrices in registers,
+// and per frame and output a vector of sums added across once per tile
+KERNEL_TARGET static void renderMatrix(ResonatorKernelData const &d, int size, ResonatorKernelMatrix const &mx, const float* input, float* output, int frames) {
+  if (frames <= 0) return;
+  const int tile = ResonatorKernels::kMatrixTile, maxPorts = ResonatorKernels::kMaxPorts;
+  Vec gain = splat(d.outGain), limit = splat(d.hardLimit), zero = splat(0.0f);
+  Mask lane;
+  for (int k = 0; k < kWidth; ++k) lane[k] = k;
+
+  for (int start = 0; start < frames; start += tile) {
+    int count = (frames - start < tile) ? frames - start : tile;
+    const float *x = input + start * mx.inputs;
+    Vec acc[tile * maxPorts];
+    for (int k = 0; k < count * mx.outputs; ++k) acc[k] = zero;
+
+    for (int i = 0; i < size; i += kWidth) {
+      Mask live = lane < size - i;
+      Vec in[maxPorts], out[maxPorts];
+      for (int k = 0; k < mx.inputs; ++k) in[k] = select(live, load(mx.inputGains + k * mx.stride + i), zero);
+      for (int o = 0; o < mx.outputs; ++o) out[o] = load(mx.outputGains + o * mx.stride + i);
+      Vec a1 = select(live, load(d.a1 + i), zero), b1 = select(live, load(d.b1 + i), zero), b2 = select(live, load(d.b2 + i), zero);
+      Vec first1 = load(d.out1 + i), first2 = load(d.out2 + i);
+      Vec y1 = select(live, first1, zero), y2 = select(live, first2, zero);
+      for (int n = 0; n < count; ++n) {
+        Vec e = zero;
+        for (int k = 0; k < mx.inputs; ++k) e += in[k] * x[n * mx.inputs + k];
+        Vec y = (start == 0 && n == 0) // coefficients take effect a sample late
+          ? load(d.b1Prev + i) * y1 + load(d.b2Prev + i) * y2 + load(d.a1Prev + i) * e
+          : b1 * y1 + b2 * y2 + a1 * e;
+        y2 = y1;
+        y1 = y;
+        Vec o = y * gain;
+        o = select(o < limit, o, limit);
+        for (int k = 0; k < mx.outputs; ++k) acc[n * mx.outputs + k] += out[k] * o;
+      }
+      store(d.out1 + i, select(live, y1, first1));
+      store(d.out2 + i, select(live, y2, first2));
+    }
+
+    for (int k = 0; k < count * mx.outputs; ++k) output[start * mx.outputs + k] = sum(acc[k]);
+  }
+  latch(d, size);
+}
+
+typedef float Vec4 __attribute__((vector_size(4 * sizeof(float))));
+typedef int Mask4 __attribute__((vector_size(4 * sizeof(float))));
+
+KERNEL_TARGET static inline Vec4 load4(const float* p) { Vec4 v; memcpy(&v, p, sizeof(v)); return v; }
+
+// Four samples of a resonator at a time (see ResonatorKernels::renderLookAhead()),
+// whatever kWidth is; the resonators of a step do not depend on each other
+KERNEL_TARGET static void renderLookAhead(ResonatorKernelData const &d, int size, const float* input, float* output, int frames) {
+  const int stride = ResonatorKernels::kLookAheadStride;
+  float y1[ResonatorKernels::kLookAheadMax], y2[ResonatorKernels::kLookAheadMax];
+  bool changed = false;
+  for (int i = 0; i < size; ++i) {
+    y1[i] = d.out1[i];
+    y2[i] = d.out2[i];
+    changed = changed || d.a1Prev[i] != d.a1[i] || d.b1Prev[i] != d.b1[i] || d.b2Prev[i] != d.b2[i];
+  }
+
+  int n = 0;
+  if (changed) { // coefficients take effect a sample late
+    float x = input[0], acc = 0.0f;
+    for (int i = 0; i < size; ++i) {
+      float y = d.b1Prev[i] * y1[i] + d.b2Prev[i] * y2[i] + d.a1Prev[i] * x;
+      y2[i] = y1[i];
+      y1[i] = y;
+      acc += _min(y * d.outGain, d.hardLimit);
+    }
+    output[0] = acc;
+    n = 1;
+  }
+
+  Vec4 limit = {d.hardLimit, d.hardLimit, d.hardLimit, d.hardLimit};
+  for (; n + 4 <= frames; n += 4) {
+    Vec4 x = load4(input + n), acc = {};
+    for (int i = 0; i < size; ++i) {
+      const float *t = d.lookAhead + i * stride;
+      Vec4 in = (load4(t + 8) * x[0] + load4(t + 12) * x[1]) + (load4(t + 16) * x[2] + load4(t + 20) * x[3]);
+      Vec4 state = (load4(t) * y1[i] + load4(t + 4) * y2[i]) + (load4(t + 24) * y1[i] + load4(t + 28) * y2[i]);
+      Vec4 y = in + state; // the state last, for the shortest chain
+      y1[i] = y[3];
+      y2[i] = y[2];
+      Vec4 out = y * d.outGain;
+      Mask4 below = out < limit;
+      acc += (Vec4) (((Mask4) out & below) | ((Mask4) limit & ~below));
+    }
+    memcpy(output + n, &acc, sizeof(acc));
+  }
+
+  for (; n < frames; ++n) {
+    float x = input[n], acc = 0.0f;
+    for (int i = 0; i < size; ++i) {
+      float y = d.b1[i] * y1[i] + d.b2[i] * y2[i] + d.a1[i] * x;
+      y2[i] = y1[i];
+      y1[i] = y;
+      acc += _min(y * d.outGain, d.hardLimit);
+    }
+    output[n] = acc;
+  }
+
+  for (int i = 0; i < size; ++i) {
+    d.out1[i] = y1[i];
+    d.out2[i] = y2[i];
+    d.a1Prev[i] = d.a1[i];
+    d.b1Prev[i] = d.b1[i];
+    d.b2Prev[i] = d.b2[i];
+  }
+}
+
+KERNEL_TARGET static void update(ResonatorKernelData const &d, int begin, int end) {
+  int i = begin;
+  for (; i + kWidth <= end; i += kWidth) {
+    Vec freq  = load(d.freq + i);
+    Vec gain  = clamp(load(d.gain + i) * (kGainMax - kGainMin) + kGainMin, kGainMin, kGainMax);
+    Vec decay = clamp(load(d.decay + i) * (kDecayMax - kDecayMin) + kDecayMin, kDecayMin, kDecayMax);
+    Vec r = exponential(-decay * d.sampleInterval); // pole radius
+
+    Vec s, c;
+    sincos(freq * d.twoPi * d.sampleInterval, s, c);
+    Vec ts = gain * s;
+    Vec b2 = -(r * r);
+    Mask valid = (freq > 0.0f) & (freq < d.nyquistLimit) & (r > 0.0f) & (r <= 1.0f);
+
+    // As Resonator::setState(): a1 is left as it was for resonators out of range
+    store(d.a1 + i, select(valid, ts * (1.0f - r), load(d.a1 + i)));
+    store(d.b1 + i, select(valid, r * c * 2.0f, splat(0.0f)));
+    store(d.b2 + i, select(valid, b2, splat(0.0f)));
+    store(d.a1Prime + i, select(valid, ts / b2, splat(0.0f)));
+  }
+  ResonatorKernelsScalar::update(d, i, end);
+}
+
+} // namespace KERNEL_NAMESPACE
@@ -0,0 +1,242 @@
+/*
+ * Resonators
+ * ResonatorLanes
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+
+#include "ResonatorLanes.h"
+
+ResonatorLanes::ResonatorLanes(){}
+ResonatorLanes::~ResonatorLanes(){}
+
+void ResonatorLanes::setup(std::vector<ResonatorBank> &banks, ResonatorLanesOptions options){
+  _opt = options;
+  _banks = &banks;
+  int totalBanks = banks.size();
+
+  int capacity = 0;
+  for (int b = 0; b < totalBanks; ++b)
+    if (banks[b].getOptions().maxSize > capacity) capacity = banks[b].getOptions().maxSize;
+  _stride = capacity * ResonatorKernels::kMaxWidth;
+
+  _groups.resize(totalBanks / 2);
+  _storage.assign(_groups.size() * ResonatorKernels::kFields * _stride, 0.0f);
+  for (unsigned int g = 0; g < _groups.size(); ++g)
+    _groups[g].block = &_storage[g * ResonatorKernels::kFields * _stride];
+  _totalGroups = 0;
+  Lane lane = {-1, 0, -1, 0};
+  _lanes.assign(totalBanks, lane);
+  _order.resize(totalBanks);
+  _coefficients.resize(capacity);
+  _states.resize(capacity);
+  _width = 0;
+  _active = false;
+  _dirty = true;
+}
+
+void ResonatorLanes::render(const float* inputs, float* outputs){
+  if (_banks == NULL) return;
+  if (!_active) {
+    _active = true;
+    _dirty = true;
+  }
+  follow();
+
+  std::vector<ResonatorBank> &banks = *_banks;
+  float in[ResonatorKernels::kMaxWidth], out[ResonatorKernels::kMaxWidth];
+  for (int g = 0; g < _totalGroups; ++g) {
+    Group &group = _groups[g];
+    ResonatorKernelData data = getData(group);
+    for (int l = 0; l < _width; ++l) in[l] = (l < group.lanes) ? inputs[group.banks[l]] : 0.0f;
+    ResonatorKernels::renderLanes(data, group.size, group.outGains, in, out);
+    for (int l = 0; l < group.lanes; ++l) outputs[group.banks[l]] = _min(out[l], _hardLimit);
+
+    // As ResonatorBank::render(): coefficients take effect a sample late
+    if (group.pending) {
+      int length = group.size * _width;
+      memcpy(data.a1Prev, data.a1, length * sizeof(float));
+      memcpy(data.b1Prev, data.b1, length * sizeof(float));
+      memcpy(data.b2Prev, data.b2, length * sizeof(float));
+      group.pending = false;
+    }
+  }
+
+  int totalBanks = banks.size();
+  for (int b = 0; b < totalBanks; ++b)
+    if (_lanes[b].group < 0) outputs[b] = banks[b].render(inputs[b]);
+}
+
+void ResonatorLanes::release(){
+  if (!_active) return;
+  for (int g = 0; g < _totalGroups; ++g) giveBack(_groups[g]);
+  _totalGroups = 0;
+  for (unsigned int b = 0; b < _lanes.size(); ++b) _lanes[b].group = -1;
+  _active = false;
+}
+
+void ResonatorLanes::getAmplitudes(int bankIndex, float* amplitudes, int length){
+  Lane const &lane = _lanes[bankIndex];
+  if (lane.group < 0) {
+    (*_banks)[bankIndex].getAmplitudes(amplitudes, length);
+    return;
+  }
+  Group &group = _groups[lane.group];
+  ResonatorKernelData data = getData(group);
+  if (length > lane.size) length = lane.size;
+  for (int m = 0; m < length; ++m) {
+    int i = m * _width + lane.lane;
+    ResonatorCoefficients c = {data.a1[i], data.b1[i], data.b2[i], 0.0f};
+    amplitudes[m] = ResonatorBank::getAmplitude(c, data.out1[i], data.out2[i], group.outGains[lane.lane]);
+  }
+}
+
+// private methods
+
+ResonatorKernelData ResonatorLanes::getData(Group const &group){
+  ResonatorKernelData d;
+  d.freq    = group.block;
+  d.gain    = group.block + _stride;
+  d.decay   = group.block + 2 * _stride;
+  d.a1      = group.block + 3 * _stride;
+  d.b1      = group.block + 4 * _stride;
+  d.b2      = group.block + 5 * _stride;
+  d.a1Prime = group.block + 6 * _stride;
+  d.a1Prev  = group.block + 7 * _stride;
+  d.b1Prev  = group.block + 8 * _stride;
+  d.b2Prev  = group.block + 9 * _stride;
+  d.out1    = group.block + 10 * _stride;
+  d.out2    = group.block + 11 * _stride;
+  d.lookAhead = NULL;
+  d.outGain        = 0.0f; // per lane, in the group
+  d.hardLimit      = _hardLimit;
+  d.sampleInterval = 0.0f;
+  d.nyquistLimit   = 0.0f;
+  d.twoPi          = 0.0f;
+  return d;
+}
+
+// Picks up changes to the banks: new coefficients go straight into their
+// lanes, new sizes regroup every bank
+void ResonatorLanes::follow(){
+  int width = ResonatorKernels::getInfo().width;
+  if (width != _width) _dirty = true;
+
+  std::vector<ResonatorBank> &banks = *_banks;
+  int totalBanks = banks.size();
+  for (int b = 0; b < totalBanks; ++b) {
+    Lane &lane = _lanes[b];
+    banks[b].publishChanges();
+    unsigned int version = banks[b].getSnapshotVersion();
+    if (version == lane.version) continue;
+    lane.version = version;
+    if (banks[b].getSize() != lane.size) _dirty = true;
+    else if (lane.group >= 0 && !_dirty) gather(_groups[lane.group], lane.lane);
+  }
+  if (_dirty) regroup();
+}
+
+void ResonatorLanes::regroup(){
+  std::vector<ResonatorBank> &banks = *_banks;
+  int totalBanks = banks.size();
+  for (int g = 0; g < _totalGroups; ++g) giveBack(_groups[g]);
+  _totalGroups = 0;
+  _width = ResonatorKernels::getInfo().width;
+  _dirty = false;
+
+  // Largest first, by insertion: there are a few banks, and no allocating
+  int ordered = 0;
+  for (int b = 0; b < totalBanks; ++b) {
+    _lanes[b].group = -1;
+    _lanes[b].size = banks[b].getSize();
+    if (_lanes[b].size == 0) continue;
+    int i = ordered++;
+    while (i > 0 && _lanes[_order[i - 1]].size < _lanes[b].size) {
+      _order[i] = _order[i - 1];
+      --i;
+    }
+    _order[i] = b;
+  }
+  if (!_opt.enabled || _width < 2) return;
+
+  for (int i = 0; i < ordered; ) {
+    int largest = _lanes[_order[i]].size;
+    int j = i + 1;
+    while (j < ordered && j - i < _width && _lanes[_order[j]].size >= _opt.minFill * largest) ++j;
+    if (j - i >= 2 && _totalGroups < (int) _groups.size()) {
+      Group &group = _groups[_totalGroups];
+      group.lanes = j - i;
+      group.size = largest;
+      for (int l = 0; l < group.lanes; ++l) {
+        int b = _order[i + l];
+        group.banks[l] = b;
+        _lanes[b].group = _totalGroups;
+        _lanes[b].lane = l;
+      }
+      take(group);
+      ++_totalGroups;
+    }
+    i = j;
+  }
+}
+
+// Interleaves the banks' coefficients and state into the group
+void ResonatorLanes::take(Group &group){
+  std::vector<ResonatorBank> &banks = *_banks;
+  ResonatorKernelData d = getData(group);
+  memset(group.block, 0, ResonatorKernels::kFields * _stride * sizeof(float));
+  for (int l = 0; l < ResonatorKernels::kMaxWidth; ++l) group.outGains[l] = 0.0f;
+
+  for (int l = 0; l < group.lanes; ++l) {
+    ResonatorBank &bank = banks[group.banks[l]];
+    int size = bank.getSize();
+    group.outGains[l] = bank.getOptions().resOpt.outGain;
+    bank.getCoefficients(_coefficients.data(), size);
+    bank.getRenderState(_states.data(), size);
+    for (int m = 0; m < size; ++m) {
+      int i = m * _width + l;
+      d.a1[i]     = _coefficients[m].a1;
+      d.b1[i]     = _coefficients[m].b1;
+      d.b2[i]     = _coefficients[m].b2;
+      d.a1Prev[i] = _states[m].a1Prev;
+      d.b1Prev[i] = _states[m].b1Prev;
+      d.b2Prev[i] = _states[m].b2Prev;
+      d.out1[i]   = _states[m].out1;
+      d.out2[i]   = _states[m].out2;
+    }
+  }
+  group.pending = true;
+}
+
+void ResonatorLanes::giveBack(Group &group){
+  std::vector<ResonatorBank> &banks = *_banks;
+  ResonatorKernelData d = getData(group);
+  for (int l = 0; l < group.lanes; ++l) {
+    int size = _lanes[group.banks[l]].size;
+    for (int m = 0; m < size; ++m) {
+      int i = m * _width + l;
+      ResonatorRenderState state = {d.out1[i], d.out2[i], d.a1Prev[i], d.b1Prev[i], d.b2Prev[i]};
+      _states[m] = state;
+    }
+    banks[group.banks[l]].setRenderState(_states.data(), size);
+  }
+}
+
+void ResonatorLanes::gather(Group &group, int lane){
+  ResonatorBank &bank = (*_banks)[group.banks[lane]];
+  ResonatorKernelData d = getData(group);
+  int size = _lanes[group.banks[lane]].size;
+  bank.getCoefficients(_coefficients.data(), size);
+  for (int m = 0; m < size; ++m) {
+    int i = m * _width + lane;
+    d.a1[i] = _coefficients[m].a1;
+    d.b1[i] = _coefficients[m].b1;
+    d.b2[i] = _coefficients[m].b2;
+  }
+  group.outGains[lane] = bank.getOptions().resOpt.outGain;
+  group.pending = true;
+}
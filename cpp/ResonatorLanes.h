@@ -0,0 +1,97 @@
+/*
+ * Resonators
+ * ResonatorLanes
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorLanes_H_
+#define ResonatorLanes_H_
+
+#include <vector>
+
+#include "ResonatorBank.h"
+
+// Renders several banks side by side, one vector lane per bank, instead of
+// vectorising across the resonators of each bank: a keyboard of 8-resonator
+// models fills a 16-lane register with 16 banks rather than half of it with
+// one. Banks are put into groups of up to ResonatorKernels::getInfo().width
+// whenever their sizes change, largest first, each group taking banks down
+// to minFill of its largest one; smaller banks in a group are padded with
+// silent resonators. Banks that end up alone are rendered as usual.
+//
+// While grouped, a bank's render state lives here, and render() follows
+// changes to its coefficients; release() hands it back, so that the bank
+// can be rendered on its own. Resonators does this for render(inputs,
+// outputs) and render(index, in) respectively.
+
+typedef struct _ResonatorLanesOptions {
+    bool enabled = true;
+    float minFill = 0.75f; // smallest bank in a group, as a fraction of the largest
+    bool v = true; // verbose printing
+} ResonatorLanesOptions;
+
+class ResonatorLanes {
+public:
+    ResonatorLanes();
+    ~ResonatorLanes();
+
+    // The banks must stay where they are (not be added to or removed) from here on
+    void setup(std::vector<ResonatorBank> &banks, ResonatorLanesOptions options = ResonatorLanesOptions());
+
+    // Audio thread: one sample per bank, an input and an output each, as
+    // ResonatorBank::render(float) gives
+    void render(const float* inputs, float* outputs);
+    // Audio thread: hand the banks back their state
+    void release();
+
+    // ResonatorBank::getAmplitudes(), for grouped banks too
+    void getAmplitudes(int bankIndex, float* amplitudes, int length);
+
+    bool isGrouped(int bankIndex) { return _lanes[bankIndex].group >= 0; }
+    int getGroups() { return _totalGroups; }
+
+private:
+    struct Group {
+        int lanes;
+        int banks[ResonatorKernels::kMaxWidth];
+        int size; // resonators, the largest bank's
+        float outGains[ResonatorKernels::kMaxWidth];
+        float* block; // ResonatorKernels::kFields arrays of _stride floats
+        bool pending; // coefficients changed, for after the next sample
+    };
+    struct Lane {
+        int group; // -1 if rendered on its own
+        int lane;
+        int size;
+        unsigned int version;
+    };
+
+    ResonatorLanesOptions _opt = {};
+    std::vector<ResonatorBank>* _banks = NULL;
+    float _hardLimit = ResonatorUtils().hardLimit;
+    int _width = 0;
+    int _stride = 0; // floats per array: the largest bank times kMaxWidth
+    bool _active = false;
+    bool _dirty = true;
+
+    std::vector<Group> _groups; // room for every pair of banks
+    int _totalGroups = 0;
+    std::vector<Lane> _lanes; // per bank
+    std::vector<int> _order;
+    std::vector<float> _storage;
+    std::vector<ResonatorCoefficients> _coefficients;
+    std::vector<ResonatorRenderState> _states;
+
+    ResonatorKernelData getData(Group const &group);
+    void follow();
+    void regroup();
+    void take(Group &group);
+    void giveBack(Group &group);
+    void gather(Group &group, int lane);
+
+};
+
+#endif /* ResonatorLanes_H_ */
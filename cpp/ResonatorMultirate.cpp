@@ -0,0 +1,222 @@
+/*
+ * Resonators
+ * ResonatorMultirate
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <cmath>
+
+#include "ResonatorMultirate.h"
+
+ResonatorMultirate::ResonatorMultirate(){}
+ResonatorMultirate::~ResonatorMultirate(){}
+
+bool ResonatorMultirate::setup(ResonatorBank &bank, float sampleRate, float framesPerBlock, ResonatorMultirateOptions options){
+  int levels = 1;
+  while ((1 << (levels - 1)) < options.maxFactor) ++levels;
+  if ((1 << (levels - 1)) != options.maxFactor || levels > kMaxLevels) {
+    printf("[ResonatorMultirate] setup() Error: maxFactor must be 1, 2, 4 or 8, not %d\n", options.maxFactor);
+    return false;
+  }
+  if (options.taps < 3 || options.taps % 4 != 3) {
+    printf("[ResonatorMultirate] setup() Error: taps must be 4k + 3, not %d\n", options.taps);
+    return false;
+  }
+  _opt = options;
+  _bank = &bank;
+  _sampleRate = sampleRate;
+  designHalfband();
+
+  ResonatorBankOptions bankOpt = bank.getOptions();
+  bankOpt.v = false;
+  bankOpt.total = bankOpt.maxSize;
+
+  // Each halving delays the levels below by one filter length less a sample
+  // (see process())
+  _levels.clear();
+  _levels.resize(levels);
+  int latency = 0;
+  for (int l = levels - 1; l >= 0; --l) {
+    Level &level = _levels[l];
+    float rate = sampleRate / (1 << l);
+    level.bank.setup(bankOpt, rate, framesPerBlock / (1 << l));
+    level.bank.setSize(0);
+    level.size = 0;
+    level.params.resize(bankOpt.maxSize);
+
+    level.decimator.assign(2 * _opt.taps, 0.0f);
+    level.decimatorPosition = 0;
+    level.interpolator.assign(4 * _coefficients.size(), 0.0f);
+    level.interpolatorPosition = 0;
+    level.interpolated[0] = level.interpolated[1] = 0.0f;
+    level.phase = 0;
+
+    if (l < levels - 1) latency = _opt.taps - 1 + 2 * latency;
+    level.latency = latency;
+    level.delay.assign((latency > 0) ? latency : 1, 0.0f);
+    level.delayPosition = 0;
+  }
+
+  bank.publishChanges();
+  _version = bank.getSnapshotVersion();
+  regroup();
+
+  if (_opt.v) {
+    printf("[ResonatorMultirate] Latency %d samples; resonators per rate:", getLatency());
+    for (int l = 0; l < levels; ++l) printf(" 1/%d: %d", 1 << l, _levels[l].size);
+    printf("\n");
+  }
+  return true;
+}
+
+float ResonatorMultirate::render(float in){
+  if (_levels.empty()) return 0.0f;
+  follow();
+  return _min(process(0, in), _hardLimit);
+}
+
+void ResonatorMultirate::render(const float* input, float* output, int frames){
+  if (_levels.empty()) return;
+  follow();
+  for (int n = 0; n < frames; ++n)
+    output[n] = _min(process(0, input[n]), _hardLimit);
+}
+
+float ResonatorMultirate::compare(ResonatorBank &bank, float sampleRate, ResonatorMultirateOptions options, int frames){
+  ResonatorBank reference = bank;
+  ResonatorBank source = bank;
+  options.v = false;
+  ResonatorMultirate multirate;
+  float blockSize = (reference.getOptions().audioFrames > 0) ? reference.getOptions().audioFrames : 16.0f;
+  if (!multirate.setup(source, sampleRate, blockSize, options)) return -1.0f;
+
+  // Both render a sample first, as coefficients take effect a sample late
+  int latency = multirate.getLatency();
+  std::vector<float> expected(frames), actual(frames + latency);
+  reference.render(0.0f);
+  multirate.render(0.0f);
+  for (int n = 0; n < frames; ++n) expected[n] = reference.render((n == 0) ? 1.0f : 0.0f);
+  for (int n = 0; n < frames + latency; ++n) actual[n] = multirate.render((n == 0) ? 1.0f : 0.0f);
+
+  double signal = 0.0, error = 0.0;
+  for (int n = 0; n < frames; ++n) {
+    double e = actual[n + latency] - expected[n];
+    signal += expected[n] * expected[n];
+    error += e * e;
+  }
+  if (error == 0.0) return INFINITY;
+  return 10.0 * log10(signal / error);
+}
+
+// private methods
+
+// Kaiser-windowed sinc, cut off at a quarter of the rate: every other tap is
+// zero and the centre tap is 1/2, so only the taps either side are stored
+void ResonatorMultirate::designHalfband(){
+  int half = (_opt.taps - 1) / 2;
+  double beta = 7.857; // about 80 dB stopband
+  double i0Beta = 0.0;
+  for (int k = 0; k < 25; ++k) {
+    double t = pow(beta / 2.0, k) / tgamma(k + 1);
+    i0Beta += t * t;
+  }
+
+  _coefficients.resize((half + 1) / 2);
+  double sum = 0.0;
+  for (unsigned int j = 0; j < _coefficients.size(); ++j) {
+    int offset = 2 * j + 1;
+    double x = (double) offset / half;
+    double arg = beta * sqrt(1.0 - x * x);
+    double i0 = 0.0;
+    for (int k = 0; k < 25; ++k) {
+      double t = pow(arg / 2.0, k) / tgamma(k + 1);
+      i0 += t * t;
+    }
+    double sinc = sin(M_PI * offset / 2.0) / (M_PI * offset);
+    _coefficients[j] = sinc * i0 / i0Beta;
+    sum += 2.0 * _coefficients[j];
+  }
+  // Unity gain at DC: the outer taps sum to 1/2, as the centre tap does
+  for (unsigned int j = 0; j < _coefficients.size(); ++j) _coefficients[j] *= 0.5 / sum;
+}
+
+void ResonatorMultirate::follow(){
+  _bank->publishChanges();
+  unsigned int version = _bank->getSnapshotVersion();
+  if (version == _version) return;
+  _version = version;
+  regroup();
+}
+
+void ResonatorMultirate::regroup(){
+  int levels = _levels.size();
+  for (int l = 0; l < levels; ++l) _levels[l].size = 0;
+
+  int size = _bank->getSize();
+  for (int i = 0; i < size; ++i) {
+    ResonatorParams params = _bank->getResonator(i);
+    int l = levels - 1;
+    while (l > 0 && params.freq >= _opt.bandEdge * _sampleRate / (1 << l)) --l;
+    Level &level = _levels[l];
+    if (level.size < (int) level.params.size()) level.params[level.size++] = params;
+  }
+
+  for (int l = 0; l < levels; ++l) {
+    Level &level = _levels[l];
+    level.bank.setSize(level.size);
+    level.bank.setBank(level.params.data(), level.size);
+    level.bank.update();
+  }
+}
+
+// One sample in and out at level `level`'s rate. Every other sample, the
+// input is decimated and passed down a level, and what comes back is
+// interpolated into the next two outputs. Decimating and interpolating with
+// a half-band of length N, played out a sample after it is computed, delays
+// the level below by N samples at this level's rate, plus twice its own
+// delay. But a resonator's impulse response starts a sample early (y[0] is
+// already a1 sin(w) / sin(w)), and a sample of the level below is two here,
+// so its resonators come out one sample ahead: N - 1 lines them up.
+float ResonatorMultirate::process(int level, float in){
+  Level &lv = _levels[level];
+  float out = (lv.size > 0) ? lv.bank.render(in) : 0.0f;
+  if (level == (int) _levels.size() - 1) return out;
+
+  int taps = _opt.taps;
+  int centre = (taps - 1) / 2;
+  int pairs = _coefficients.size();
+  const float *h = _coefficients.data();
+
+  push(lv.decimator, lv.decimatorPosition, in);
+  float up = lv.interpolated[lv.phase];
+  if (lv.phase == 1) {
+    const float *x = &lv.decimator[lv.decimatorPosition]; // oldest first
+    float down = 0.5f * x[centre];
+    for (int j = 0; j < pairs; ++j)
+      down += h[j] * (x[centre + 2 * j + 1] + x[centre - 2 * j - 1]);
+
+    push(lv.interpolator, lv.interpolatorPosition, process(level + 1, down));
+    const float *u = &lv.interpolator[lv.interpolatorPosition]; // oldest first
+    float between = 0.0f;
+    for (int j = 0; j < pairs; ++j)
+      between += h[j] * (u[pairs + j] + u[pairs - 1 - j]);
+    lv.interpolated[0] = 2.0f * between;
+    lv.interpolated[1] = u[pairs];
+  }
+  lv.phase ^= 1;
+
+  float delayed = lv.delay[lv.delayPosition];
+  lv.delay[lv.delayPosition] = out;
+  if (++lv.delayPosition == (int) lv.delay.size()) lv.delayPosition = 0;
+  return delayed + up;
+}
+
+void ResonatorMultirate::push(std::vector<float> &ring, int &position, float x){
+  if (fabsf(x) < 1e-20f) x = 0.0f; // keep decaying tails out of denormals
+  int size = ring.size() / 2;
+  ring[position] = ring[position + size] = x;
+  if (++position == size) position = 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Resonators
+ * ResonatorMultirate
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorMultirate_H_
+#define ResonatorMultirate_H_
+
+#include <vector>
+
+#include "ResonatorBank.h"
+
+// Renders a bank with its low resonators at a reduced sample rate. Each
+// resonator goes to the lowest of sampleRate, 1/2, 1/4 ... 1/maxFactor at
+// which it sits below bandEdge of that rate, into a group whose coefficients
+// are computed for the group's rate. The input is decimated and the group
+// outputs are interpolated back up through a chain of polyphase half-band
+// filters, one per halving, and the groups above are delayed to line up with
+// them. Bass-heavy models then cost a fraction of rendering every resonator
+// at the full rate.
+//
+// The output is delayed by getLatency() samples (whatever the model, so that
+// it never jumps). compare() measures the error against rendering the bank
+// directly.
+//
+//   multirate.setup(res.getBank(0), context->audioSampleRate, context->audioFrames);
+//   multirate.render(input, output, context->audioFrames); // in render(), instead of the bank
+
+typedef struct _ResonatorMultirateOptions {
+    int maxFactor = 8; // 1, 2, 4 or 8
+    float bandEdge = 0.35f; // highest resonator frequency at a rate, as a fraction of it
+    int taps = 35; // half-band filter length, 4k + 3
+    bool v = true; // verbose printing
+} ResonatorMultirateOptions;
+
+class ResonatorMultirate {
+public:
+    static const int kMaxLevels = 4;
+
+    ResonatorMultirate();
+    ~ResonatorMultirate();
+
+    bool setup(ResonatorBank &bank, float sampleRate, float framesPerBlock, ResonatorMultirateOptions options = ResonatorMultirateOptions());
+
+    // Audio thread; follows changes to the bank. In place if input == output.
+    float render(float in);
+    void render(const float* input, float* output, int frames);
+
+    int getLatency() { return (_levels.empty()) ? 0 : _levels[0].latency; }
+    int getLevels() { return _levels.size(); } // level l renders at sampleRate / 2^l
+    int getGroupSize(int level) { return _levels[level].size; }
+
+    // Ratio in dB of the impulse response of `bank` rendered directly to the
+    // difference from rendering it multirate, over `frames` samples; renders
+    // copies of the bank. The difference is mostly in the first few samples:
+    // an impulse excites more than the reduced rates can carry.
+    static float compare(ResonatorBank &bank, float sampleRate, ResonatorMultirateOptions options = ResonatorMultirateOptions(), int frames = 44100);
+
+private:
+    struct Level {
+        ResonatorBank bank; // the resonators rendered at this level's rate
+        int size;
+        std::vector<ResonatorParams> params;
+
+        // Half-band decimator input and interpolator input, each a doubled
+        // ring so that the filter reads one contiguous window
+        std::vector<float> decimator;
+        int decimatorPosition;
+        std::vector<float> interpolator;
+        int interpolatorPosition;
+        float interpolated[2]; // the pair being played out
+        int phase;
+
+        // Lines this level's own output up with the levels below it
+        std::vector<float> delay;
+        int delayPosition;
+        int latency; // in samples at this level's rate
+    };
+
+    ResonatorMultirateOptions _opt = {};
+    ResonatorBank* _bank = NULL;
+    float _sampleRate = 44100.0f;
+    float _hardLimit = ResonatorUtils().hardLimit;
+    unsigned int _version = 0;
+    std::vector<Level> _levels;
+    std::vector<float> _coefficients; // nonzero half-band taps either side of the centre, innermost first
+
+    void designHalfband();
+    void follow();
+    void regroup();
+    float process(int level, float in);
+    static void push(std::vector<float> &ring, int &position, float x);
+
+};
+
+#endif /* ResonatorMultirate_H_ */
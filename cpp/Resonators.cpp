@@ -6,6 +6,8 @@
  * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
  */
 
+#include <algorithm>
+
 #include "Resonators.h"
 
 Resonators::Resonators(){}
@@ -14,6 +16,9 @@ Resonators::~Resonators(){}
 void Resonators::setup(std::vector<std::string> modelPaths, std::vector<std::string> pitches, float sampleRate, float audioFrames) {
   
   _totalBanks = modelPaths.size();
+  _bankOpts.clear();
+  _models.clear();
+  _banks.clear();
   _bankOpts.reserve(_totalBanks);
   _models.reserve(_totalBanks);
   _banks.reserve(_totalBanks);
@@ -21,6 +26,16 @@ void Resonators::setup(std::vector<std::string> modelPaths, std::vector<std::str
 
   _modelPaths = modelPaths;
   _pitches = pitches;
+  _gains.assign(_totalBanks, 1.0f);
+  _excitations.assign(_totalBanks, 0.0f);
+  _peaks.assign(_totalBanks, 0.0f);
+  _laneInputs.assign(_totalBanks, 0.0f);
+  _modelVersions.assign(_totalBanks, 0);
+
+  // Every bank's resonators in one block (see ResonatorsArena.h)
+  ResonatorBankOptions defaultOpt = {};
+  defaultOpt.total = defaultOpt.defaultSize;
+  _arena.setup(ResonatorBank::getArenaSize(defaultOpt) * _totalBanks, _arenaOpt);
 
   for (int i = 0; i < _totalBanks; ++i) {
 
@@ -32,22 +47,40 @@ void Resonators::setup(std::vector<std::string> modelPaths, std::vector<std::str
     _bankOpts.push_back(tmp_opt);
 
     // ModelLoader
-    ModelLoader tmp_model;
-    _models.push_back(tmp_model);
+    _models.emplace_back();
     _models[i].reserve(_bankOpts[i].defaultSize);
-    _models[i].load(_modelPaths[i]);
-    _models[i].shiftToNote(_pitches[i]);
 
-    // ResonatorBank
-    ResonatorBank tmp_bank;
-    tmp_bank.setup(_bankOpts[i], sampleRate, audioFrames);
-    _banks.push_back(tmp_bank);
+    // Banks sharing a model file reuse the first bank's copy rather than parsing it again
+    int first = std::find(_modelPaths.begin(), _modelPaths.begin() + i, _modelPaths[i]) - _modelPaths.begin();
+    if (first < i) _models[i] = _models[first];
+    else           loadModel(i, _modelPaths[i]);
+    shiftModel(i);
+    _models[i].setVerbose(false); // pitch and model commands reach it from the audio thread
+
+    // ResonatorBank, built in place so that its resonators stay in the arena
+    _banks.emplace_back();
+    _banks[i].setup(_bankOpts[i], sampleRate, audioFrames, &_arena);
     _banks[i].setOptions(_bankOpts[i]);
-    _banks[i].setBank(_models[i].getModel());
-    _banks[i].update();
+    applyModel(i);
 
   }
 
+  _lanes.setup(_banks, _lanesOpt);
+
+}
+
+ResonatorsInfo Resonators::getInfo() {
+  ResonatorKernelInfo kernels = ResonatorKernels::getInfo();
+  ResonatorsInfo info = {};
+  info.isa         = kernels.isa;
+  info.vectorWidth = kernels.width;
+  info.banks       = _totalBanks;
+  for (int i = 0; i < _totalBanks; ++i) info.resonators += _banks[i].getSize();
+  info.arenaSize   = _arena.getSize();
+  info.hugePages   = _arena.isHugePages();
+  info.locked      = _arena.isLocked();
+  info.laneGroups  = _lanes.getGroups();
+  return info;
 }
 
 void Resonators::update() {
@@ -58,53 +91,139 @@ void Resonators::updateBank(int index) {
   _banks[index].update();
 }
 float Resonators::render(int index, float in) {
-  return _banks[index].render(in);
+  _lanes.release(); // banks rendered one at a time render themselves
+  in += _excitations[index];
+  _excitations[index] = 0.0f;
+  float out = _banks[index].render(in) * _gains[index];
+  float level = fabsf(out);
+  if (level > _peaks[index]) _peaks[index] = level;
+  return out;
 }
-std::vector<float> Resonators::render(std::vector<float> inputs) {
-  std::vector<float> outputs;
-  for (int i = 0; i < _totalBanks; ++i)
-    outputs.push_back(render(i, inputs[i]));
+std::vector<float> Resonators::render(std::vector<float> const &inputs) {
+  std::vector<float> outputs(_totalBanks);
+  render(inputs.data(), outputs.data());
   return outputs;
 }
+void Resonators::render(const float* inputs, float* outputs) {
+  for (int i = 0; i < _totalBanks; ++i) {
+    _laneInputs[i] = inputs[i] + _excitations[i];
+    _excitations[i] = 0.0f;
+  }
+  _lanes.render(_laneInputs.data(), outputs);
+  for (int i = 0; i < _totalBanks; ++i) {
+    outputs[i] *= _gains[i];
+    float level = fabsf(outputs[i]);
+    if (level > _peaks[i]) _peaks[i] = level;
+  }
+}
 
-void Resonators::setModel(int bankIndex, std::string modelPath){
+void Resonators::setModel(int bankIndex, std::string const &modelPath){
   int i = bankIndex;
   _modelPaths[i] = modelPath;
-  _models[i].load(_modelPaths[i]);
+  loadModel(i, _modelPaths[i]);
 
-  _models[i].shiftToNote(_pitches[i]);
-  _banks[i].setSize(_models[i].getSize());
-  _banks[i].setBank(_models[i].getModel());
-  _banks[i].update(); // TODO: remove?
+  shiftModel(i);
+  applyModel(i);
 }
 
 void Resonators::setModel(int bankIndex, JSONValue *modelJSON){
   int i = bankIndex;
   _models[i].parse(modelJSON);
 
-  _models[i].shiftToNote(_pitches[i]);
-  _banks[i].setSize(_models[i].getSize());
-  _banks[i].setBank(_models[i].getModel());
-  _banks[i].update(); // TODO: remove?
+  shiftModel(i);
+  applyModel(i);
+}
+
+void Resonators::setModel(int bankIndex, const char* modelJSON, size_t length){
+  int i = bankIndex;
+  if (!_models[i].parse(modelJSON, length, false)) return;
+
+  shiftModel(i);
+  applyModel(i);
 }
 
-void Resonators::setPitch(int bankIndex, std::string pitch){
+void Resonators::setPitch(int bankIndex, std::string const &pitch){
   int i = bankIndex;
   _pitches[i] = pitch;
-  _models[i].shiftToNote(_pitches[i]);
+  shiftModel(i);
   _banks[i].setBank(_models[i].getModel());
   _banks[i].update(); // TODO: remove?
+  ++_modelVersions[i];
 }
 
-void Resonators::setResonators(int bankIndex, std::vector<int> resIndexes, std::vector<ResonatorParams> params){
+void Resonators::setResonators(int bankIndex, std::vector<int> const &resIndexes, std::vector<ResonatorParams> const &params){
   for (int i = 0; i < params.size(); ++i) {
     ResonatorParams tmp_p = {params[i].freq, params[i].gain, params[i].decay};
     _banks[bankIndex].setResonator(resIndexes[i], tmp_p);
+    _banks[bankIndex].updateResonator(resIndexes[i]);
+  }
+}
+
+void Resonators::setResonators(int bankIndex, const ResonatorParamDelta* deltas, int length){
+  if (bankIndex < 0 || bankIndex >= _totalBanks) return;
+  for (int i = 0; i < length; ++i) {
+    ResonatorParamDelta delta = deltas[i];
+    if (_models[bankIndex].applyDelta(delta)) _banks[bankIndex].setResonators(&delta, 1);
   }
-  _banks[bankIndex].update();
 }
 
-std::vector<ResonatorParams> Resonators::getModel(int bankIndex) {
+void Resonators::setBankState(int bankIndex, const ResonatorParams* params, const ResonatorCoefficients* coefficients, int size, float fundamental, float shiftRatio){
+  int i = bankIndex;
+  _models[i].setModel(params, size, fundamental, shiftRatio);
+  _banks[i].setSize(size);
+  _banks[i].setBank(params, size);
+  _banks[i].setCoefficients(coefficients, size);
+  ++_modelVersions[i];
+}
+
+void Resonators::setGain(int bankIndex, float gain){
+  if (bankIndex >= 0 && bankIndex < _totalBanks) _gains[bankIndex] = gain;
+}
+
+void Resonators::excite(int bankIndex, float amount){
+  if (bankIndex >= 0 && bankIndex < _totalBanks) _excitations[bankIndex] += amount;
+}
+
+void Resonators::impulse(int bankIndex, float amount){
+  if (bankIndex < 0 || bankIndex >= _totalBanks) return;
+  _lanes.release(); // the bank's state may be in a lane
+  _banks[bankIndex].impulse(amount);
+}
+
+void Resonators::apply(ResonatorsCommand const &command){
+  int i = command.bank;
+  if (i < 0 || i >= _totalBanks) return;
+  switch (command.type) {
+    case ResonatorsCommand::kResonators:
+      setResonators(i, command.deltas, (command.length < ResonatorsCommand::kMaxDeltas) ? command.length : ResonatorsCommand::kMaxDeltas);
+      break;
+    case ResonatorsCommand::kPitch:
+      setPitch(i, std::string(command.pitch, strnlen(command.pitch, ResonatorsCommand::kMaxPitch)));
+      break;
+    case ResonatorsCommand::kGain:
+      setGain(i, command.value);
+      break;
+    case ResonatorsCommand::kNote:
+      if (command.pitch[0] != 0) setPitch(i, std::string(command.pitch, strnlen(command.pitch, ResonatorsCommand::kMaxPitch)));
+      excite(i, command.value);
+      break;
+    case ResonatorsCommand::kImpulse:
+      impulse(i, command.value);
+      break;
+  }
+}
+
+int Resonators::applyCommands(ResonatorsCommandQueue &queue){
+  ResonatorsCommand command;
+  int applied = 0;
+  while (queue.pop(command)) {
+    apply(command);
+    ++applied;
+  }
+  return applied;
+}
+
+const std::vector<ResonatorParams>& Resonators::getModel(int bankIndex) {
   return _models[bankIndex].getModel();
 }
 
@@ -112,20 +231,45 @@ std::string Resonators::getPitch(int bankIndex) {
   return _pitches[bankIndex];
 }
 
-std::vector<ResonatorParams> Resonators::getResonators(int bankIndex, std::vector<int> resIndexes) {
-  std::vector<ResonatorParams> params = {};
+std::vector<ResonatorParams> Resonators::getResonators(int bankIndex, std::vector<int> const &resIndexes) {
+  std::vector<ResonatorParams> params;
+  params.reserve(resIndexes.size());
   for (int i = 0; i < resIndexes.size(); ++i) {
-    params.push_back(_banks[i].getResonator(resIndexes[i]));
+    params.push_back(_banks[bankIndex].getResonator(resIndexes[i]));
   }
   return params;
 }
 
+void Resonators::loadModel(int bankIndex, std::string const &modelPath){
+  ModelBinary *binary = (_library != NULL) ? _library->find(modelPath) : NULL;
+  if (binary != NULL) _models[bankIndex].parse(*binary);
+  else                _models[bankIndex].load(modelPath);
+}
+
+// An empty pitch plays the model at its own fundamental
+void Resonators::shiftModel(int bankIndex){
+  if (_pitches[bankIndex].empty()) _models[bankIndex].unshift();
+  else                             _models[bankIndex].shiftToNote(_pitches[bankIndex]);
+}
+
+// Coefficients baked into a binary model are used as they are when the bank
+// plays it unshifted at a rate they were baked for
+void Resonators::applyModel(int bankIndex){
+  int i = bankIndex;
+  _banks[i].setSize(_models[i].getSize());
+  _banks[i].setBank(_models[i].getModel());
+  const ResonatorCoefficients* baked = _models[i].getBakedCoefficients(_bankOpts[i].sampleRate);
+  if (baked != NULL) _banks[i].setCoefficients(baked, _models[i].getSize());
+  else               _banks[i].update();
+  ++_modelVersions[i];
+}
+
 void Resonators::printModel(int index){
   _models[index].prettyPrintModel();
 }
 
 void Resonators::printDebugModel(int index){
-  std::vector<ResonatorParams> model = _models[index].getModel();
+  const std::vector<ResonatorParams> &model = _models[index].getModel();
   rt_printf("model[%d] size: %d\n", index, model.size());
   for (int i = 0; i < model.size(); ++i) {
     rt_printf("modelRes[%d] freq: %f gain: %f: decay: %f\n", i, model[i].freq, model[i].gain, model[i].decay);
@@ -133,9 +277,10 @@ void Resonators::printDebugModel(int index){
 }
 
 void Resonators::printDebugBank(int index){
-  std::vector<ResonatorParams> params = _banks[index].getBankAsParams();
-  rt_printf("banks[%d] size: %d\n", index, params.size());
-  for (int i = 0; i < params.size(); ++i) {
-    rt_printf("bankRes[%d] freq: %f gain: %f: decay: %f\n", i, params[i].freq, params[i].gain, params[i].decay);
+  ResonatorBank &bank = _banks[index];
+  rt_printf("banks[%d] size: %d\n", index, bank.getSize());
+  for (int i = 0; i < bank.getSize(); ++i) {
+    ResonatorParams p = bank.getResonator(i);
+    rt_printf("bankRes[%d] freq: %f gain: %f: decay: %f\n", i, p.freq, p.gain, p.decay);
   }
 }
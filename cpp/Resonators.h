@@ -15,7 +15,10 @@
 #include <string> 
 
 #include "ResonatorBank.h"
+#include "ResonatorLanes.h"
 #include "ModelLoader.h"
+#include "ModelLibrary.h"
+#include "ResonatorsCommandQueue.h"
 // #include "../Utils/Pitch.h"
 
 class Resonators {
@@ -23,38 +26,104 @@ public:
     Resonators();
     ~Resonators();
 
+    // A pitch of "" plays that bank's model at its own fundamental, which also
+    // lets it use coefficients baked into a binary model (ModelBinary.h)
     void setup(std::vector<std::string> modelPaths, std::vector<std::string> pitches, float sampleRate, float audioFrames);
 
+    // Resolve model paths through a packed library (ModelLibrary.h) before the
+    // file system. Call before setup(); the library must outlive this object.
+    void setLibrary(ModelLibrary *library) { _library = library; }
+
+    // How the block holding every bank's resonators is mapped (see
+    // ResonatorsArena.h). Call before setup().
+    void setArenaOptions(ResonatorsArenaOptions options) { _arenaOpt = options; }
+    ResonatorsArena& getArena() { return _arena; }
+
+    // How render(inputs, outputs) groups banks of similar size into vector
+    // lanes (see ResonatorLanes.h). Call before setup().
+    void setLanesOptions(ResonatorLanesOptions options) { _lanesOpt = options; }
+    ResonatorLanes& getLanes() { return _lanes; }
+
     void update();
     void updateBank(int index);
 
     float render(float in);
     float render(int index, float in);
-    std::vector<float> render(std::vector<float> inputs);
+    std::vector<float> render(std::vector<float> const &inputs);
+    void render(const float* inputs, float* outputs); // one sample per bank, allocation-free
 
-    void setModel(int bankIndex, std::string modelPath);
+    void setModel(int bankIndex, std::string const &modelPath);
     void setModel(int bankIndex, JSONValue *modelJSON);
-    void setPitch(int bankIndex, std::string pitch);
-    void setResonators(int bankIndex, std::vector<int> resIndexes, std::vector<ResonatorParams> params);
+    void setModel(int bankIndex, const char* modelJSON, size_t length); // UTF-8, allocation-free
+    void setPitch(int bankIndex, std::string const &pitch);
+    void setResonators(int bankIndex, std::vector<int> const &resIndexes, std::vector<ResonatorParams> const &params);
+    // Apply a batch of per-resonator changes, with frequencies as in the model
+    // file; only the resonators changed are recomputed. Allocation-free.
+    void setResonators(int bankIndex, const ResonatorParamDelta* deltas, int length);
+    void setResonators(int bankIndex, std::vector<ResonatorParamDelta> const &deltas) { setResonators(bankIndex, deltas.data(), deltas.size()); }
     // void setModels(std::vector<std::string> modelPaths);
     // void setModels(std::vector<JSONValue> *modelsJSON);
     // void setPitches(std::vector<std::string> pitches);
-    std::vector<ResonatorParams> getModel(int bankIndex);
+    // Swap in a bank's parameters and coefficients prepared elsewhere (see
+    // ModelLoadService.h), without recomputing; allocation-free
+    void setBankState(int bankIndex, const ResonatorParams* params, const ResonatorCoefficients* coefficients, int size, float fundamental, float shiftRatio = 1.0f);
+    ResonatorBank& getBank(int bankIndex) { return _banks[bankIndex]; }
+
+    // Per-bank output gain, and an impulse added to the bank's next input sample
+    void setGain(int bankIndex, float gain);
+    float getGain(int bankIndex) { return _gains[bankIndex]; }
+    void excite(int bankIndex, float amount);
+    // Resonator::impulse() for every resonator of a bank, now rather than with the next input sample
+    void impulse(int bankIndex, float amount);
+
+    // Peak absolute output of a bank since the last resetPeak(), for metering
+    float getPeak(int bankIndex) { return _peaks[bankIndex]; }
+    void resetPeak(int bankIndex) { _peaks[bankIndex] = 0.0f; }
+    // ResonatorBank::getAmplitudes(), wherever the bank is being rendered
+    void getAmplitudes(int bankIndex, float* amplitudes, int length) { _lanes.getAmplitudes(bankIndex, amplitudes, length); }
+
+    // Audio thread: apply one command, or everything waiting in a queue
+    void apply(ResonatorsCommand const &command);
+    int applyCommands(ResonatorsCommandQueue &queue);
+
+    int getTotalBanks() { return _totalBanks; }
+    // Kernels chosen for this processor, and how the arena is mapped
+    ResonatorsInfo getInfo();
+
+    const std::vector<ResonatorParams>& getModel(int bankIndex);
+    // Model frequencies over those in the model file, after setPitch()
+    float getShiftRatio(int bankIndex) { return _models[bankIndex].getShiftRatio(); }
     std::string getPitch(int bankIndex);
-    std::vector<ResonatorParams> getResonators(int bankIndex, std::vector<int> resIndexes);
+    // Counts the times a bank has been set back to its model, by a pitch or
+    // model change, so that anything held over the model can tell
+    unsigned int getModelVersion(int bankIndex) { return _modelVersions[bankIndex]; }
+    std::vector<ResonatorParams> getResonators(int bankIndex, std::vector<int> const &resIndexes);
 
 private:
     // WebSocket
     ResonatorsWSOptions _wsOpt = {};
 
+    ResonatorsArenaOptions _arenaOpt = {};
+    ResonatorsArena _arena; // declared before _banks, which point into it
     std::vector<ResonatorBankOptions> _bankOpts;
     std::vector<ResonatorBank>        _banks;
+    ResonatorLanesOptions _lanesOpt = {};
+    ResonatorLanes                    _lanes;
     std::vector<ModelLoader>          _models;
     std::vector<std::string>          _modelPaths;
     std::vector<std::string>          _pitches;
+    std::vector<float>                _gains;
+    std::vector<float>                _excitations;
+    std::vector<float>                _peaks;
+    std::vector<float>                _laneInputs;
+    std::vector<unsigned int>         _modelVersions;
     int _totalBanks = 0;
+    ModelLibrary *_library = NULL;
     // Pitch _p;
 
+    void loadModel(int bankIndex, std::string const &modelPath);
+    void shiftModel(int bankIndex);
+    void applyModel(int bankIndex);
     void printModel(int index);
     void printDebugModel(int index);
     void printDebugBank(int index);
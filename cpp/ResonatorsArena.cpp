@@ -0,0 +1,80 @@
+/*
+ * Resonators
+ * ResonatorsArena
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ResonatorsArena.h"
+
+ResonatorsArena::ResonatorsArena(){}
+ResonatorsArena::~ResonatorsArena(){ cleanup(); }
+
+bool ResonatorsArena::setup(size_t size, ResonatorsArenaOptions options){
+  cleanup();
+  if (size == 0) return false;
+  size = align(size);
+
+  void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (options.hugePages) {
+    // Only succeeds if huge pages have been reserved (vm.nr_hugepages)
+    _mapped = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    block = mmap(NULL, _mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    _hugePages = (block != MAP_FAILED);
+  }
+#endif
+  if (block == MAP_FAILED) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    _mapped = (size + pageSize - 1) & ~(pageSize - 1);
+    block = mmap(NULL, _mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  if (block == MAP_FAILED) {
+    printf("[ResonatorsArena] setup() Error: could not map %zu bytes (%s)\n", _mapped, strerror(errno));
+    _mapped = 0;
+    return false;
+  }
+
+  _block = (char*) block;
+  _size = size;
+  _used = 0;
+
+  // Prefault: touching every page now means the audio thread never takes a
+  // page fault on first use
+  memset(_block, 0, _mapped);
+
+  if (options.lock) {
+    _locked = (mlock(_block, _mapped) == 0);
+    if (!_locked && options.v)
+      printf("[ResonatorsArena] setup() Warning: could not lock %zu bytes into memory (%s)\n", _mapped, strerror(errno));
+  }
+
+  if (options.v)
+    printf("[ResonatorsArena] Mapped %zu bytes%s%s\n", _mapped, _hugePages ? " on huge pages" : "", _locked ? ", locked" : "");
+  return true;
+}
+
+void ResonatorsArena::cleanup(){
+  if (_block == NULL) return;
+  if (_locked) munlock(_block, _mapped);
+  munmap(_block, _mapped);
+  _block = NULL;
+  _size = _mapped = _used = 0;
+  _hugePages = _locked = false;
+}
+
+void* ResonatorsArena::allocate(size_t size){
+  size = align(size);
+  if (_block == NULL || size > _size - _used) return NULL;
+  void* memory = _block + _used;
+  _used += size;
+  return memory;
+}
@@ -0,0 +1,76 @@
+/*
+ * Resonators
+ * ResonatorsArena
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsArena_H_
+#define ResonatorsArena_H_
+
+#include <stddef.h>
+#include <new>
+
+// One contiguous block of memory, sized and mapped once at setup, that the
+// banks of a Resonators object carve their resonators out of (see
+// ResonatorBank::setup()). The block is mapped on huge pages when the system
+// has some reserved, written to up front so that no page faults on first use
+// in the audio thread, and locked into RAM so that it is never paged out.
+// Allocation is a pointer bump; memory is only returned all at once, by
+// setup() or cleanup(), and objects placed here are never destroyed, so only
+// types that own no other memory belong in the arena.
+//
+//   arena.setup(ResonatorBank::getArenaSize(options) * totalBanks);
+//   bank.setup(options, sampleRate, audioFrames, &arena);
+
+typedef struct _ResonatorsArenaOptions {
+    bool hugePages = true; // try MAP_HUGETLB first
+    bool lock = true; // mlock() the block
+    bool v = true; // verbose printing
+} ResonatorsArenaOptions;
+
+class ResonatorsArena {
+public:
+    static const size_t kAlignment = 64; // cache line
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+    ResonatorsArena();
+    ~ResonatorsArena();
+
+    bool setup(size_t size, ResonatorsArenaOptions options = ResonatorsArenaOptions());
+    void cleanup();
+
+    // kAlignment-aligned memory, or NULL once the arena is full
+    void* allocate(size_t size);
+    template <typename T>
+    T* allocate(int count) {
+        T* objects = (T*) allocate(count * sizeof(T));
+        if (objects != NULL)
+            for (int i = 0; i < count; ++i) new (&objects[i]) T();
+        return objects;
+    }
+
+    static size_t align(size_t size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+
+    size_t getSize() { return _size; }
+    size_t getUsed() { return _used; }
+    bool isHugePages() { return _hugePages; }
+    bool isLocked() { return _locked; }
+
+private:
+    char* _block = NULL;
+    size_t _size = 0; // usable bytes
+    size_t _mapped = 0; // bytes mapped, rounded up to whole pages
+    size_t _used = 0;
+    bool _hugePages = false;
+    bool _locked = false;
+
+    // The arena hands out pointers into its block, so it cannot be copied
+    ResonatorsArena(const ResonatorsArena&);
+    ResonatorsArena& operator=(const ResonatorsArena&);
+
+};
+
+#endif /* ResonatorsArena_H_ */
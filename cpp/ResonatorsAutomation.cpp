@@ -0,0 +1,249 @@
+/*
+ * Resonators
+ * ResonatorsAutomation
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <math.h>
+
+#include "ResonatorsAutomation.h"
+
+static float getParam(ResonatorParams const &params, int param) {
+  if (param == Resonator::kFreq) return params.freq;
+  if (param == Resonator::kGain) return params.gain;
+  return params.decay;
+}
+
+ResonatorsAutomation::ResonatorsAutomation() : _started(0), _finished(0), _steps(0), _dropped(0) {}
+
+void ResonatorsAutomation::setup(int totalBanks, float sampleRate, ResonatorsAutomationOptions options){
+  _opt = options;
+  _sampleRate = sampleRate;
+  _period = (int) (sampleRate / _opt.controlRate + 0.5f);
+  if (_period < 1) _period = 1;
+  _sinceStep = 0;
+
+  Ramp empty = {};
+  _ramps.assign(_opt.maxRamps, empty);
+  _totalRamps = 0;
+  Bank bank = {{1.0f, 1.0f, 1.0f}, {0, 0, 0}, {false, false, false}};
+  _banks.assign(totalBanks, bank);
+  _batch.reserve(_opt.maxRamps);
+  _batchBanks.reserve(_opt.maxRamps);
+}
+
+ResonatorsCommand ResonatorsAutomation::ramp(int bank, int index, int param, float target, float seconds, int curve){
+  ResonatorsCommand command = {};
+  command.type = ResonatorsCommand::kRamp;
+  command.bank = bank;
+  command.value = seconds;
+  command.curve = curve;
+  command.length = 1;
+  ResonatorParamDelta &delta = command.deltas[0];
+  delta.index = index;
+  delta.mask = 1 << param;
+  if      (param == Resonator::kFreq) delta.params.freq  = target;
+  else if (param == Resonator::kGain) delta.params.gain  = target;
+  else                                delta.params.decay = target;
+  return command;
+}
+
+void ResonatorsAutomation::add(ResonatorsCommand const &command, Resonators &res){
+  if (command.bank < 0 || command.bank >= (int) _banks.size() || command.bank >= res.getTotalBanks()) {
+    count(_dropped, 1);
+    return;
+  }
+  float samples = command.value * _sampleRate + 0.5f;
+  int duration = (samples > 0.0f) ? (int) samples : 0;
+  int length = (command.length < ResonatorsCommand::kMaxDeltas) ? command.length : ResonatorsCommand::kMaxDeltas;
+  for (int i = 0; i < length; ++i) {
+    const ResonatorParamDelta &delta = command.deltas[i];
+    for (int param = Resonator::kFreq; param <= Resonator::kDecay; ++param)
+      if (delta.mask & (1 << param))
+        start(res, command.bank, delta.index, param, getParam(delta.params, param), duration, command.curve);
+  }
+}
+
+int ResonatorsAutomation::applyCommands(ResonatorsCommandQueue &queue, Resonators &res){
+  ResonatorsCommand command;
+  int taken = 0;
+  while (queue.pop(command)) {
+    if (command.type == ResonatorsCommand::kRamp) add(command, res);
+    else res.apply(command);
+    ++taken;
+  }
+  return taken;
+}
+
+int ResonatorsAutomation::process(Resonators &res, int frames){
+  if (_totalRamps == 0) {
+    _sinceStep = 0;
+    return 0;
+  }
+  _sinceStep += frames;
+  if (_sinceStep < _period) return 0;
+  int advance = _sinceStep;
+  _sinceStep = 0;
+
+  int steps = 0;
+  _batch.clear();
+  _batchBanks.clear();
+  for (int i = 0; i < _totalRamps; ) {
+    Ramp &ramp = _ramps[i];
+    ramp.elapsed += advance;
+    bool done = ramp.elapsed >= ramp.duration;
+    if (done || ramp.elapsed > 0) {
+      step(ramp, done ? ramp.target : getValue(ramp));
+      ++steps;
+    }
+    if (done) {
+      _ramps[i] = _ramps[--_totalRamps];
+      count(_finished, 1);
+    } else {
+      ++i;
+    }
+  }
+
+  // Resonators first, through the model, each recomputed once; then the
+  // ratios, over the model as it now is
+  for (unsigned int i = 0; i < _batch.size(); ++i) {
+    int b = _batchBanks[i];
+    ResonatorParamDelta const &delta = _batch[i];
+    float ratios[3];
+    for (int param = Resonator::kFreq; param <= Resonator::kDecay; ++param) ratios[param] = getRatio(res, b, param);
+    res.setResonators(b, &delta, 1);
+
+    Bank &state = _banks[b];
+    ResonatorBank &bank = res.getBank(b);
+    const std::vector<ResonatorParams> &model = res.getModel(b);
+    bool held = false;
+    for (int param = Resonator::kFreq; param <= Resonator::kDecay; ++param) {
+      if (!(delta.mask & (1 << param)) || ratios[param] == 1.0f || state.dirty[param]) continue;
+      bank.setResonatorParam(delta.index, param, getParam(model[delta.index], param) * ratios[param]);
+      held = true;
+    }
+    if (held) bank.updateResonator(delta.index);
+  }
+  for (unsigned int b = 0; b < _banks.size(); ++b)
+    if (_banks[b].dirty[Resonator::kFreq] || _banks[b].dirty[Resonator::kGain] || _banks[b].dirty[Resonator::kDecay]) applyRatios(res, b);
+
+  count(_steps, steps);
+  return steps;
+}
+
+ResonatorsAutomationStats ResonatorsAutomation::getStats(){
+  ResonatorsAutomationStats stats = {
+    _started.load(std::memory_order_relaxed),
+    _finished.load(std::memory_order_relaxed),
+    _steps.load(std::memory_order_relaxed),
+    _dropped.load(std::memory_order_relaxed)
+  };
+  return stats;
+}
+
+// private methods
+
+void ResonatorsAutomation::start(Resonators &res, int bank, int index, int param, float target, int duration, int curve){
+  float current;
+  if (index < 0) {
+    index = -1;
+    current = getRatio(res, bank, param);
+  } else {
+    const std::vector<ResonatorParams> &model = res.getModel(bank);
+    if (index >= (int) model.size()) {
+      count(_dropped, 1);
+      return;
+    }
+    current = getParam(model[index], param);
+    if (param == Resonator::kFreq) current /= res.getShiftRatio(bank);
+  }
+
+  // A ramp of the same parameter is replaced, from where it has got to
+  Ramp *ramp = NULL;
+  for (int i = 0; i < _totalRamps && ramp == NULL; ++i)
+    if (_ramps[i].bank == bank && _ramps[i].index == index && _ramps[i].param == param) ramp = &_ramps[i];
+  if (ramp == NULL) {
+    if (_totalRamps == (int) _ramps.size()) {
+      count(_dropped, 1);
+      return;
+    }
+    ramp = &_ramps[_totalRamps++];
+  }
+
+  ramp->bank = bank;
+  ramp->index = index;
+  ramp->param = param;
+  ramp->curve = curve;
+  ramp->start = current;
+  ramp->target = target;
+  ramp->logRatio = 0.0f;
+  if (curve == ResonatorsCommand::kExponential) {
+    if (current > 0.0f && target > 0.0f) ramp->logRatio = logf(target / current);
+    else ramp->curve = ResonatorsCommand::kLinear;
+  }
+  ramp->duration = duration;
+  ramp->elapsed = -_sinceStep; // the time already counted towards the next step is not this ramp's
+  count(_started, 1);
+}
+
+// The bank's ratio to its model, unless the bank has been set back to the
+// model (by a pitch or model change) since it was applied
+float ResonatorsAutomation::getRatio(Resonators &res, int bank, int param){
+  Bank &state = _banks[bank];
+  if (state.ratio[param] != 1.0f && !state.dirty[param] && state.version[param] != res.getModelVersion(bank))
+    state.ratio[param] = 1.0f;
+  return state.ratio[param];
+}
+
+float ResonatorsAutomation::getValue(Ramp const &ramp){
+  float t = (float) ramp.elapsed / ramp.duration;
+  switch (ramp.curve) {
+    case ResonatorsCommand::kExponential:
+      return ramp.start * expf(ramp.logRatio * t);
+    case ResonatorsCommand::kSmooth:
+      t = t * t * (3.0f - 2.0f * t);
+      break;
+  }
+  return ramp.start + (ramp.target - ramp.start) * t;
+}
+
+void ResonatorsAutomation::step(Ramp const &ramp, float value){
+  if (ramp.index < 0) {
+    _banks[ramp.bank].ratio[ramp.param] = value;
+    _banks[ramp.bank].dirty[ramp.param] = true;
+    return;
+  }
+  unsigned int i = 0;
+  while (i < _batch.size() && (_batchBanks[i] != ramp.bank || _batch[i].index != ramp.index)) ++i;
+  if (i == _batch.size()) {
+    ResonatorParamDelta delta = {};
+    delta.index = ramp.index;
+    _batch.push_back(delta);
+    _batchBanks.push_back(ramp.bank);
+  }
+  ResonatorParamDelta &delta = _batch[i];
+  delta.mask |= 1 << ramp.param;
+  if      (ramp.param == Resonator::kFreq) delta.params.freq  = value;
+  else if (ramp.param == Resonator::kGain) delta.params.gain  = value;
+  else                                     delta.params.decay = value;
+}
+
+// Sets the bank to its model times the ratios that changed, and recomputes
+// it in one pass
+void ResonatorsAutomation::applyRatios(Resonators &res, int bank){
+  Bank &state = _banks[bank];
+  ResonatorBank &resBank = res.getBank(bank);
+  const std::vector<ResonatorParams> &model = res.getModel(bank);
+  int size = resBank.getSize();
+  if (size > (int) model.size()) size = model.size();
+  for (int param = Resonator::kFreq; param <= Resonator::kDecay; ++param) {
+    if (!state.dirty[param]) continue;
+    state.dirty[param] = false;
+    for (int m = 0; m < size; ++m) resBank.setResonatorParam(m, param, getParam(model[m], param) * state.ratio[param]);
+    state.version[param] = res.getModelVersion(bank);
+  }
+  resBank.update();
+}
@@ -0,0 +1,118 @@
+/*
+ * Resonators
+ * ResonatorsAutomation
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsAutomation_H_
+#define ResonatorsAutomation_H_
+
+#include <atomic>
+#include <vector>
+
+#include "Resonators.h"
+#include "ResonatorsCommandQueue.h"
+
+// Ramps of resonator parameters, run by the audio thread: a control thread
+// sends a kRamp command once (see ramp()), and process() moves the
+// parameters towards their targets at `controlRate`, recomputing only the
+// coefficients that change, rather than a control thread sending a new
+// value for every step.
+//
+// A ramp of resonator `index` goes to a value as in the model file, as
+// Resonators::setResonators() sets it. A ramp of index -1 goes to a ratio
+// of the whole bank to its model instead (2 for a freq an octave up, 0.5 for
+// half the gain); per-resonator ramps then move the model under it. A ratio
+// held away from 1 lasts until the bank's pitch or model changes. A new ramp
+// of a parameter already ramping starts from where that one has got to.
+// Audio thread only, except for ramp() and getStats().
+//
+//   automation.setup(res.getTotalBanks(), context->audioSampleRate);
+//   commands.push(ResonatorsAutomation::ramp(0, -1, Resonator::kFreq, 2.0f, 3.0f)); // control threads
+//   automation.applyCommands(commands, res); // at the top of render()
+//   automation.process(res, context->audioFrames);
+
+typedef struct _ResonatorsAutomationOptions {
+    int maxRamps = 64; // ramps running at once
+    float controlRate = 1000.0f; // Hz; steps are taken at most once per block
+} ResonatorsAutomationOptions;
+
+typedef struct _ResonatorsAutomationStats {
+    unsigned int started; // ramps taken in
+    unsigned int finished; // ramps that reached their target
+    unsigned int steps; // parameter values set on the way
+    unsigned int dropped; // ramps refused for want of room, or for an unknown bank
+} ResonatorsAutomationStats;
+
+class ResonatorsAutomation {
+public:
+    ResonatorsAutomation();
+    ~ResonatorsAutomation(){}
+
+    void setup(int totalBanks, float sampleRate, ResonatorsAutomationOptions options = ResonatorsAutomationOptions());
+
+    // A kRamp command: `param` (Resonator::kFreq, kGain or kDecay) of
+    // resonator `index` of `bank`, or of the whole bank for -1, to `target`
+    // over `seconds`
+    static ResonatorsCommand ramp(int bank, int index, int param, float target, float seconds, int curve = ResonatorsCommand::kLinear);
+
+    // Start (or retarget) the ramps of a kRamp command
+    void add(ResonatorsCommand const &command, Resonators &res);
+    // Drain the queue: ramps are taken in, other commands applied to `res`
+    int applyCommands(ResonatorsCommandQueue &queue, Resonators &res);
+    // Once per block: step the ramps if a control period has passed.
+    // Returns the number of parameter values set.
+    int process(Resonators &res, int frames);
+
+    int getActive() { return _totalRamps; }
+    ResonatorsAutomationStats getStats();
+
+private:
+    struct Ramp {
+        int bank;
+        int index; // -1 for the bank's ratio to its model
+        int param;
+        int curve;
+        float start;
+        float target;
+        float logRatio; // log(target / start), for kExponential
+        int duration; // samples
+        int elapsed; // negative until the control period it started in is over
+    };
+    struct Bank {
+        float ratio[3]; // per parameter, of the bank to its model
+        unsigned int version[3]; // Resonators::getModelVersion() when that ratio was applied
+        bool dirty[3];
+    };
+
+    ResonatorsAutomationOptions _opt = {};
+    float _sampleRate = 44100.0f;
+    int _period = 44; // samples per step
+    int _sinceStep = 0;
+    std::vector<Ramp> _ramps; // the first _totalRamps are running
+    int _totalRamps = 0;
+    std::vector<Bank> _banks;
+    std::vector<ResonatorParamDelta> _batch; // per-resonator steps, merged
+    std::vector<int> _batchBanks;
+
+    std::atomic<unsigned int> _started;
+    std::atomic<unsigned int> _finished;
+    std::atomic<unsigned int> _steps;
+    std::atomic<unsigned int> _dropped;
+
+    void start(Resonators &res, int bank, int index, int param, float target, int duration, int curve);
+    float getRatio(Resonators &res, int bank, int param);
+    float getValue(Ramp const &ramp);
+    void step(Ramp const &ramp, float value);
+    void applyRatios(Resonators &res, int bank);
+
+    void count(std::atomic<unsigned int> &counter, unsigned int n) {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); // single writer
+    }
+
+};
+
+#endif /* ResonatorsAutomation_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Resonators
+ * ResonatorsCoalescer
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+
+#include "ResonatorsCoalescer.h"
+
+ResonatorsCoalescer::ResonatorsCoalescer() : _received(0), _merged(0), _applied(0), _dropped(0), _queueDropped(0) {}
+
+void ResonatorsCoalescer::setup(int totalBanks, ResonatorsCoalescerOptions options){
+  _opt = options;
+  _banks.resize(totalBanks);
+  for (int i = 0; i < totalBanks; ++i) {
+    Bank &bank = _banks[i];
+    ResonatorParamDelta empty = {};
+    bank.pending.assign(_opt.maxSize, empty);
+    bank.dirty.clear();
+    bank.dirty.reserve(_opt.maxSize);
+    bank.pitchDirty = bank.gainDirty = false;
+    bank.pitch[0] = 0;
+    bank.gain = 1.0f;
+    bank.excitation = 0.0f;
+    bank.impulse = 0.0f;
+  }
+  _batch.reserve(_opt.maxSize);
+  _blocks = 0;
+}
+
+void ResonatorsCoalescer::add(ResonatorsCommand const &command){
+  if (command.bank < 0 || command.bank >= (int) _banks.size()) {
+    count(_dropped, 1);
+    return;
+  }
+  Bank &bank = _banks[command.bank];
+
+  switch (command.type) {
+    case ResonatorsCommand::kResonators: {
+      int length = (command.length < ResonatorsCommand::kMaxDeltas) ? command.length : ResonatorsCommand::kMaxDeltas;
+      for (int i = 0; i < length; ++i) {
+        const ResonatorParamDelta &delta = command.deltas[i];
+        if (delta.index < 0 || delta.index >= _opt.maxSize) {
+          count(_dropped, 1);
+          continue;
+        }
+        ResonatorParamDelta &pending = bank.pending[delta.index];
+        if (pending.mask == 0) bank.dirty.push_back(delta.index);
+        pending.index = delta.index;
+        for (int param = Resonator::kFreq; param <= Resonator::kDecay; ++param) {
+          int bit = 1 << param;
+          if (!(delta.mask & bit)) continue;
+          count(_received, 1);
+          if (pending.mask & bit) count(_merged, 1);
+          pending.mask |= bit;
+          if      (param == Resonator::kFreq) pending.params.freq  = delta.params.freq;
+          else if (param == Resonator::kGain) pending.params.gain  = delta.params.gain;
+          else                                pending.params.decay = delta.params.decay;
+        }
+      }
+      break;
+    }
+    case ResonatorsCommand::kNote:
+      bank.excitation += command.value;
+      if (command.pitch[0] == 0) {
+        count(_received, 1);
+        break;
+      }
+      // the note also changes the pitch, and is counted there
+      // fall through
+    case ResonatorsCommand::kPitch:
+      count(_received, 1);
+      if (bank.pitchDirty) count(_merged, 1);
+      strncpy(bank.pitch, command.pitch, ResonatorsCommand::kMaxPitch);
+      bank.pitch[ResonatorsCommand::kMaxPitch] = 0;
+      bank.pitchDirty = true;
+      break;
+    case ResonatorsCommand::kImpulse:
+      bank.impulse += command.value;
+      count(_received, 1);
+      break;
+    case ResonatorsCommand::kGain:
+      count(_received, 1);
+      if (bank.gainDirty) count(_merged, 1);
+      bank.gain = command.value;
+      bank.gainDirty = true;
+      break;
+    default:
+      count(_dropped, 1);
+      break;
+  }
+}
+
+int ResonatorsCoalescer::apply(Resonators &res){
+  int applied = 0;
+  bool due = ++_blocks >= _opt.interval;
+  if (due) _blocks = 0;
+
+  for (int b = 0; b < (int) _banks.size() && b < res.getTotalBanks(); ++b) {
+    Bank &bank = _banks[b];
+
+    // Notes are not held back by the interval, and are struck at their pitch
+    bool strike = bank.excitation != 0.0f || bank.impulse != 0.0f;
+    if (bank.pitchDirty && (due || strike)) {
+      res.setPitch(b, bank.pitch);
+      bank.pitchDirty = false;
+      ++applied;
+    }
+    if (bank.excitation != 0.0f) {
+      res.excite(b, bank.excitation);
+      bank.excitation = 0.0f;
+    }
+    if (bank.impulse != 0.0f) {
+      res.impulse(b, bank.impulse);
+      bank.impulse = 0.0f;
+    }
+    if (!due) continue;
+
+    if (!bank.dirty.empty()) {
+      _batch.clear();
+      for (unsigned int i = 0; i < bank.dirty.size(); ++i) {
+        ResonatorParamDelta &pending = bank.pending[bank.dirty[i]];
+        _batch.push_back(pending);
+        applied += ((pending.mask >> Resonator::kFreq) & 1) + ((pending.mask >> Resonator::kGain) & 1) + ((pending.mask >> Resonator::kDecay) & 1);
+        pending.mask = 0;
+      }
+      bank.dirty.clear();
+      res.setResonators(b, _batch.data(), _batch.size());
+    }
+    if (bank.gainDirty) {
+      res.setGain(b, bank.gain);
+      bank.gainDirty = false;
+      ++applied;
+    }
+  }
+
+  count(_applied, applied);
+  return applied;
+}
+
+int ResonatorsCoalescer::applyCommands(ResonatorsCommandQueue &queue, Resonators &res){
+  ResonatorsCommand command;
+  while (queue.pop(command)) add(command);
+  _queueDropped.store(queue.getDropped(), std::memory_order_relaxed);
+  return apply(res);
+}
+
+ResonatorsCoalescerStats ResonatorsCoalescer::getStats(){
+  ResonatorsCoalescerStats stats = {
+    _received.load(std::memory_order_relaxed),
+    _merged.load(std::memory_order_relaxed),
+    _applied.load(std::memory_order_relaxed),
+    _dropped.load(std::memory_order_relaxed) + _queueDropped.load(std::memory_order_relaxed)
+  };
+  return stats;
+}
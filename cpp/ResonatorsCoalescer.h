@@ -0,0 +1,88 @@
+/*
+ * Resonators
+ * ResonatorsCoalescer
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsCoalescer_H_
+#define ResonatorsCoalescer_H_
+
+#include <atomic>
+#include <vector>
+
+#include "Resonators.h"
+#include "ResonatorsCommandQueue.h"
+
+// Merges control commands between blocks so that only the latest value of
+// each (bank, resonator, parameter), pitch and gain is applied, once per
+// block (or every `interval` blocks). However fast a slider moves, each
+// resonator's coefficients are recomputed at most once per applied block.
+// Notes and impulses are summed rather than merged, and are never held back:
+// a bank with a note to fire takes its pending pitch with it. kModel and kRamp
+// commands are not coalesced (see ResonatorsScheduler and ResonatorsAutomation)
+// and are counted as dropped, as are commands for a bank out of range and
+// edits to a resonator beyond maxSize. Audio thread only, except for getStats().
+//
+//   coalescer.setup(res.getTotalBanks());
+//   coalescer.applyCommands(commands, res); // at the top of render()
+
+typedef struct _ResonatorsCoalescerOptions {
+    int maxSize = 40; // resonators per bank, as ResonatorBankOptions::maxSize
+    int interval = 1; // blocks between applying changes
+} ResonatorsCoalescerOptions;
+
+typedef struct _ResonatorsCoalescerStats {
+    unsigned int received; // parameter values, pitches, gains and notes taken in
+    unsigned int merged; // values replaced by a newer one before being applied
+    unsigned int applied; // values applied
+    unsigned int dropped; // commands refused by a full queue, of a type not coalesced or for no such bank, and edits to no such resonator
+} ResonatorsCoalescerStats;
+
+class ResonatorsCoalescer {
+public:
+    ResonatorsCoalescer();
+    ~ResonatorsCoalescer(){}
+
+    void setup(int totalBanks, ResonatorsCoalescerOptions options = ResonatorsCoalescerOptions());
+
+    void add(ResonatorsCommand const &command);
+    int apply(Resonators &res); // returns the number of values applied
+
+    // Drain the queue into the table, then apply it if this block is due
+    int applyCommands(ResonatorsCommandQueue &queue, Resonators &res);
+
+    ResonatorsCoalescerStats getStats();
+
+private:
+    struct Bank {
+        std::vector<ResonatorParamDelta> pending; // latest value per resonator, by `mask`
+        std::vector<int> dirty; // resonators with anything pending, in arrival order
+        bool pitchDirty;
+        char pitch[ResonatorsCommand::kMaxPitch + 1];
+        bool gainDirty;
+        float gain;
+        float excitation;
+        float impulse;
+    };
+
+    ResonatorsCoalescerOptions _opt = {};
+    std::vector<Bank> _banks;
+    std::vector<ResonatorParamDelta> _batch; // one bank's changes, contiguous
+    int _blocks = 0;
+
+    std::atomic<unsigned int> _received;
+    std::atomic<unsigned int> _merged;
+    std::atomic<unsigned int> _applied;
+    std::atomic<unsigned int> _dropped; // by add()
+    std::atomic<unsigned int> _queueDropped;
+
+    void count(std::atomic<unsigned int> &counter, unsigned int n) {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); // single writer
+    }
+
+};
+
+#endif /* ResonatorsCoalescer_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Resonators
+ * ResonatorsCommandQueue
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsCommandQueue_H_
+#define ResonatorsCommandQueue_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+
+#include "Resonator.h"
+
+// A control change for the audio thread, small enough to copy by value.
+// Larger batches of resonator changes are sent as several commands.
+typedef struct _ResonatorsCommand {
+
+    enum Type {
+        kResonators, // `deltas[0 .. length)`, see Resonators::setResonators()
+        kPitch,      // `pitch`, a note name
+        kGain,       // `value`, the bank's output gain
+        kNote,       // `value`, an impulse into the bank, after changing to `pitch` if not empty
+        kImpulse,    // `value`, struck into every resonator's state, see Resonators::impulse()
+        kModel,      // the model loaded for the bank, see ResonatorsScheduler
+        kRamp        // `deltas[0 .. length)` as targets reached over `value` seconds along `curve`, see ResonatorsAutomation
+    };
+    enum Curve {
+        kLinear,
+        kExponential, // e.g. evenly through the octaves of a frequency
+        kSmooth       // linear, easing in and out
+    };
+    static const int kMaxDeltas = 8;
+    static const int kMaxPitch  = 8;
+
+    int type;
+    int bank;
+    float value;
+    char pitch[kMaxPitch];
+    int length;
+    ResonatorParamDelta deltas[kMaxDeltas];
+    int curve; // for kRamp
+    uint64_t time; // sample to apply at, for ResonatorsScheduler
+
+} ResonatorsCommand;
+
+// Bounded lock-free queue of commands from any number of control threads to
+// the audio thread. push() never blocks and fails when the queue is full;
+// pop() is wait-free and must only be called from one thread.
+//
+//   commands.setup(256);
+//   commands.push(cmd);         // control threads
+//   res.applyCommands(commands); // at the top of render()
+
+class ResonatorsCommandQueue {
+public:
+    ResonatorsCommandQueue(){}
+    ~ResonatorsCommandQueue(){}
+
+    // Capacity is rounded up to a power of two
+    void setup(int capacity) {
+      size_t size = 2;
+      while (size < (size_t) capacity) size <<= 1;
+      _cells.reset(new Cell[size]);
+      for (size_t i = 0; i < size; ++i) _cells[i].sequence.store(i, std::memory_order_relaxed);
+      _mask = size - 1;
+      _enqueue.store(0, std::memory_order_relaxed);
+      _dequeue = 0;
+      _dropped.store(0, std::memory_order_relaxed);
+    }
+
+    bool push(ResonatorsCommand const &command) {
+      if (!_cells) return false;
+      size_t pos = _enqueue.load(std::memory_order_relaxed);
+      Cell *cell;
+      while (true) {
+        cell = &_cells[pos & _mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+        if (diff == 0) {
+          if (_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+          return false; // full
+        } else {
+          pos = _enqueue.load(std::memory_order_relaxed);
+        }
+      }
+      cell->command = command;
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(ResonatorsCommand &command) {
+      if (!_cells) return false;
+      Cell *cell = &_cells[_dequeue & _mask];
+      if (cell->sequence.load(std::memory_order_acquire) != _dequeue + 1) return false;
+      command = cell->command;
+      cell->sequence.store(_dequeue + _mask + 1, std::memory_order_release);
+      ++_dequeue;
+      return true;
+    }
+
+    // Commands refused because the queue was full
+    unsigned int getDropped() { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        ResonatorsCommand command;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask = 0;
+    std::atomic<size_t> _enqueue;
+    size_t _dequeue = 0; // consumer only
+    std::atomic<unsigned int> _dropped;
+
+};
+
+#endif /* ResonatorsCommandQueue_H_ */
@@ -0,0 +1,217 @@
+/*
+ * Resonators
+ * ResonatorsModulation
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <math.h>
+
+#include "ResonatorsModulation.h"
+
+// How far frequency (semitones) and decay may drift from what the bank was
+// last swept with before it is swept again
+static const float kThresholds[3] = {0.01f, 0.0f, 0.001f};
+
+ResonatorsModulation::ResonatorsModulation(){}
+
+void ResonatorsModulation::setup(int totalBanks, float sampleRate, ResonatorsModulationOptions options){
+  _opt = options;
+  _sampleRate = sampleRate;
+  _totalBanks = totalBanks;
+
+  int sources = _opt.maxSources;
+  _shapes.assign(sources, kValue);
+  _phases.assign(sources, 0.0f);
+  _rates.assign(sources, 0.0f);
+  _attacks.assign(sources, 0.0f);
+  _releases.assign(sources, 0.0f);
+  _levels.assign(sources, 0.0f);
+  _values.assign(sources, 0.0f);
+  _rising.assign(sources, false);
+  _triggered.assign(sources, 0);
+  _inputs.reset(new std::atomic<float>[sources]);
+  _gates.reset(new std::atomic<bool>[sources]);
+  _triggers.reset(new std::atomic<unsigned int>[sources]);
+  for (int s = 0; s < sources; ++s) {
+    _inputs[s].store(0.0f, std::memory_order_relaxed);
+    _gates[s].store(false, std::memory_order_relaxed);
+    _triggers[s].store(0, std::memory_order_relaxed);
+  }
+
+  _sources.assign(_opt.maxRoutes, 0);
+  _targets.assign(_opt.maxRoutes, 0);
+  _amounts.assign(_opt.maxRoutes, 0.0f);
+  _totalRoutes = 0;
+
+  Destination dest = {false, 0.0f, 0.0f, _opt.smoothing, 0.0f, 0.0f, -1, 0.0f, 1.0f};
+  _destinations.assign(totalBanks * 3, dest);
+  _next = 0;
+}
+
+void ResonatorsModulation::setLFO(int source, int shape, float rate, float phase){
+  if (source < 0 || source >= _opt.maxSources) return;
+  _shapes[source] = shape;
+  _rates[source] = rate;
+  _phases[source] = phase - floorf(phase);
+}
+
+void ResonatorsModulation::setEnvelope(int source, float attack, float release){
+  if (source < 0 || source >= _opt.maxSources) return;
+  _shapes[source] = kEnvelope;
+  _attacks[source] = attack;
+  _releases[source] = release;
+}
+
+void ResonatorsModulation::setValue(int source, float value){
+  if (source >= 0 && source < _opt.maxSources) _inputs[source].store(value, std::memory_order_relaxed);
+}
+
+void ResonatorsModulation::gate(int source, bool on){
+  if (source < 0 || source >= _opt.maxSources) return;
+  if (on) _triggers[source].fetch_add(1, std::memory_order_relaxed);
+  _gates[source].store(on, std::memory_order_relaxed);
+}
+
+void ResonatorsModulation::trigger(int source){
+  if (source >= 0 && source < _opt.maxSources) _triggers[source].fetch_add(1, std::memory_order_relaxed);
+}
+
+int ResonatorsModulation::route(int source, int bank, int param, float amount){
+  if (source < 0 || source >= _opt.maxSources || bank < 0 || bank >= _totalBanks || param < Resonator::kFreq || param > Resonator::kDecay) {
+    printf("[ResonatorsModulation] route() Error: no source %i, bank %i or parameter %i\n", source, bank, param);
+    return -1;
+  }
+  if (_totalRoutes == _opt.maxRoutes) {
+    printf("[ResonatorsModulation] route() Error: all %i routes are taken\n", _opt.maxRoutes);
+    return -1;
+  }
+  int r = _totalRoutes++;
+  _sources[r] = source;
+  _targets[r] = bank * 3 + param;
+  _amounts[r] = amount;
+  _destinations[_targets[r]].used = true;
+  return r;
+}
+
+void ResonatorsModulation::setSmoothing(int bank, int param, float seconds){
+  if (bank >= 0 && bank < _totalBanks && param >= Resonator::kFreq && param <= Resonator::kDecay)
+    _destinations[bank * 3 + param].smoothing = seconds;
+}
+
+void ResonatorsModulation::process(Resonators &res, int frames){
+  if (frames <= 0) return;
+  updateSources(frames);
+
+  int totalDestinations = _destinations.size();
+  for (int d = 0; d < totalDestinations; ++d) _destinations[d].target = 0.0f;
+  for (int r = 0; r < _totalRoutes; ++r) _destinations[_targets[r]].target += _amounts[r] * _values[_sources[r]];
+
+  for (int d = 0; d < totalDestinations; ++d) {
+    Destination &dest = _destinations[d];
+    if (!dest.used) continue;
+    float coefficient = (dest.smoothing > 0.0f) ? 1.0f - expf(-frames / (dest.smoothing * _sampleRate)) : 1.0f;
+    dest.smoothed += (dest.target - dest.smoothed) * coefficient;
+    // Settle on the target, so that the last sweep lands on it exactly
+    if (fabsf(dest.target - dest.smoothed) < 0.1f * kThresholds[d % 3]) dest.smoothed = dest.target;
+  }
+
+  // Gains now; frequencies and decays within the budget, a different
+  // destination first each block so that none waits on the others
+  for (int b = 0; b < _totalBanks && b < res.getTotalBanks(); ++b)
+    if (_destinations[b * 3 + Resonator::kGain].used) updateGain(res, b, _destinations[b * 3 + Resonator::kGain]);
+  int budget = _opt.budget;
+  for (int i = 0; i < totalDestinations && budget > 0; ++i) {
+    int d = (_next + i) % totalDestinations;
+    int bank = d / 3, param = d % 3;
+    if (param == Resonator::kGain || !_destinations[d].used || bank >= res.getTotalBanks()) continue;
+    budget -= sweep(res, bank, param, _destinations[d], budget);
+  }
+  if (totalDestinations > 0) _next = (_next + 1) % totalDestinations;
+}
+
+// private methods
+
+void ResonatorsModulation::updateSources(int frames){
+  float seconds = frames / _sampleRate;
+  for (int s = 0; s < _opt.maxSources; ++s) {
+    float phase = _phases[s] + _rates[s] * seconds;
+    _phases[s] = phase - floorf(phase);
+    float p = _phases[s];
+    switch (_shapes[s]) {
+      case kValue:    _values[s] = _inputs[s].load(std::memory_order_relaxed); break;
+      case kSine:     _values[s] = sinf(2.0f * (float) M_PI * p); break;
+      case kTriangle: _values[s] = 1.0f - 4.0f * fabsf(p - 0.5f); break;
+      case kSaw:      _values[s] = 2.0f * p - 1.0f; break;
+      case kSquare:   _values[s] = (p < 0.5f) ? 1.0f : -1.0f; break;
+      case kEnvelope: {
+        unsigned int triggers = _triggers[s].load(std::memory_order_relaxed);
+        if (triggers != _triggered[s]) {
+          _triggered[s] = triggers;
+          _rising[s] = true;
+        }
+        float level = _levels[s];
+        if (_rising[s]) {
+          level = (_attacks[s] > 0.0f) ? level + seconds / _attacks[s] : 1.0f;
+          if (level >= 1.0f) {
+            level = 1.0f;
+            _rising[s] = false;
+          }
+        } else if (!_gates[s].load(std::memory_order_relaxed)) {
+          level = (_releases[s] > 0.0f) ? level - seconds / _releases[s] : 0.0f;
+          if (level < 0.0f) level = 0.0f;
+        }
+        _levels[s] = _values[s] = level;
+        break;
+      }
+    }
+  }
+}
+
+// The bank's gain times the modulation, on top of whatever it was last set
+// to from elsewhere
+void ResonatorsModulation::updateGain(Resonators &res, int bank, Destination &dest){
+  if (res.getGain(bank) != dest.written) dest.base = res.getGain(bank);
+  dest.written = dest.base * powf(10.0f, dest.smoothed / 20.0f);
+  res.setGain(bank, dest.written);
+}
+
+// Sets up to `budget` of the bank's resonators to the model with the
+// destination's value, and recomputes them in one pass. Returns the number
+// recomputed.
+int ResonatorsModulation::sweep(Resonators &res, int bank, int param, Destination &dest, int budget){
+  ResonatorBank &resBank = res.getBank(bank);
+  const std::vector<ResonatorParams> &model = res.getModel(bank);
+  int size = resBank.getSize();
+  if (size > (int) model.size()) size = model.size();
+  if (size == 0) return 0;
+
+  if (dest.cursor < 0) {
+    bool moved = fabsf(dest.smoothed - dest.applied) > kThresholds[param];
+    bool settled = dest.smoothed == dest.target && dest.smoothed != dest.applied;
+    bool reset = resBank.getResonatorParam(0, param) != dest.written; // by a pitch or model change
+    if (!moved && !settled && !reset) return 0;
+    dest.sweeping = dest.smoothed;
+    dest.cursor = 0;
+  }
+
+  int begin = dest.cursor;
+  int end = (begin + budget < size) ? begin + budget : size;
+  if (param == Resonator::kFreq) {
+    float ratio = powf(2.0f, dest.sweeping / 12.0f);
+    for (int m = begin; m < end; ++m) resBank.setResonatorParam(m, param, model[m].freq * ratio);
+  } else {
+    for (int m = begin; m < end; ++m) resBank.setResonatorParam(m, param, model[m].decay + dest.sweeping);
+  }
+  resBank.update(begin, end);
+
+  if (begin == 0) dest.written = resBank.getResonatorParam(0, param);
+  dest.cursor = end;
+  if (end == size) {
+    dest.applied = dest.sweeping;
+    dest.cursor = -1;
+  }
+  return end - begin;
+}
@@ -0,0 +1,129 @@
+/*
+ * Resonators
+ * ResonatorsModulation
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsModulation_H_
+#define ResonatorsModulation_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Resonators.h"
+
+// A modulation matrix over the banks' pitch, gain and decay, evaluated once
+// per call to process(), i.e. per block or sub-block. Sources are LFOs,
+// attack-release envelopes and values set from anywhere (sensors, GUI);
+// each route adds a source times an amount to a destination, a parameter
+// of a whole bank, which follows the sum through a one-pole smoother:
+//
+//   Resonator::kFreq   semitones, on the bank's model frequencies
+//   Resonator::kGain   dB, on the bank's output gain (Resonators::setGain())
+//   Resonator::kDecay  added to the model's decays (0-1)
+//
+// Gain costs a multiply per bank. Frequency and decay need the bank's
+// coefficients recomputed: when one has moved noticeably, the bank is swept
+// with it, `budget` resonators per block shared between all destinations,
+// so a block costs the same however many resonators the banks have; a bank
+// larger than the budget takes a few blocks to follow. As with
+// ResonatorsAutomation, the bank's model is left as it is, and a pitch or
+// model change is swept over again. Don't ramp a parameter of a bank with
+// ResonatorsAutomation while it is modulated here.
+//
+// Sources and routes are set up before audio starts or on the audio thread;
+// setValue(), gate() and trigger() are safe from any thread.
+//
+//   modulation.setup(res.getTotalBanks(), context->audioSampleRate);
+//   modulation.setLFO(0, ResonatorsModulation::kSine, 5.0f);
+//   modulation.route(0, 0, Resonator::kFreq, 0.3f); // vibrato, 0.3 semitones
+//   modulation.route(1, 0, Resonator::kDecay, 0.2f); // source 1 a sensor, setValue(1, x)
+//   modulation.process(res, context->audioFrames); // in render()
+
+typedef struct _ResonatorsModulationOptions {
+    int maxSources = 8;
+    int maxRoutes = 32;
+    int budget = 64; // resonators recomputed per block, over all destinations
+    float smoothing = 0.02f; // seconds, each destination's unless set otherwise
+} ResonatorsModulationOptions;
+
+class ResonatorsModulation {
+public:
+    enum Shape {
+        kValue,    // setValue(), the default
+        kSine,     // LFOs, -1 to 1
+        kTriangle,
+        kSaw,
+        kSquare,
+        kEnvelope  // 0 to 1, see setEnvelope()
+    };
+
+    ResonatorsModulation();
+    ~ResonatorsModulation(){}
+
+    void setup(int totalBanks, float sampleRate, ResonatorsModulationOptions options = ResonatorsModulationOptions());
+
+    // Sources
+    void setLFO(int source, int shape, float rate, float phase = 0.0f); // rate in Hz, phase 0-1
+    // Rises over `attack` seconds when triggered or gated on, holds while
+    // the gate stays on, and falls over `release` seconds
+    void setEnvelope(int source, float attack, float release);
+    void setValue(int source, float value);
+    void gate(int source, bool on);
+    void trigger(int source);
+    float getSource(int source) { return _values[source]; }
+
+    // Routes; route() returns the route's index, or -1 if there is no room
+    int route(int source, int bank, int param, float amount);
+    void setAmount(int route, float amount) { if (route >= 0 && route < _totalRoutes) _amounts[route] = amount; }
+    void clearRoutes() { _totalRoutes = 0; }
+    void setSmoothing(int bank, int param, float seconds);
+    // A destination's smoothed value, in its units
+    float getDestination(int bank, int param) { return _destinations[bank * 3 + param].smoothed; }
+
+    // Audio thread
+    void process(Resonators &res, int frames);
+
+private:
+    struct Destination {
+        bool used; // routed to at some point
+        float target;
+        float smoothed;
+        float smoothing; // seconds
+        float applied; // what the bank was last swept with
+        float sweeping; // what the bank is being swept with
+        int cursor; // next resonator to sweep, or -1
+        float written; // resonator 0's parameter after the last sweep, or the bank's gain
+        float base; // the bank's gain before modulation
+    };
+
+    ResonatorsModulationOptions _opt = {};
+    float _sampleRate = 44100.0f;
+    int _totalBanks = 0;
+
+    // Sources and routes, an array per field
+    std::vector<int> _shapes;
+    std::vector<float> _phases, _rates, _attacks, _releases, _levels, _values;
+    std::vector<bool> _rising;
+    std::unique_ptr<std::atomic<float>[]> _inputs;
+    std::unique_ptr<std::atomic<bool>[]> _gates;
+    std::unique_ptr<std::atomic<unsigned int>[]> _triggers;
+    std::vector<unsigned int> _triggered;
+    std::vector<int> _sources, _targets;
+    std::vector<float> _amounts;
+    int _totalRoutes = 0;
+
+    std::vector<Destination> _destinations; // bank * 3 + param
+    int _next = 0; // destination swept first, in turn
+
+    void updateSources(int frames);
+    void updateGain(Resonators &res, int bank, Destination &dest);
+    int sweep(Resonators &res, int bank, int param, Destination &dest, int budget);
+
+};
+
+#endif /* ResonatorsModulation_H_ */
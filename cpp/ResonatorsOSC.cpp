@@ -0,0 +1,348 @@
+/*
+ * Resonators
+ * ResonatorsOSC
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "ResonatorsOSC.h"
+
+// OSC data is big-endian and padded to 4 bytes
+static inline size_t oscPadded(size_t size) { return (size + 3) & ~(size_t) 3; }
+
+static inline uint32_t oscReadWord(const char* p) {
+  uint32_t word;
+  memcpy(&word, p, 4);
+  return ntohl(word);
+}
+
+static inline void oscWriteWord(char* p, uint32_t word) {
+  word = htonl(word);
+  memcpy(p, &word, 4);
+}
+
+// Length of the padded string at `p`, or 0 if it is not terminated within `size`
+static inline size_t oscStringSize(const char* p, size_t size) {
+  const char* end = (const char*) memchr(p, 0, size);
+  if (end == NULL) return 0;
+  size_t padded = oscPadded(end - p + 1);
+  return (padded <= size) ? padded : 0;
+}
+
+/**************************************************************************
+ * OSCMessage
+ *************************************************************************/
+
+OSCMessage::OSCMessage(const char* address) {
+  size_t length = strlen(address);
+  if (length >= sizeof(_address)) { _overflow = true; length = 0; }
+  memcpy(_address, address, length);
+  _address[length] = 0;
+  _types[_totalTypes++] = ',';
+}
+
+OSCMessage& OSCMessage::addInt(int32_t value) {
+  if (!reserve(4)) return *this;
+  _types[_totalTypes++] = 'i';
+  oscWriteWord(_args + _argsSize, (uint32_t) value);
+  _argsSize += 4;
+  return *this;
+}
+
+OSCMessage& OSCMessage::addFloat(float value) {
+  if (!reserve(4)) return *this;
+  uint32_t word;
+  memcpy(&word, &value, 4);
+  _types[_totalTypes++] = 'f';
+  oscWriteWord(_args + _argsSize, word);
+  _argsSize += 4;
+  return *this;
+}
+
+OSCMessage& OSCMessage::addString(const char* value) {
+  size_t length = strlen(value);
+  if (!reserve(oscPadded(length + 1))) return *this;
+  _types[_totalTypes++] = 's';
+  memset(_args + _argsSize, 0, oscPadded(length + 1));
+  memcpy(_args + _argsSize, value, length);
+  _argsSize += oscPadded(length + 1);
+  return *this;
+}
+
+const char* OSCMessage::data() {
+  if (_overflow) return NULL;
+  size_t addressSize = oscPadded(strlen(_address) + 1);
+  size_t typesSize = oscPadded(_totalTypes + 1);
+  if (addressSize + typesSize + _argsSize > sizeof(_packet)) return NULL;
+
+  memset(_packet, 0, addressSize + typesSize);
+  memcpy(_packet, _address, strlen(_address));
+  memcpy(_packet + addressSize, _types, _totalTypes);
+  memcpy(_packet + addressSize + typesSize, _args, _argsSize);
+  _packetSize = addressSize + typesSize + _argsSize;
+  return _packet;
+}
+
+size_t OSCMessage::size() {
+  return (data() != NULL) ? _packetSize : 0;
+}
+
+bool OSCMessage::reserve(size_t bytes) {
+  if (_overflow || _argsSize + bytes > sizeof(_args) || _totalTypes + 1 >= (int) sizeof(_types)) _overflow = true;
+  return !_overflow;
+}
+
+/**************************************************************************
+ * ResonatorsOSC
+ *************************************************************************/
+
+ResonatorsOSC::ResonatorsOSC() : _running(false), _received(0), _errors(0) {}
+ResonatorsOSC::~ResonatorsOSC(){ cleanup(); }
+
+bool ResonatorsOSC::setup(Resonators &res, ResonatorsCommandQueue &queue, ModelLoadService &loader, ResonatorsOSCOptions options){
+  cleanup();
+  _opt = options;
+  _queue = &queue;
+  _loader = &loader;
+  _totalBanks = res.getTotalBanks();
+  _pitches.clear();
+  for (int i = 0; i < _totalBanks; ++i) _pitches.push_back(res.getPitch(i));
+
+  _socket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (_socket < 0) {
+    printf("[ResonatorsOSC] setup() Error: could not create socket\n");
+    return false;
+  }
+
+  struct sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port        = htons(_opt.port);
+  socklen_t length = sizeof(address);
+  if (bind(_socket, (struct sockaddr*) &address, length) < 0 ||
+      getsockname(_socket, (struct sockaddr*) &address, &length) < 0) {
+    printf("[ResonatorsOSC] setup() Error: could not listen on port %d\n", _opt.port);
+    close(_socket);
+    _socket = -1;
+    return false;
+  }
+  _port = ntohs(address.sin_port);
+
+  // Wake up regularly to notice cleanup()
+  struct timeval timeout = {0, 100000};
+  setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  if (_opt.v) printf("[ResonatorsOSC] Listening on port %d\n", _port);
+  _running = true;
+  _thread = std::thread(&ResonatorsOSC::run, this);
+  return true;
+}
+
+void ResonatorsOSC::cleanup(){
+  _running = false;
+  if (_thread.joinable()) _thread.join();
+  if (_socket >= 0) close(_socket);
+  _socket = -1;
+}
+
+bool ResonatorsOSC::send(const char* host, int port, OSCMessage &message){
+  const char* data = message.data();
+  if (data == NULL) return false;
+  return send(host, port, data, message.size());
+}
+
+bool ResonatorsOSC::send(const char* host, int port, const char* data, size_t size){
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port   = htons(port);
+  if (inet_pton(AF_INET, host, &address.sin_addr) != 1) return false;
+
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  if (s < 0) return false;
+  bool sent = sendto(s, data, size, 0, (struct sockaddr*) &address, sizeof(address)) == (ssize_t) size;
+  close(s);
+  return sent;
+}
+
+bool ResonatorsOSC::handlePacket(const char* data, size_t size){
+  if (size >= 16 && memcmp(data, "#bundle", 8) == 0) {
+    // Skip the time tag, then each element is a size and a message or bundle
+    size_t pos = 16;
+    bool ok = true;
+    while (pos + 4 <= size) {
+      uint32_t elementSize = oscReadWord(data + pos);
+      pos += 4;
+      if (elementSize > size - pos || elementSize % 4 != 0) break;
+      ok = handlePacket(data + pos, elementSize) && ok;
+      pos += elementSize;
+    }
+    if (pos == size) return ok;
+    _errors.fetch_add(1, std::memory_order_relaxed); // the bundle itself is malformed
+    return false;
+  }
+  _received.fetch_add(1, std::memory_order_relaxed);
+  if (handleMessage(data, size)) return true;
+  _errors.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+// private methods
+void ResonatorsOSC::run(){
+  while (_running) {
+    ssize_t size = recv(_socket, _buffer, sizeof(_buffer), 0);
+    if (size > 0 && !handlePacket(_buffer, size) && _opt.v)
+      printf("[ResonatorsOSC] run() Error: could not handle message\n");
+  }
+}
+
+bool ResonatorsOSC::handleMessage(const char* data, size_t size){
+  if (size % 4 != 0) return false;
+  size_t addressSize = oscStringSize(data, size);
+  if (addressSize == 0 || data[0] != '/') return false;
+  const char* address = data;
+  size_t pos = addressSize;
+
+  // Messages without a type tag string have no arguments
+  if (pos == size) return dispatch(address, 0);
+  size_t typesSize = oscStringSize(data + pos, size - pos);
+  if (typesSize == 0 || data[pos] != ',') return false;
+  const char* types = data + pos + 1;
+  pos += typesSize;
+
+  int count = 0;
+  for (; *types != 0; ++types) {
+    if (count == kMaxArguments) return false;
+    OSCArgument &arg = _args[count];
+    arg.type = *types;
+    switch (*types) {
+      case 'i':
+        if (pos + 4 > size) return false;
+        arg.i = (int32_t) oscReadWord(data + pos);
+        arg.f = (float) arg.i;
+        arg.hasInt = true;
+        pos += 4;
+        break;
+      case 'f': {
+        if (pos + 4 > size) return false;
+        uint32_t word = oscReadWord(data + pos);
+        memcpy(&arg.f, &word, 4);
+        // Anything can arrive here; converting NaN, inf or out of range is undefined
+        arg.hasInt = isfinite(arg.f) && arg.f >= -2147483648.0f && arg.f < 2147483648.0f;
+        arg.i = arg.hasInt ? (int32_t) arg.f : 0;
+        pos += 4;
+        break;
+      }
+      case 's': {
+        size_t stringSize = oscStringSize(data + pos, size - pos);
+        if (stringSize == 0) return false;
+        arg.s = data + pos;
+        arg.hasInt = false;
+        pos += stringSize;
+        break;
+      }
+      default:
+        return false; // other types are not used by any command
+    }
+    ++count;
+  }
+  return dispatch(address, count);
+}
+
+bool ResonatorsOSC::dispatch(const char* address, int count){
+  if (strncmp(address, "/resonators/", 12) != 0) return false;
+  const char* command = address + 12;
+
+  int32_t bank;
+  if (!argInt(0, count, bank) || bank < 0 || bank >= _totalBanks) return false;
+
+  ResonatorsCommand cmd = {};
+  cmd.bank = bank;
+
+  const char* text;
+  if (strcmp(command, "model") == 0) {
+    if (!argString(1, count, text)) return false;
+    return _loader->loadAsync(text, bank, _pitches[bank]);
+  }
+  else if (strcmp(command, "pitch") == 0) {
+    if (!argString(1, count, text) || strlen(text) >= ResonatorsCommand::kMaxPitch) return false;
+    cmd.type = ResonatorsCommand::kPitch;
+    strcpy(cmd.pitch, text);
+    if (!_queue->push(cmd)) return false;
+    _pitches[bank] = text; // only once it is on its way to the bank
+    return true;
+  }
+  else if (strcmp(command, "gain") == 0) {
+    cmd.type = ResonatorsCommand::kGain;
+    return argFloat(1, count, cmd.value) && _queue->push(cmd);
+  }
+  else if (strcmp(command, "note") == 0) {
+    cmd.type = ResonatorsCommand::kNote;
+    if (!argFloat(1, count, cmd.value)) return false;
+    if (count > 2) {
+      if (!argString(2, count, text) || strlen(text) >= ResonatorsCommand::kMaxPitch) return false;
+      strcpy(cmd.pitch, text);
+    }
+    if (!_queue->push(cmd)) return false;
+    if (cmd.pitch[0] != 0) _pitches[bank] = cmd.pitch;
+    return true;
+  }
+  else if (strcmp(command, "resonators") == 0) {
+    if ((count - 1) % 3 != 0) return false;
+    cmd.type = ResonatorsCommand::kResonators;
+    bool ok = true;
+    for (int a = 1; a < count; a += 3) {
+      int32_t index, param;
+      float value;
+      if (!argInt(a, count, index) || !argInt(a + 1, count, param) || !argFloat(a + 2, count, value) ||
+          param < Resonator::kFreq || param > Resonator::kDecay) return false;
+
+      // Consecutive changes to the same resonator share one delta
+      ResonatorParamDelta *delta = (cmd.length > 0) ? &cmd.deltas[cmd.length - 1] : NULL;
+      if (delta == NULL || delta->index != index) {
+        if (cmd.length == ResonatorsCommand::kMaxDeltas) {
+          ok = _queue->push(cmd) && ok;
+          cmd.length = 0;
+        }
+        delta = &cmd.deltas[cmd.length++];
+        delta->index = index;
+        delta->mask = 0;
+      }
+      delta->mask |= 1 << param;
+      if      (param == Resonator::kFreq) delta->params.freq  = value;
+      else if (param == Resonator::kGain) delta->params.gain  = value;
+      else                                delta->params.decay = value;
+    }
+    if (cmd.length > 0) ok = _queue->push(cmd) && ok;
+    return ok;
+  }
+  return false;
+}
+
+bool ResonatorsOSC::argInt(int index, int count, int32_t &value){
+  if (index >= count || !_args[index].hasInt) return false;
+  value = _args[index].i;
+  return true;
+}
+
+bool ResonatorsOSC::argFloat(int index, int count, float &value){
+  if (index >= count || _args[index].type == 's') return false;
+  value = _args[index].f;
+  return true;
+}
+
+bool ResonatorsOSC::argString(int index, int count, const char* &value){
+  if (index >= count || _args[index].type != 's') return false;
+  value = _args[index].s;
+  return true;
+}
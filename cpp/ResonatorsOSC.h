@@ -0,0 +1,137 @@
+/*
+ * Resonators
+ * ResonatorsOSC
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsOSC_H_
+#define ResonatorsOSC_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Resonators.h"
+#include "ResonatorsCommandQueue.h"
+#include "ModelLoadService.h"
+
+// OSC over UDP control endpoint. A receive thread parses each packet in place
+// (no copies, no allocation) and turns it into commands for the audio
+// thread's ResonatorsCommandQueue; model loads go to the ModelLoadService.
+//
+//   /resonators/model      i s          bank, model path
+//   /resonators/pitch      i s          bank, note name, e.g. "c4"
+//   /resonators/resonators i (i i f)...  bank, then (resonator, param, value) with
+//                                        param 0: freq, 1: gain, 2: decay
+//   /resonators/gain       i f          bank, output gain
+//   /resonators/note       i f [s]      bank, impulse amplitude, optional note name
+//
+// Integer and float arguments are interchangeable, as many OSC senders only
+// send floats; a float given for an integer must be finite and fit in 32 bits.
+// Bundles are unpacked and applied at once (time tags are ignored).
+// Frequencies are as in the model file, as for updateResonators. A pitch is
+// kept for later model loads only once it has been queued.
+//
+//   commands.setup(256);
+//   osc.setup(res, commands, loader);   // listens on port 7562
+//   res.applyCommands(commands);        // at the top of render()
+
+typedef struct _ResonatorsOSCOptions {
+    int  port = 7562; // 0 picks a free port, see getPort()
+    bool v = true; // verbose printing
+} ResonatorsOSCOptions;
+
+// One argument of a received message; strings point into the packet
+typedef struct _OSCArgument {
+    char type; // 'i', 'f' or 's'
+    int32_t i; // only if hasInt
+    float f;
+    bool hasInt; // an int, or a float that fits in one
+    const char* s;
+} OSCArgument;
+
+// Builds an OSC message in a fixed buffer, e.g. to send to ResonatorsOSC
+//
+//   OSCMessage msg("/resonators/gain");
+//   msg.addInt(0).addFloat(0.5f);
+//   ResonatorsOSC::send("127.0.0.1", 7562, msg);
+class OSCMessage {
+public:
+    static const int kMaxSize = 1024;
+
+    OSCMessage(const char* address);
+
+    OSCMessage& addInt(int32_t value);
+    OSCMessage& addFloat(float value);
+    OSCMessage& addString(const char* value);
+
+    // The encoded message; NULL if it did not fit
+    const char* data();
+    size_t size();
+
+private:
+    char _address[128];
+    char _types[kMaxSize / 4];
+    char _args[kMaxSize];
+    char _packet[kMaxSize];
+    int _totalTypes = 0;
+    size_t _argsSize = 0;
+    size_t _packetSize = 0;
+    bool _overflow = false;
+
+    bool reserve(size_t bytes);
+};
+
+class ResonatorsOSC {
+public:
+    static const int kMaxPacket = 1536;
+    static const int kMaxArguments = 128;
+
+    ResonatorsOSC();
+    ~ResonatorsOSC();
+
+    bool setup(Resonators &res, ResonatorsCommandQueue &queue, ModelLoadService &loader, ResonatorsOSCOptions options = ResonatorsOSCOptions());
+    void cleanup();
+    int getPort() { return _port; }
+
+    // Parse a packet (message or bundle) and act on it, as the receive thread does
+    bool handlePacket(const char* data, size_t size);
+
+    static bool send(const char* host, int port, OSCMessage &message);
+    static bool send(const char* host, int port, const char* data, size_t size); // e.g. a bundle
+
+    unsigned int getReceived() { return _received.load(std::memory_order_relaxed); }
+    unsigned int getErrors() { return _errors.load(std::memory_order_relaxed); }
+
+private:
+    ResonatorsOSCOptions _opt = {};
+    ResonatorsCommandQueue *_queue = NULL;
+    ModelLoadService *_loader = NULL;
+    int _totalBanks = 0;
+    std::vector<std::string> _pitches; // last pitch per bank, for model loads
+
+    int _socket = -1;
+    int _port = 0;
+    std::atomic<bool> _running;
+    std::thread _thread;
+    std::atomic<unsigned int> _received;
+    std::atomic<unsigned int> _errors;
+
+    char _buffer[kMaxPacket];
+    OSCArgument _args[kMaxArguments];
+
+    void run();
+    bool handleMessage(const char* data, size_t size);
+    bool dispatch(const char* address, int count);
+    bool argInt(int index, int count, int32_t &value);
+    bool argFloat(int index, int count, float &value);
+    bool argString(int index, int count, const char* &value);
+
+};
+
+#endif /* ResonatorsOSC_H_ */
@@ -0,0 +1,101 @@
+/*
+ * Resonators
+ * ResonatorsScheduler
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include "ResonatorsScheduler.h"
+
+ResonatorsScheduler::ResonatorsScheduler() : _time(0), _applied(0), _late(0), _dropped(0) {}
+ResonatorsScheduler::~ResonatorsScheduler(){}
+
+void ResonatorsScheduler::setup(Resonators &res, ModelLoadService *loader, ResonatorsSchedulerOptions options){
+  _opt = options;
+  _res = &res;
+  _loader = loader;
+  _queue.setup(_opt.capacity);
+  _pending.assign(_opt.capacity, ResonatorsCommand());
+  _totalPending = 0;
+  _waiting.assign(res.getTotalBanks(), 0);
+  _time.store(0, std::memory_order_release);
+  _applied.store(0, std::memory_order_relaxed);
+  _late.store(0, std::memory_order_relaxed);
+  _dropped.store(0, std::memory_order_relaxed);
+  if (_opt.v) printf("[ResonatorsScheduler] Room for %d commands\n", _opt.capacity);
+}
+
+void ResonatorsScheduler::render(const float* inputs, float* outputs, int frames){
+  if (_res == NULL) return;
+  uint64_t start = _time.load(std::memory_order_relaxed);
+  int banks = _res->getTotalBanks();
+
+  // Models that were still loading when they were due
+  for (int b = 0; b < banks; ++b) {
+    if (!_waiting[b] || !_loader->apply(b, *_res)) continue;
+    _waiting[b] = 0;
+    _applied.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  ResonatorsCommand command;
+  while (_queue.pop(command)) take(command);
+
+  // The block in pieces, each starting with the commands due at its first sample
+  int next = 0;
+  for (int n = 0; n < frames; ) {
+    while (next < _totalPending && _pending[next].time <= start + n) apply(_pending[next++], start + n);
+    int end = frames;
+    if (next < _totalPending && _pending[next].time < start + frames) end = _pending[next].time - start;
+    for (; n < end; ++n) _res->render(inputs + n * banks, outputs + n * banks);
+  }
+
+  for (int i = next; i < _totalPending; ++i) _pending[i - next] = _pending[i];
+  _totalPending -= next;
+  _time.store(start + frames, std::memory_order_release);
+}
+
+ResonatorsSchedulerStats ResonatorsScheduler::getStats(){
+  ResonatorsSchedulerStats stats;
+  stats.applied = _applied.load(std::memory_order_relaxed);
+  stats.late    = _late.load(std::memory_order_relaxed);
+  stats.dropped = _dropped.load(std::memory_order_relaxed) + _queue.getDropped();
+  return stats;
+}
+
+// private methods
+
+// Into the pending commands, after any stamped earlier or alike
+void ResonatorsScheduler::take(ResonatorsCommand const &command){
+  if (_totalPending == (int) _pending.size()) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  int i = _totalPending++;
+  while (i > 0 && _pending[i - 1].time > command.time) {
+    _pending[i] = _pending[i - 1];
+    --i;
+  }
+  _pending[i] = command;
+}
+
+void ResonatorsScheduler::apply(ResonatorsCommand const &command, uint64_t now){
+  if (command.type == ResonatorsCommand::kRamp) { // ResonatorsAutomation's to step, not ours
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (command.time < now) _late.fetch_add(1, std::memory_order_relaxed);
+  if (command.type != ResonatorsCommand::kModel) {
+    _res->apply(command);
+    _applied.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (_loader == NULL || command.bank < 0 || command.bank >= _res->getTotalBanks()) return;
+  if (_loader->apply(command.bank, *_res)) {
+    _applied.fetch_add(1, std::memory_order_relaxed);
+  } else if (!_waiting[command.bank]) {
+    _waiting[command.bank] = 1;
+    if (command.time >= now) _late.fetch_add(1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,85 @@
+/*
+ * Resonators
+ * ResonatorsScheduler
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsScheduler_H_
+#define ResonatorsScheduler_H_
+
+#include <atomic>
+#include <vector>
+
+#include "Resonators.h"
+#include "ResonatorsCommandQueue.h"
+#include "ModelLoadService.h"
+
+// Applies commands at the sample they are stamped with rather than at the
+// top of whichever block follows them. Control threads stamp each command's
+// `time` in samples of the audio stream, counted by render() from 0 (see
+// getTime()), and schedule() it; render() renders a block a sample at a
+// time, as Resonators::render(inputs, outputs), and applies each command
+// due just before the sample it is stamped with (new coefficients take
+// effect a sample later, as they always do). Commands stamped in the
+// past apply before the first sample of the next block; commands stamped
+// alike apply in the order scheduled.
+//
+// kModel swaps in the model a ModelLoadService has loaded for the bank
+// (loadAsync() first, then schedule the swap for when it should sound); a
+// load not finished by then is swapped in as soon as it is, counted late.
+// kRamp commands are for ResonatorsAutomation and are counted dropped.
+//
+//   scheduler.setup(res, &loader);
+//   cmd.time = scheduler.getTime() + 4410; // control threads: 100 ms from now
+//   scheduler.schedule(cmd);
+//   scheduler.render(inputs, outputs, context->audioFrames); // in render()
+
+typedef struct _ResonatorsSchedulerOptions {
+    int capacity = 256; // commands scheduled and not yet due
+    bool v = true; // verbose printing
+} ResonatorsSchedulerOptions;
+
+typedef struct _ResonatorsSchedulerStats {
+    unsigned int applied; // commands applied
+    unsigned int late; // applied after their time: stamped in the past, or a model still loading
+    unsigned int dropped; // refused for want of room, or a kRamp
+} ResonatorsSchedulerStats;
+
+class ResonatorsScheduler {
+public:
+    ResonatorsScheduler();
+    ~ResonatorsScheduler();
+
+    void setup(Resonators &res, ModelLoadService *loader = NULL, ResonatorsSchedulerOptions options = ResonatorsSchedulerOptions());
+
+    // Control threads; false if the queue is full
+    bool schedule(ResonatorsCommand const &command) { return _queue.push(command); }
+    // Samples rendered so far, i.e. the time of the next block's first sample
+    uint64_t getTime() { return _time.load(std::memory_order_acquire); }
+
+    // Audio thread: `frames` frames of one input and one output per bank,
+    // interleaved as for Resonators::render(inputs, outputs)
+    void render(const float* inputs, float* outputs, int frames);
+
+    ResonatorsSchedulerStats getStats();
+
+private:
+    ResonatorsSchedulerOptions _opt = {};
+    Resonators *_res = NULL;
+    ModelLoadService *_loader = NULL;
+    ResonatorsCommandQueue _queue;
+    std::vector<ResonatorsCommand> _pending; // in order of time, then of arrival
+    int _totalPending = 0;
+    std::vector<char> _waiting; // per bank, a kModel due while its load was unfinished
+    std::atomic<uint64_t> _time;
+    std::atomic<unsigned int> _applied, _late, _dropped;
+
+    void take(ResonatorsCommand const &command);
+    void apply(ResonatorsCommand const &command, uint64_t now);
+
+};
+
+#endif /* ResonatorsScheduler_H_ */
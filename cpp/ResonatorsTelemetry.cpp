@@ -0,0 +1,101 @@
+/*
+ * Resonators
+ * ResonatorsTelemetry
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+#include <chrono>
+
+#include "ResonatorsTelemetry.h"
+
+ResonatorsTelemetry::ResonatorsTelemetry() : _write(0), _read(0), _interval(0), _running(false), _published(0), _dropped(0) {}
+ResonatorsTelemetry::~ResonatorsTelemetry(){ stop(); }
+
+void ResonatorsTelemetry::setup(int totalBanks, float sampleRate, ResonatorsTelemetryOptions options){
+  stop();
+  _opt = options;
+  _totalBanks = totalBanks;
+  _sampleRate = sampleRate;
+  _frameSize = totalBanks + totalBanks * _opt.maxSize;
+  _ring.assign(_opt.ringSize * _frameSize, 0.0f);
+  _write.store(0);
+  _read.store(0);
+  _elapsed = 0;
+  setRate(_opt.rate);
+}
+
+bool ResonatorsTelemetry::start(ResonatorsTelemetrySink sink){
+  stop();
+  if (!sink || _frameSize == 0) return false;
+  _sink = sink;
+  _running = true;
+  _thread = std::thread(&ResonatorsTelemetry::run, this);
+  return true;
+}
+
+void ResonatorsTelemetry::stop(){
+  _running = false;
+  if (_thread.joinable()) _thread.join();
+}
+
+void ResonatorsTelemetry::setRate(float rate){
+  if (rate <= 0.0f) return;
+  int interval = (int) (_sampleRate / rate);
+  _interval.store(interval > 1 ? interval : 1, std::memory_order_relaxed);
+}
+
+void ResonatorsTelemetry::process(Resonators &res, int frames){
+  _elapsed += frames;
+  if (_elapsed < _interval.load(std::memory_order_relaxed)) return;
+  _elapsed = 0;
+
+  unsigned int write = _write.load(std::memory_order_relaxed);
+  if (write - _read.load(std::memory_order_acquire) >= (unsigned int) _opt.ringSize) {
+    _dropped.fetch_add(1, std::memory_order_relaxed); // the publisher has fallen behind
+    return;
+  }
+
+  float *frame = &_ring[(write % _opt.ringSize) * _frameSize];
+  int banks = (_totalBanks < res.getTotalBanks()) ? _totalBanks : res.getTotalBanks();
+  for (int b = 0; b < banks; ++b) {
+    frame[b] = res.getPeak(b);
+    res.resetPeak(b);
+
+    float *amplitudes = frame + _totalBanks + b * _opt.maxSize;
+    ResonatorBank &bank = res.getBank(b);
+    int size = (bank.getSize() < _opt.maxSize) ? bank.getSize() : _opt.maxSize;
+    res.getAmplitudes(b, amplitudes, size);
+    for (int i = size; i < _opt.maxSize; ++i) amplitudes[i] = 0.0f;
+  }
+  _write.store(write + 1, std::memory_order_release);
+}
+
+size_t ResonatorsTelemetry::encode(int bufferId, const float* data, int length, char* out, size_t capacity){
+  size_t size = kHeaderSize + length * sizeof(float);
+  if (length < 0 || size > capacity) return 0;
+  uint32_t header[4] = {(uint32_t) bufferId, (uint32_t) 'f', (uint32_t) length, 0};
+  memcpy(out, header, kHeaderSize);
+  memcpy(out + kHeaderSize, data, length * sizeof(float));
+  return size;
+}
+
+// private methods
+void ResonatorsTelemetry::run(){
+  while (_running) {
+    unsigned int read = _read.load(std::memory_order_relaxed);
+    if (read == _write.load(std::memory_order_acquire)) {
+      // Nothing new yet; check again well within one snapshot interval
+      std::this_thread::sleep_for(std::chrono::microseconds((long long) (_interval.load(std::memory_order_relaxed) * 250000.0f / _sampleRate)));
+      continue;
+    }
+    const float *frame = &_ring[(read % _opt.ringSize) * _frameSize];
+    _sink(kLevels, frame, _totalBanks);
+    _sink(kAmplitudes, frame + _totalBanks, _totalBanks * _opt.maxSize);
+    _read.store(read + 1, std::memory_order_release);
+    _published.fetch_add(1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,96 @@
+/*
+ * Resonators
+ * ResonatorsTelemetry
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef ResonatorsTelemetry_H_
+#define ResonatorsTelemetry_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "Resonators.h"
+
+// Publishes level meters for every bank and amplitude meters for every
+// resonator, a few dozen times a second. The audio thread takes a snapshot
+// every 1/rate seconds into a preallocated lock-free ring (dropping it if the
+// ring is full); a separate, non-realtime thread hands each snapshot to a
+// sink as two float buffers:
+//
+//   buffer 0: peak output level per bank                     [banks]
+//   buffer 1: current amplitude per resonator, bank by bank  [banks * maxSize]
+//
+// which matches Gui::sendBuffer() and BelaData.js on the browser side
+// (see BelaResonators.onTelemetry()). encode() frames a buffer the same way
+// for other transports.
+//
+//   telemetry.setup(res.getTotalBanks(), context->audioSampleRate);
+//   telemetry.start([](int id, const float* data, int length) { gui.sendBuffer(id, data, length); });
+//   telemetry.process(res, context->audioFrames); // at the end of render()
+
+typedef struct _ResonatorsTelemetryOptions {
+    float rate = 30.0f; // snapshots per second
+    int maxSize = 40; // resonators per bank, as ResonatorBankOptions::maxSize
+    int ringSize = 8; // snapshots the ring can hold
+} ResonatorsTelemetryOptions;
+
+typedef std::function<void(int bufferId, const float* data, int length)> ResonatorsTelemetrySink;
+
+class ResonatorsTelemetry {
+public:
+    enum BufferIds {
+        kLevels = 0,
+        kAmplitudes = 1
+    };
+    static const int kHeaderSize = 16;
+
+    ResonatorsTelemetry();
+    ~ResonatorsTelemetry();
+
+    void setup(int totalBanks, float sampleRate, ResonatorsTelemetryOptions options = ResonatorsTelemetryOptions());
+    bool start(ResonatorsTelemetrySink sink);
+    void stop();
+
+    void setRate(float rate); // any thread
+
+    // Audio thread: count off `frames` and take a snapshot when one is due
+    void process(Resonators &res, int frames);
+
+    // Frame a buffer as BelaData.js does: uint32 id, type 'f', length and a
+    // reserved word, then the floats. Returns the size, or 0 if it won't fit.
+    static size_t encode(int bufferId, const float* data, int length, char* out, size_t capacity);
+
+    unsigned int getPublished() { return _published.load(std::memory_order_relaxed); }
+    unsigned int getDropped() { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    ResonatorsTelemetryOptions _opt = {};
+    int _totalBanks = 0;
+    float _sampleRate = 44100.0f;
+    int _frameSize = 0; // floats per snapshot
+
+    std::vector<float> _ring; // _opt.ringSize snapshots of _frameSize
+    std::atomic<unsigned int> _write; // audio thread
+    std::atomic<unsigned int> _read; // publishing thread
+
+    std::atomic<int> _interval; // samples between snapshots
+    int _elapsed = 0;
+
+    ResonatorsTelemetrySink _sink;
+    std::atomic<bool> _running;
+    std::thread _thread;
+    std::atomic<unsigned int> _published;
+    std::atomic<unsigned int> _dropped;
+
+    void run();
+
+};
+
+#endif /* ResonatorsTelemetry_H_ */
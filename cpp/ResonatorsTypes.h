@@ -29,6 +29,38 @@ typedef struct _ResonatorParams {
     
 } ResonatorParams;
 
+// A change to one resonator of a bank: only the fields whose bit is set in
+// `mask` (1 << Resonator::kFreq, kGain, kDecay) are applied
+typedef struct _ResonatorParamDelta {
+    
+    int index;
+    int mask;
+    ResonatorParams params;
+    
+} ResonatorParamDelta;
+
+typedef struct _ResonatorCoefficients {
+    
+    float a1;
+    float b1;
+    float b2;
+    float a1Prime;
+    
+} ResonatorCoefficients;
+
+// What a resonator renders its next sample from besides its coefficients:
+// its last two outputs and the coefficients that sample is rendered with
+// (they take effect a sample late). See ResonatorBank::getRenderState().
+typedef struct _ResonatorRenderState {
+    
+    float out1;
+    float out2;
+    float a1Prev;
+    float b1Prev;
+    float b2Prev;
+    
+} ResonatorRenderState;
+
 typedef struct _ResonatorParamVects {
     
     std::vector<float> freqs;
@@ -37,6 +69,18 @@ typedef struct _ResonatorParamVects {
     
 } ResonatorParamVects;
 
+// A consistent copy of a bank's parameters and coefficients (see
+// ResonatorBank::getSnapshot()). Reserve the vectors once, to the bank's
+// maxSize, and reuse the snapshot so that reading it never allocates.
+typedef struct _ResonatorBankSnapshot {
+    
+    unsigned int version; // changes whenever the bank does
+    int size;
+    std::vector<ResonatorParams> params;
+    std::vector<ResonatorCoefficients> coefficients;
+    
+} ResonatorBankSnapshot;
+
 typedef struct _ResonatorUtils {
     
     float sampleRate;
@@ -83,3 +127,21 @@ typedef struct _ResonatorBankOptions {
     ResonatorOptions resOpt = {};
     
 } ResonatorBankOptions;
+
+/**************************************************************************
+ * Resonators
+ *************************************************************************/
+
+// What a Resonators object runs with (see Resonators::getInfo())
+typedef struct _ResonatorsInfo {
+    
+    const char* isa; // instruction set of the render and update kernels (see ResonatorKernels.h)
+    int vectorWidth; // resonators per instruction
+    int banks;
+    int resonators; // across all banks
+    size_t arenaSize; // bytes (see ResonatorsArena.h)
+    bool hugePages;
+    bool locked;
+    int laneGroups; // groups of banks rendered side by side (see ResonatorLanes.h)
+    
+} ResonatorsInfo;
@@ -0,0 +1,87 @@
+/*
+ * Resonators
+ * Bela (host)
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef Bela_H_
+#define Bela_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The part of Bela's API that the library and the examples use, for running
+// them on an ordinary Linux machine: BelaHost.cpp calls setup(), render()
+// from a real-time audio thread, and cleanup(), as Bela does, with audio
+// from a file, a null device or ALSA, and analog inputs from a file or a
+// constant (see BelaHost.h). Put this directory on the include path in place
+// of Bela's own; on a Bela the real one is used and this one is never seen.
+
+#define BELA_AUDIO_PRIORITY 95
+#define MAX_PROJECTNAME_LENGTH 256
+
+// Frames are interleaved, as with BELA_FLAG_INTERLEAVED, which is the default
+typedef struct {
+    const float* audioIn;
+    float* audioOut;
+    const float* analogIn;
+    float* analogOut;
+    uint32_t audioFrames;
+    uint32_t audioInChannels;
+    uint32_t audioOutChannels;
+    float audioSampleRate;
+    uint32_t analogFrames; // half of audioFrames, as with 8 analog channels on a Bela
+    uint32_t analogInChannels;
+    uint32_t analogOutChannels;
+    float analogSampleRate;
+    uint64_t audioFramesElapsed;
+    uint32_t flags;
+    char projectName[MAX_PROJECTNAME_LENGTH];
+} BelaContext;
+
+typedef void* AuxiliaryTask;
+
+// Defined by the program, as on a Bela
+bool setup(BelaContext *context, void *userData);
+void render(BelaContext *context, void *userData);
+void cleanup(BelaContext *context, void *userData);
+
+// Prints straight to stdout: there is no Xenomai here to defer it for
+static inline int rt_printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int printed = vprintf(format, args);
+  va_end(args);
+  return printed;
+}
+
+// A thread of its own per task, at `priority` (SCHED_FIFO) if allowed;
+// scheduling it from the audio thread only posts a semaphore
+AuxiliaryTask Bela_createAuxiliaryTask(void (*callback)(void*), int priority, const char *name, void *arg = NULL);
+int Bela_scheduleAuxiliaryTask(AuxiliaryTask task);
+
+void Bela_requestStop();
+int Bela_stopRequested();
+extern int gShouldStop; // as Bela_stopRequested(), for older programs
+
+static inline float audioRead(BelaContext *context, int frame, int channel) {
+  return context->audioIn[frame * context->audioInChannels + channel];
+}
+static inline void audioWrite(BelaContext *context, int frame, int channel, float value) {
+  context->audioOut[frame * context->audioOutChannels + channel] = value;
+}
+static inline float analogRead(BelaContext *context, int frame, int channel) {
+  return context->analogIn[frame * context->analogInChannels + channel];
+}
+static inline void analogWrite(BelaContext *context, int frame, int channel, float value) {
+  for (unsigned int f = frame; f < context->analogFrames; ++f) context->analogOut[f * context->analogOutChannels + channel] = value;
+}
+static inline void analogWriteOnce(BelaContext *context, int frame, int channel, float value) {
+  context->analogOut[frame * context->analogOutChannels + channel] = value;
+}
+
+#endif /* Bela_H_ */
@@ -0,0 +1,355 @@
+/*
+ * Resonators
+ * BelaHost
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+
+#include "BelaHost.h"
+
+// Bela's API
+
+int gShouldStop = 0;
+static std::atomic<bool> gStop(false);
+
+void Bela_requestStop() {
+  gStop.store(true);
+  gShouldStop = 1;
+}
+
+int Bela_stopRequested() { return gStop.load() ? 1 : 0; }
+
+// A thread at `priority` if the system allows it, at the default otherwise
+static bool startThread(pthread_t &thread, void* (*function)(void*), void* arg, int priority, const char* name, bool v) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  sched_param param = {};
+  param.sched_priority = priority;
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  pthread_attr_setschedparam(&attr, &param);
+  int error = (priority > 0) ? pthread_create(&thread, &attr, function, arg) : EPERM;
+  pthread_attr_destroy(&attr);
+  if (error == EPERM) {
+    if (v && priority > 0) printf("[BelaHost] Running '%s' at normal priority: not allowed SCHED_FIFO %d (see ulimit -r)\n", name, priority);
+    error = pthread_create(&thread, NULL, function, arg);
+  }
+  if (error != 0) {
+    printf("[BelaHost] startThread() Error: could not start '%s': %s\n", name, strerror(error));
+    return false;
+  }
+  pthread_setname_np(thread, std::string(name).substr(0, 15).c_str());
+  return true;
+}
+
+struct BelaHostTask {
+  void (*callback)(void*);
+  void* arg;
+  std::string name;
+  int priority;
+  sem_t scheduled;
+  std::atomic<bool> pending;
+  std::atomic<bool> running;
+  pthread_t thread;
+};
+
+static std::vector<BelaHostTask*> gTasks;
+
+static void* runTask(void* arg) {
+  BelaHostTask* task = (BelaHostTask*) arg;
+  while (true) {
+    while (sem_wait(&task->scheduled) != 0 && errno == EINTR) {}
+    if (!task->running.load()) break;
+    task->pending.store(false);
+    task->callback(task->arg);
+  }
+  return NULL;
+}
+
+AuxiliaryTask Bela_createAuxiliaryTask(void (*callback)(void*), int priority, const char *name, void *arg) {
+  BelaHostTask* task = new BelaHostTask();
+  task->callback = callback;
+  task->arg = arg;
+  task->name = name;
+  task->priority = priority;
+  task->pending.store(false);
+  task->running.store(true);
+  sem_init(&task->scheduled, 0, 0);
+  if (!startThread(task->thread, runTask, task, priority, name, false)) {
+    sem_destroy(&task->scheduled);
+    delete task;
+    return 0;
+  }
+  gTasks.push_back(task);
+  return task;
+}
+
+// Schedules made while the task is still waiting to run are merged into one
+int Bela_scheduleAuxiliaryTask(AuxiliaryTask auxTask) {
+  BelaHostTask* task = (BelaHostTask*) auxTask;
+  if (task == NULL) return -1;
+  if (!task->pending.exchange(true)) sem_post(&task->scheduled);
+  return 0;
+}
+
+static void stopTasks() {
+  for (unsigned int i = 0; i < gTasks.size(); ++i) {
+    gTasks[i]->running.store(false);
+    sem_post(&gTasks[i]->scheduled);
+    pthread_join(gTasks[i]->thread, NULL);
+    sem_destroy(&gTasks[i]->scheduled);
+    delete gTasks[i];
+  }
+  gTasks.clear();
+}
+
+static double now() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// BelaHost
+
+BelaHost::BelaHost(){
+  memset(&_context, 0, sizeof(_context));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+BelaHost::~BelaHost(){
+  if (_backend != NULL) {
+    _backend->close();
+    delete _backend;
+  }
+}
+
+static void usage(const char* program) {
+  printf("Usage: %s [options]\n"
+         "  --backend NAME      file, null or alsa (default null)\n"
+         "  --input FILE        audio inputs, a WAV file (file)\n"
+         "  --output FILE       audio outputs, a WAV file (file)\n"
+         "  --device NAME       PCM device (alsa, default 'default')\n"
+         "  --analog FILE       analog inputs, a WAV file at the analog rate, looped\n"
+         "  --analog-value V    every analog input, without a file (default 0)\n"
+         "  --rate HZ           sample rate (default 44100)\n"
+         "  --frames N          frames per block (default 16)\n"
+         "  --channels IN OUT   audio channels (default 2 2)\n"
+         "  --seconds S         time to run (default: the input's length, or until ^C)\n"
+         "  --realtime          pace file and null back ends to the sample rate\n"
+         "  --clicks HZ         impulses per second into every input\n"
+         "  --priority N        audio thread priority, 0 for normal (default %d)\n"
+         "  --quiet             less printing\n", program, BELA_AUDIO_PRIORITY);
+}
+
+bool BelaHost::parse(int argc, char** argv, BelaHostOptions &options){
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool more = i + 1 < argc;
+    if      (arg == "--backend" && more)      options.backend = argv[++i];
+    else if (arg == "--input" && more)        options.input = argv[++i];
+    else if (arg == "--output" && more)       options.output = argv[++i];
+    else if (arg == "--device" && more)       options.device = argv[++i];
+    else if (arg == "--analog" && more)       options.analogInput = argv[++i];
+    else if (arg == "--analog-value" && more) options.analogValue = atof(argv[++i]);
+    else if (arg == "--rate" && more)         options.sampleRate = atof(argv[++i]);
+    else if (arg == "--frames" && more)       options.frames = atoi(argv[++i]);
+    else if (arg == "--channels" && i + 2 < argc) {
+      options.audioInChannels = atoi(argv[++i]);
+      options.audioOutChannels = atoi(argv[++i]);
+    }
+    else if (arg == "--seconds" && more)      options.seconds = atof(argv[++i]);
+    else if (arg == "--realtime")             options.realtime = true;
+    else if (arg == "--clicks" && more)       options.clicks = atof(argv[++i]);
+    else if (arg == "--priority" && more)     options.priority = atoi(argv[++i]);
+    else if (arg == "--quiet")                options.v = false;
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  if (options.frames < 2 || options.sampleRate <= 0.0f || options.audioInChannels < 0 || options.audioOutChannels < 1) {
+    printf("[BelaHost] parse() Error: need at least 2 frames, a sample rate and an output channel\n");
+    return false;
+  }
+  return true;
+}
+
+bool BelaHost::setup(BelaHostOptions options, const char* projectName, void* userData){
+  _opt = options;
+  _userData = userData;
+
+  _backend = BelaHostBackend::create(_opt.backend);
+  if (_backend == NULL) {
+    printf("[BelaHost] setup() Error: no back end '%s' in this build\n", _opt.backend.c_str());
+    return false;
+  }
+  if (!_backend->open(_opt)) return false;
+
+  if (!_opt.analogInput.empty()) {
+    if (!readWav(_opt.analogInput, _analog)) return false;
+    if (_analog.samples.empty()) _opt.analogInput.clear();
+  }
+
+  _length = (uint64_t) (_opt.seconds * _opt.sampleRate);
+  if (_length == 0 && _opt.backend == "file") _length = _backend->getLength() ? _backend->getLength() : (uint64_t) (10.0f * _opt.sampleRate);
+  _clickInterval = (_opt.clicks > 0.0f) ? (int) (_opt.sampleRate / _opt.clicks) : 0;
+  if (_opt.clicks > 0.0f && _clickInterval < 1) _clickInterval = 1;
+
+  int analogFrames = _opt.frames / 2;
+  _audioIn.assign(_opt.frames * _opt.audioInChannels, 0.0f);
+  _audioOut.assign(_opt.frames * _opt.audioOutChannels, 0.0f);
+  _analogIn.assign(analogFrames * _opt.analogChannels, _opt.analogValue);
+  _analogOut.assign(analogFrames * _opt.analogChannels, 0.0f);
+
+  _context.audioIn = _audioIn.data();
+  _context.audioOut = _audioOut.data();
+  _context.analogIn = _analogIn.data();
+  _context.analogOut = _analogOut.data();
+  _context.audioFrames = _opt.frames;
+  _context.audioInChannels = _opt.audioInChannels;
+  _context.audioOutChannels = _opt.audioOutChannels;
+  _context.audioSampleRate = _opt.sampleRate;
+  _context.analogFrames = analogFrames;
+  _context.analogInChannels = _opt.analogChannels;
+  _context.analogOutChannels = _opt.analogChannels;
+  _context.analogSampleRate = _opt.sampleRate / 2;
+  _context.audioFramesElapsed = 0;
+  strncpy(_context.projectName, projectName, MAX_PROJECTNAME_LENGTH - 1);
+
+  if (_opt.v) printf("[BelaHost] '%s' on '%s': %.0f Hz, %d frames, %d in, %d out, %d analog\n", _context.projectName, _opt.backend.c_str(), _opt.sampleRate, _opt.frames, _opt.audioInChannels, _opt.audioOutChannels, _opt.analogChannels);
+  if (!::setup(&_context, _userData)) {
+    printf("[BelaHost] setup() Error: the program's setup() failed\n");
+    return false;
+  }
+  _setup = true;
+  return true;
+}
+
+bool BelaHost::run(){
+  if (!_setup) return false;
+  pthread_t thread;
+  if (!startThread(thread, audioThread, this, _opt.priority, "bela-audio", _opt.v)) return false;
+  pthread_join(thread, NULL);
+  return true;
+}
+
+void BelaHost::cleanup(){
+  if (_setup) ::cleanup(&_context, _userData);
+  _setup = false;
+  stopTasks();
+  if (_backend != NULL) _backend->close();
+}
+
+BelaHostStats BelaHost::getStats(){
+  BelaHostStats stats = _stats;
+  stats.meanRender = (_stats.blocks > 0) ? _totalRender / _stats.blocks : 0.0;
+  stats.blockDuration = _opt.frames / _opt.sampleRate;
+  stats.xruns = (_backend != NULL) ? _backend->getXruns() : 0;
+  return stats;
+}
+
+void BelaHost::printStats(){
+  BelaHostStats s = getStats();
+  printf("[BelaHost] %llu blocks (%.1f s): render mean %.2f us (%.1f%%), max %.2f us (%.1f%%), %u overruns, %u xruns\n",
+    (unsigned long long) s.blocks, s.blocks * s.blockDuration,
+    s.meanRender * 1e6, 100.0 * s.meanRender / s.blockDuration,
+    s.maxRender * 1e6, 100.0 * s.maxRender / s.blockDuration,
+    s.overruns, s.xruns);
+}
+
+// private methods
+
+void* BelaHost::audioThread(void* host){
+  ((BelaHost*) host)->audioLoop();
+  return NULL;
+}
+
+void BelaHost::audioLoop(){
+  double blockDuration = _opt.frames / _opt.sampleRate;
+  bool paced = _opt.realtime && !_backend->isPaced();
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  while (!Bela_stopRequested() && (_length == 0 || _context.audioFramesElapsed < _length)) {
+    if (!_backend->read(_audioIn.data(), _opt.frames)) break;
+    fillAnalog();
+    if (_clickInterval > 0) addClicks();
+
+    double start = now();
+    ::render(&_context, _userData);
+    double elapsed = now() - start;
+    _totalRender += elapsed;
+    if (elapsed > _stats.maxRender) _stats.maxRender = elapsed;
+    if (elapsed > blockDuration) ++_stats.overruns;
+    ++_stats.blocks;
+
+    if (!_backend->write(_audioOut.data(), _opt.frames)) break;
+    _context.audioFramesElapsed += _opt.frames;
+
+    if (paced) {
+      deadline.tv_nsec += (long) (blockDuration * 1e9);
+      while (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_nsec -= 1000000000L;
+        ++deadline.tv_sec;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+  }
+}
+
+void BelaHost::fillAnalog(){
+  if (_opt.analogInput.empty()) {
+    // Back to their value after a click
+    if (_analogClicked) for (unsigned int i = 0; i < _analogIn.size(); ++i) _analogIn[i] = _opt.analogValue;
+    _analogClicked = false;
+    return;
+  }
+  int channels = _analog.channels;
+  uint64_t length = _analog.samples.size() / channels;
+  for (unsigned int n = 0; n < _context.analogFrames; ++n) {
+    const float* frame = &_analog.samples[_analogPosition * channels];
+    for (int c = 0; c < _opt.analogChannels; ++c) _analogIn[n * _opt.analogChannels + c] = (c < channels) ? frame[c] : _opt.analogValue;
+    if (++_analogPosition == length) _analogPosition = 0;
+  }
+}
+
+// An impulse into every input on the first frame of each interval
+void BelaHost::addClicks(){
+  uint64_t elapsed = _context.audioFramesElapsed;
+  for (int n = 0; n < _opt.frames; ++n) {
+    if ((elapsed + n) % _clickInterval != 0) continue;
+    for (int c = 0; c < _opt.audioInChannels; ++c) _audioIn[n * _opt.audioInChannels + c] += 1.0f;
+    for (int c = 0; c < _opt.analogChannels; ++c) _analogIn[(n / 2) * _opt.analogChannels + c] = 1.0f;
+    _analogClicked = true;
+  }
+}
+
+static void onSignal(int) { Bela_requestStop(); }
+
+int main(int argc, char** argv) {
+  BelaHostOptions options;
+  if (!BelaHost::parse(argc, argv, options)) return 1;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  const char* name = strrchr(argv[0], '/');
+  BelaHost host;
+  bool ok = host.setup(options, name ? name + 1 : argv[0]);
+  if (ok) ok = host.run();
+  host.cleanup();
+  if (ok && options.v) host.printStats();
+  return ok ? 0 : 1;
+}
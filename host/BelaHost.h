@@ -0,0 +1,144 @@
+/*
+ * Resonators
+ * BelaHost
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef BelaHost_H_
+#define BelaHost_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Bela.h"
+
+// Runs a Bela program (its setup(), render() and cleanup()) on an ordinary
+// Linux machine, e.g. a render server, for load testing and profiling: link
+// it with BelaHost.cpp, which has main(), and run it from where its files
+// are found (for the examples, the repository root):
+//
+//   example8 --backend null --seconds 60 --clicks 4 // as fast as it goes
+//   example8 --backend null --realtime // paced as a Bela would be, until ^C
+//   example2 --backend file --input in.wav --output out.wav
+//   example7 --backend alsa --device hw:0 --analog sensors.wav
+//
+// render() runs on a thread of its own at BELA_AUDIO_PRIORITY (SCHED_FIFO)
+// where the system allows it, and auxiliary tasks on threads of theirs. Each
+// block's render time is measured; the program prints the mean and worst
+// block, as a share of the time the block lasts, when it stops.
+
+typedef struct _BelaHostOptions {
+    std::string backend = "null"; // "file", "null" or, if built with it, "alsa"
+    std::string input; // "file": audio inputs, a WAV file (silence without one)
+    std::string output; // "file": audio outputs, a WAV file (none without one)
+    std::string device = "default"; // "alsa": the PCM device
+    std::string analogInput; // analog inputs at the analog rate, a WAV file, looped
+    float analogValue = 0.0f; // every analog input, without a file
+    float sampleRate = 44100.0f;
+    int frames = 16; // per block
+    int audioInChannels = 2;
+    int audioOutChannels = 2;
+    int analogChannels = 8;
+    float seconds = 0.0f; // 0: the input file's length ("file", 10 s without one), or until ^C
+    bool realtime = false; // "file" and "null": pace blocks to the sample rate
+    float clicks = 0.0f; // impulses per second into every input, audio and analog
+    int priority = BELA_AUDIO_PRIORITY;
+    bool v = true; // verbose printing
+} BelaHostOptions;
+
+typedef struct _BelaHostStats {
+    uint64_t blocks;
+    double meanRender; // seconds per block
+    double maxRender;
+    double blockDuration; // seconds of audio per block
+    unsigned int overruns; // blocks that took longer to render than they last
+    unsigned int xruns; // device under- and overruns ("alsa")
+} BelaHostStats;
+
+// Where audio comes from and goes to; one block of interleaved frames at a time
+class BelaHostBackend {
+public:
+    virtual ~BelaHostBackend(){}
+    virtual bool open(BelaHostOptions &options) = 0; // may change the rate and channels
+    virtual bool read(float* audioIn, int frames) = 0; // false to stop
+    virtual bool write(const float* audioOut, int frames) = 0;
+    virtual void close(){}
+    virtual bool isPaced() { return false; } // true if reading and writing wait for the device
+    virtual uint64_t getLength() { return 0; } // frames of input, if known
+    virtual unsigned int getXruns() { return 0; }
+
+    // "file", "null" or "alsa"; NULL if unknown or not built
+    static BelaHostBackend* create(std::string const &name);
+};
+
+// A WAV file in memory, as interleaved floats
+typedef struct _BelaHostWav {
+    std::vector<float> samples;
+    int channels;
+    float sampleRate;
+} BelaHostWav;
+
+bool readWav(std::string const &path, BelaHostWav &wav);
+// Streams 32-bit float frames to a file; close() fills in the header
+class BelaHostWavWriter {
+public:
+    BelaHostWavWriter() : _file(NULL), _channels(0), _sampleRate(0.0f), _frames(0) {}
+    ~BelaHostWavWriter() { close(); }
+    bool open(std::string const &path, int channels, float sampleRate);
+    bool write(const float* frames, int length);
+    void close();
+private:
+    FILE* _file;
+    int _channels;
+    float _sampleRate;
+    uint64_t _frames;
+};
+
+class BelaHost {
+public:
+    BelaHost();
+    ~BelaHost();
+
+    // false, with usage printed, if the arguments are not understood
+    static bool parse(int argc, char** argv, BelaHostOptions &options);
+
+    // Opens the back end and calls the program's setup()
+    bool setup(BelaHostOptions options, const char* projectName, void* userData = NULL);
+    // Renders on the audio thread until the time is up, the input ends or
+    // Bela_requestStop() is called
+    bool run();
+    // Calls the program's cleanup(), then stops the auxiliary tasks
+    void cleanup();
+
+    BelaHostStats getStats();
+    void printStats();
+
+private:
+    BelaHostOptions _opt = {};
+    BelaHostBackend* _backend = NULL;
+    void* _userData = NULL;
+    bool _setup = false;
+
+    BelaContext _context;
+    std::vector<float> _audioIn, _audioOut, _analogIn, _analogOut;
+    BelaHostWav _analog;
+    uint64_t _analogPosition = 0;
+    bool _analogClicked = false;
+    uint64_t _length = 0; // frames to render, 0 until stopped
+    int _clickInterval = 0; // frames
+    BelaHostStats _stats;
+    double _totalRender = 0.0;
+
+    static void* audioThread(void* host);
+    void audioLoop();
+    void fillAnalog();
+    void addClicks();
+
+};
+
+#endif /* BelaHost_H_ */
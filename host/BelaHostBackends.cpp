@@ -0,0 +1,276 @@
+/*
+ * Resonators
+ * BelaHostBackends
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#include <string.h>
+
+#include "BelaHost.h"
+
+#ifdef RESONATORS_HOST_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+// WAV files
+
+static uint32_t readU32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); }
+static uint16_t readU16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+
+bool readWav(std::string const &path, BelaHostWav &wav){
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    printf("[BelaHost] readWav() Error: could not open '%s'\n", path.c_str());
+    return false;
+  }
+  std::vector<unsigned char> bytes;
+  unsigned char chunk[65536];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + read);
+  fclose(file);
+
+  if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) != 0 || memcmp(&bytes[8], "WAVE", 4) != 0) {
+    printf("[BelaHost] readWav() Error: '%s' is not a WAV file\n", path.c_str());
+    return false;
+  }
+  int format = 0, channels = 0, bits = 0;
+  const unsigned char* data = NULL;
+  size_t dataSize = 0;
+  for (size_t pos = 12; pos + 8 <= bytes.size(); ) {
+    const unsigned char* header = &bytes[pos];
+    size_t size = readU32(header + 4);
+    size_t available = bytes.size() - pos - 8;
+    if (size > available) size = available; // a truncated file, or a header never filled in
+    if (memcmp(header, "fmt ", 4) == 0 && size >= 16) {
+      format = readU16(header + 8);
+      channels = readU16(header + 10);
+      wav.sampleRate = (float) readU32(header + 12);
+      bits = readU16(header + 22);
+      if (format == 0xFFFE && size >= 26) format = readU16(header + 32); // WAVE_FORMAT_EXTENSIBLE
+    } else if (memcmp(header, "data", 4) == 0) {
+      data = header + 8;
+      dataSize = size;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  bool supported = (format == 1 && (bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32);
+  if (data == NULL || channels == 0 || !supported) {
+    printf("[BelaHost] readWav() Error: '%s' is not 16, 24 or 32-bit PCM or 32-bit float\n", path.c_str());
+    return false;
+  }
+
+  int width = bits / 8;
+  size_t samples = dataSize / width;
+  samples -= samples % channels;
+  wav.channels = channels;
+  wav.samples.resize(samples);
+  for (size_t i = 0; i < samples; ++i) {
+    const unsigned char* p = data + i * width;
+    float value;
+    if (format == 3) {
+      uint32_t u = readU32(p);
+      memcpy(&value, &u, sizeof(value));
+    } else if (bits == 16) {
+      value = (int16_t) readU16(p) / 32768.0f;
+    } else if (bits == 24) {
+      value = ((int32_t) ((p[0] << 8) | (p[1] << 16) | ((uint32_t) p[2] << 24)) >> 8) / 8388608.0f;
+    } else {
+      value = (int32_t) readU32(p) / 2147483648.0f;
+    }
+    wav.samples[i] = value;
+  }
+  return true;
+}
+
+static void writeU32(FILE* file, uint32_t v) { unsigned char b[4] = {(unsigned char) v, (unsigned char) (v >> 8), (unsigned char) (v >> 16), (unsigned char) (v >> 24)}; fwrite(b, 1, 4, file); }
+static void writeU16(FILE* file, uint16_t v) { unsigned char b[2] = {(unsigned char) v, (unsigned char) (v >> 8)}; fwrite(b, 1, 2, file); }
+
+static void writeWavHeader(FILE* file, int channels, float sampleRate, uint64_t frames) {
+  uint32_t dataSize = (uint32_t) (frames * channels * 4);
+  fwrite("RIFF", 1, 4, file);
+  writeU32(file, 36 + dataSize);
+  fwrite("WAVEfmt ", 1, 8, file);
+  writeU32(file, 16);
+  writeU16(file, 3); // IEEE float
+  writeU16(file, channels);
+  writeU32(file, (uint32_t) sampleRate);
+  writeU32(file, (uint32_t) sampleRate * channels * 4);
+  writeU16(file, channels * 4);
+  writeU16(file, 32);
+  fwrite("data", 1, 4, file);
+  writeU32(file, dataSize);
+}
+
+bool BelaHostWavWriter::open(std::string const &path, int channels, float sampleRate){
+  close();
+  _file = fopen(path.c_str(), "wb");
+  if (_file == NULL) {
+    printf("[BelaHost] BelaHostWavWriter::open() Error: could not create '%s'\n", path.c_str());
+    return false;
+  }
+  _channels = channels;
+  _sampleRate = sampleRate;
+  _frames = 0;
+  writeWavHeader(_file, channels, sampleRate, 0);
+  return true;
+}
+
+// Samples are little-endian floats, as the machines this runs on store them
+bool BelaHostWavWriter::write(const float* frames, int length){
+  if (_file == NULL) return false;
+  _frames += length;
+  return fwrite(frames, sizeof(float) * _channels, length, _file) == (size_t) length;
+}
+
+void BelaHostWavWriter::close(){
+  if (_file == NULL) return;
+  fseek(_file, 0, SEEK_SET);
+  writeWavHeader(_file, _channels, _sampleRate, _frames);
+  fclose(_file);
+  _file = NULL;
+}
+
+// "null": silence in, nothing out
+
+class BelaHostNullBackend : public BelaHostBackend {
+public:
+  bool open(BelaHostOptions &options) {
+    _channels = options.audioInChannels;
+    return true;
+  }
+  bool read(float* audioIn, int frames) {
+    memset(audioIn, 0, frames * _channels * sizeof(float));
+    return true;
+  }
+  bool write(const float* audioOut, int frames) { return true; }
+private:
+  int _channels = 0;
+};
+
+// "file": a WAV file in, silence once it ends, and a WAV file out
+
+class BelaHostFileBackend : public BelaHostBackend {
+public:
+  bool open(BelaHostOptions &options) {
+    _inChannels = options.audioInChannels;
+    _input.channels = 0;
+    if (!options.input.empty()) {
+      if (!readWav(options.input, _input)) return false;
+      if (_input.sampleRate != options.sampleRate) {
+        if (options.v) printf("[BelaHost] Running at %.0f Hz, the rate of '%s'\n", _input.sampleRate, options.input.c_str());
+        options.sampleRate = _input.sampleRate;
+      }
+    }
+    _position = 0;
+    if (!options.output.empty() && !_output.open(options.output, options.audioOutChannels, options.sampleRate)) return false;
+    return true;
+  }
+  // A mono file goes to every input
+  bool read(float* audioIn, int frames) {
+    int channels = _input.channels;
+    uint64_t length = getLength();
+    for (int n = 0; n < frames; ++n, ++_position) {
+      for (int c = 0; c < _inChannels; ++c) {
+        float value = 0.0f;
+        if (_position < length) {
+          if (c < channels) value = _input.samples[_position * channels + c];
+          else if (channels == 1) value = _input.samples[_position];
+        }
+        audioIn[n * _inChannels + c] = value;
+      }
+    }
+    return true;
+  }
+  bool write(const float* audioOut, int frames) {
+    _output.write(audioOut, frames);
+    return true;
+  }
+  void close() { _output.close(); }
+  uint64_t getLength() { return _input.channels ? _input.samples.size() / _input.channels : 0; }
+private:
+  BelaHostWav _input;
+  BelaHostWavWriter _output;
+  int _inChannels = 0;
+  uint64_t _position = 0;
+};
+
+#ifdef RESONATORS_HOST_ALSA
+
+// "alsa": a PCM device, which sets the pace; without a capture device the
+// inputs are silent
+
+class BelaHostAlsaBackend : public BelaHostBackend {
+public:
+  ~BelaHostAlsaBackend() { close(); }
+  bool open(BelaHostOptions &options) {
+    _inChannels = options.audioInChannels;
+    _outChannels = options.audioOutChannels;
+    unsigned int latency = (unsigned int) (4e6 * options.frames / options.sampleRate); // four blocks, in us
+    int error = snd_pcm_open(&_playback, options.device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (error >= 0) error = snd_pcm_set_params(_playback, SND_PCM_FORMAT_FLOAT, SND_PCM_ACCESS_RW_INTERLEAVED, _outChannels, (unsigned int) options.sampleRate, 1, latency);
+    if (error < 0) {
+      printf("[BelaHost] open() Error: could not play through '%s': %s\n", options.device.c_str(), snd_strerror(error));
+      return false;
+    }
+    if (_inChannels > 0) {
+      error = snd_pcm_open(&_capture, options.device.c_str(), SND_PCM_STREAM_CAPTURE, 0);
+      if (error >= 0) error = snd_pcm_set_params(_capture, SND_PCM_FORMAT_FLOAT, SND_PCM_ACCESS_RW_INTERLEAVED, _inChannels, (unsigned int) options.sampleRate, 1, latency);
+      if (error >= 0) error = snd_pcm_link(_capture, _playback);
+      if (error < 0) {
+        if (options.v) printf("[BelaHost] No inputs from '%s': %s\n", options.device.c_str(), snd_strerror(error));
+        if (_capture != NULL) snd_pcm_close(_capture);
+        _capture = NULL;
+      }
+    }
+    return true;
+  }
+  bool read(float* audioIn, int frames) {
+    if (_capture == NULL) {
+      memset(audioIn, 0, frames * _inChannels * sizeof(float));
+      return true;
+    }
+    snd_pcm_sframes_t read = snd_pcm_readi(_capture, audioIn, frames);
+    if (read < 0) {
+      ++_xruns;
+      if (snd_pcm_recover(_capture, read, 1) < 0) return false;
+      read = 0;
+    }
+    if (read < frames) memset(audioIn + read * _inChannels, 0, (frames - read) * _inChannels * sizeof(float));
+    return true;
+  }
+  bool write(const float* audioOut, int frames) {
+    snd_pcm_sframes_t written = snd_pcm_writei(_playback, audioOut, frames);
+    if (written < 0) {
+      ++_xruns;
+      return snd_pcm_recover(_playback, written, 1) >= 0;
+    }
+    return true;
+  }
+  void close() {
+    if (_capture != NULL) snd_pcm_close(_capture);
+    if (_playback != NULL) snd_pcm_close(_playback);
+    _capture = _playback = NULL;
+  }
+  bool isPaced() { return true; }
+  unsigned int getXruns() { return _xruns; }
+private:
+  snd_pcm_t* _playback = NULL;
+  snd_pcm_t* _capture = NULL;
+  int _inChannels = 0;
+  int _outChannels = 0;
+  unsigned int _xruns = 0;
+};
+
+#endif /* RESONATORS_HOST_ALSA */
+
+BelaHostBackend* BelaHostBackend::create(std::string const &name){
+  if (name == "file") return new BelaHostFileBackend();
+  if (name == "null") return new BelaHostNullBackend();
+#ifdef RESONATORS_HOST_ALSA
+  if (name == "alsa") return new BelaHostAlsaBackend();
+#endif
+  return NULL;
+}
@@ -0,0 +1,11 @@
+/*
+ * Resonators
+ * Scope (host)
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+// Where older Bela releases kept it
+#include "libraries/Scope/Scope.h"
@@ -0,0 +1,41 @@
+/*
+ * Resonators
+ * Gui (host)
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef Gui_H_
+#define Gui_H_
+
+#include <functional>
+#include <string>
+
+#include "JSON.h"
+
+// Bela's browser GUI, off-board: nothing connects, so buffers sent are
+// dropped and the control callback is only called through control(), e.g.
+// to replay messages in a test (see ../../Bela.h)
+class Gui {
+public:
+    Gui(){}
+    int setup(std::string const &projectName, unsigned int port = 5555, std::string const &address = "gui_data") { return 0; }
+    void setControlDataCallback(std::function<bool(JSONObject&, void*)> callback, void* customData = NULL) {
+      _callback = callback;
+      _customData = customData;
+    }
+    template<typename T> int sendBuffer(unsigned int bufferId, const T* buffer, unsigned int count) { return 0; }
+    template<typename T> int sendBuffer(unsigned int bufferId, T value) { return 0; }
+    bool isConnected() { return false; }
+
+    // Hands a control message to the callback, as if the browser had sent it
+    bool control(JSONObject &root) { return _callback ? _callback(root, _customData) : false; }
+
+private:
+    std::function<bool(JSONObject&, void*)> _callback;
+    void* _customData = NULL;
+};
+
+#endif /* Gui_H_ */
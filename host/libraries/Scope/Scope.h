@@ -0,0 +1,27 @@
+/*
+ * Resonators
+ * Scope (host)
+ * https://github.com/jarmitage/resonators
+ *
+ * Port of [resonators~] for Bela:
+ * https://github.com/CNMAT/CNMAT-Externs/blob/6f0208d3a1/src/resonators~/resonators~.c
+ */
+
+#ifndef Scope_H_
+#define Scope_H_
+
+// Bela's oscilloscope, off-board: there is no IDE to show it, so log()
+// only counts frames (see ../../Bela.h)
+class Scope {
+public:
+    Scope() : _channels(0), _frames(0) {}
+    void setup(unsigned int numChannels, float sampleRate) { _channels = numChannels; }
+    void log(float chn1, ...) { ++_frames; }
+    void log(const float* values) { ++_frames; }
+    unsigned int getFrames() { return _frames; }
+private:
+    unsigned int _channels;
+    unsigned int _frames;
+};
+
+#endif /* Scope_H_ */
@@ -3,6 +3,20 @@ import Bela from './Bela.js'
 export default class BelaResonators extends Bela {
 	constructor(ip='192.168.7.2') { super(ip) }
 
+	// Level meters published by ResonatorsTelemetry: calls back with the peak
+	// level per bank and the current amplitude of each bank's resonators
+	onTelemetry(callback) {
+		this.data.target.addEventListener('buffer-ready', (event) => {
+			if (event.detail != 1) return // levels arrive first, then amplitudes
+			let levels = this.data.buffers[0] || []
+			let amplitudes = this.data.buffers[1]
+			if (!levels.length) return
+			let perBank = amplitudes.length / levels.length
+			let banks = levels.map((level, i) => amplitudes.slice(i * perBank, (i + 1) * perBank))
+			callback({ levels: levels, amplitudes: banks })
+		})
+	}
+
 	setModel(index, model) {
 		if (this.isConnected()) {
 			this.control.send({ 
@@ -15,6 +29,21 @@ export default class BelaResonators extends Bela {
 		}
 	}
 
+	// Send only the resonators and fields that changed, e.g.
+	// setResonators(0, [{index: 3, gain: 0.2}, {index: 7, freq: 440, decay: 0.5}])
+	// Frequencies are as in the model, before transposition to the bank's pitch
+	setResonators(index, resonators) {
+		if (this.isConnected()) {
+			this.control.send({ 
+				command: 'updateResonators',
+				args: {
+					index: index,
+					resonators: resonators
+				}
+			})
+		}
+	}
+
 	setPitch(index, pitch) {
 		if (this.isConnected()) {
 			this.control.send({ 
@@ -1,9 +1,170 @@
 %module resonators
 %{
-#include "Model.h"
+#define SWIG_FILE_WITH_INIT
+#include <stdexcept>
+#include "Resonator.h"
+#include "ResonatorKernels.h"
+#include "ResonatorBank.h"
+#include "ModelLoader.h"
 #include "Resonators.h"
+#include "ResonatorBatch.h"
+#include <numpy/arrayobject.h>
+
+// Accept only C-contiguous float32 arrays so that rendering works on the
+// NumPy buffer directly; anything else raises rather than silently copying
+static PyArrayObject* resonators_float32Array(PyObject* obj, bool writable) {
+  if (!PyArray_Check(obj)) {
+    PyErr_SetString(PyExc_TypeError, "expected a numpy.ndarray");
+    return NULL;
+  }
+  PyArrayObject* array = (PyArrayObject*) obj;
+  if (PyArray_TYPE(array) != NPY_FLOAT32 || !PyArray_IS_C_CONTIGUOUS(array)) {
+    PyErr_SetString(PyExc_TypeError, "expected a C-contiguous numpy.float32 array");
+    return NULL;
+  }
+  if (writable && !PyArray_ISWRITEABLE(array)) {
+    PyErr_SetString(PyExc_ValueError, "expected a writeable array");
+    return NULL;
+  }
+  return array;
+}
 %}
+
+%init %{
+import_array();
+%}
+
+%include exception.i
 %include std_string.i
+%include std_wstring.i
+%include std_vector.i
 using std::string;
-%include "Model.h"
+
+%pythoncode %{
+import numpy
+%}
+
+// NumPy typemaps: one Python array maps to a (pointer, length) pair
+%typemap(in) (const float* NP_IN, int NP_LENGTH) {
+  PyArrayObject* array = resonators_float32Array($input, false);
+  if (!array) SWIG_fail;
+  $1 = (float*) PyArray_DATA(array);
+  $2 = (int) PyArray_SIZE(array);
+}
+%typemap(in) (float* NP_INOUT, int NP_LENGTH) {
+  PyArrayObject* array = resonators_float32Array($input, true);
+  if (!array) SWIG_fail;
+  $1 = (float*) PyArray_DATA(array);
+  $2 = (int) PyArray_SIZE(array);
+}
+%typemap(typecheck, precedence=SWIG_TYPECHECK_FLOAT_ARRAY) (const float* NP_IN, int NP_LENGTH), (float* NP_INOUT, int NP_LENGTH) {
+  $1 = PyArray_Check($input) ? 1 : 0;
+}
+
+%apply (const float* NP_IN, int NP_LENGTH) { (const float* in, int inFrames), (const float* values, int length) };
+%apply (float* NP_INOUT, int NP_LENGTH) { (float* out, int outFrames), (float* io, int frames), (float* values, int length) };
+
+%exception {
+  try { $action }
+  catch (const std::invalid_argument &e) { SWIG_exception(SWIG_ValueError, e.what()); }
+}
+
+// Pointer overloads are wrapped below with array lengths checked
+%ignore ResonatorBank::render(const float*, float*, int);
+%ignore Resonator::render(const float*, float*, int);
+%ignore ResonatorBank::render(ResonatorKernelMatrix const &, const float*, float*, int);
+%ignore ResonatorBatch::render;
+%ignore ResonatorBank::setResonators(const ResonatorParamDelta*, int);
+%ignore Resonators::setResonators(int, const ResonatorParamDelta*, int);
+// Only choosing and reporting the kernels is of use from Python
+%ignore _ResonatorKernelData;
+%ignore _ResonatorKernelMatrix;
+%ignore ResonatorKernels::render;
+%ignore ResonatorKernels::update;
+%ignore ResonatorKernels::renderLanes;
+%ignore ResonatorKernels::renderLookAhead;
+%ignore ResonatorKernels::renderMatrix;
+%ignore Resonators::setLanesOptions;
+%ignore Resonators::getLanes;
+%ignore ResonatorKernels::Variant;
+
+%include "ResonatorsTypes.h"
+%include "Resonator.h"
+%include "ResonatorKernels.h"
+%include "ResonatorBank.h"
+%include "ModelLoader.h"
 %include "Resonators.h"
+%include "ResonatorBatch.h"
+
+%template(ResonatorParamsVector) std::vector<ResonatorParams>;
+%template(FloatVector) std::vector<float>;
+%template(StringVector) std::vector<std::string>;
+%template(ResonatorParamDeltaVector) std::vector<ResonatorParamDelta>;
+%template(ResonatorCoefficientsVector) std::vector<ResonatorCoefficients>;
+
+%extend ResonatorBank {
+  // Render a block from `in` into a preallocated `out` of the same length
+  void renderBlock(const float* in, int inFrames, float* out, int outFrames) {
+    if (inFrames != outFrames) throw std::invalid_argument("input and output arrays must be the same length");
+    $self->render(in, out, inFrames);
+  }
+  // Render a block in place, replacing the excitation with the output
+  void renderInPlace(float* io, int frames) {
+    $self->render(io, io, frames);
+  }
+  %pythoncode %{
+    def getParamArray(self, paramIndex):
+        values = numpy.empty(self.getOptions().total, dtype=numpy.float32)
+        self.getParams(paramIndex, values)
+        return values
+
+    def setParamArray(self, paramIndex, values):
+        self.setParams(paramIndex, numpy.ascontiguousarray(values, dtype=numpy.float32))
+  %}
+}
+
+%extend ModelLoader {
+  %pythoncode %{
+    def getParamArray(self, paramIndex):
+        values = numpy.empty(self.getSize(), dtype=numpy.float32)
+        self.getParams(paramIndex, values)
+        return values
+
+    def setParamArray(self, paramIndex, values):
+        self.setParams(paramIndex, numpy.ascontiguousarray(values, dtype=numpy.float32))
+  %}
+}
+
+%extend ResonatorBatch {
+  // Render all jobs with the GIL released; `in` and `out` are (jobs, frames)
+  void renderBlocks(const float* in, int inFrames, float* out, int outFrames, int frames) {
+    if (inFrames != outFrames) throw std::invalid_argument("input and output arrays must be the same shape");
+    if (frames <= 0 || inFrames != $self->getSize() * frames) throw std::invalid_argument("arrays must hold `frames` samples per job");
+    Py_BEGIN_ALLOW_THREADS
+    $self->render(in, out, frames);
+    Py_END_ALLOW_THREADS
+  }
+}
+
+%pythoncode %{
+_batches = {} # (sampleRate, threads): an idle ResonatorBatch, kept for its worker threads
+
+def renderBatch(models, pitches, excitations, sampleRate=44100.0, threads=0):
+    """Render job i as models[i] at pitches[i] (note name or frequency) excited
+    by excitations[i], on `threads` native threads (0: one per core). Returns
+    a (jobs, frames) float32 array. Use itertools.product to build combinations."""
+    if not (len(models) == len(pitches) == len(excitations)):
+        raise ValueError('models, pitches and excitations must be the same length')
+    key = (float(sampleRate), int(threads))
+    batch = _batches.pop(key, None) # taken while in use, for callers on other threads
+    if batch is None:
+        batch = ResonatorBatch(sampleRate, threads)
+    batch.clear()
+    for model, pitch in zip(models, pitches):
+        batch.addJob(model, pitch)
+    inputs = numpy.ascontiguousarray(numpy.stack(excitations), dtype=numpy.float32)
+    outputs = numpy.empty_like(inputs)
+    batch.renderBlocks(inputs, outputs, inputs.shape[1])
+    _batches[key] = batch
+    return outputs
+%}
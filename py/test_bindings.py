@@ -1,4 +1,5 @@
 import argparse
+import numpy as np
 import resonators
 import traceback
 
@@ -14,6 +15,22 @@ def main(args):
         rb.setBank(model.getShiftedToNote("c4"))
         rb.update()
         out = rb.render(1.0)
+        block = np.zeros(128, dtype=np.float32)
+        block[0] = 1.0
+        out_block = np.empty_like(block)
+        rb.renderBlock(block, out_block)
+        rb.renderInPlace(block)
+        freqs = rb.getParamArray(0)
+        rb.setParamArray(0, freqs * 2)
+        assert len(freqs) == model.getSize()
+        batch = resonators.renderBatch([model, model], ["c4", "g4"], [block, block])
+        assert batch.shape == (2, len(block))
+        res = resonators.Resonators()
+        res.setup([args.model_path], ["c4"], 44100.0, 128)
+        delta = resonators.ResonatorParamDelta()
+        delta.index, delta.mask, delta.params.gain = 1, 1 << resonators.Resonator.kGain, 0.5
+        res.setResonators(0, resonators.ResonatorParamDeltaVector([delta]))
+        assert abs(res.getBank(0).getResonator(1).gain - 0.5) < 1e-6
     except Exception:
         print('Bindings not built correctly:')
         traceback.print_exc()
@@ -0,0 +1,106 @@
+/*
+ * Model:
+ * ModelConvert
+ * https://github.com/jarmitage/resonators
+ * 
+ * Converts JSON models to the binary `.resm` format (see cpp/ModelBinary.h):
+ *
+ *   modelconvert models/marimba.json models/marimba.resm [sampleRate ...]
+ *
+ * or packs every JSON model under a directory into one `.resl` library (see
+ * cpp/ModelLibrary.h), indexed by path relative to that directory:
+ *
+ *   modelconvert --pack models models.resl [sampleRate ...]
+ *
+ * Each sample rate given gets a set of baked coefficients.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "ModelLoader.h"
+#include "ModelLibrary.h"
+
+static bool loadModel(std::string const &path, ModelLoader &model) {
+  model.setVerbose(false);
+  return model.load(path) && model.getSize() > 0;
+}
+
+// The metadata count is what banks use, even if the array is longer
+static std::vector<ResonatorParams> getParams(ModelLoader &model) {
+  std::vector<ResonatorParams> params = model.getModel();
+  if ((int) params.size() > model.getSize()) params.resize(model.getSize());
+  return params;
+}
+
+// Collect .json files under `root` (relative to it), recursively
+static void findModels(std::string const &root, std::string const &dir, std::vector<std::string> &found) {
+  DIR* d = opendir((root + "/" + dir).c_str());
+  if (d == NULL) return;
+  struct dirent* e;
+  while ((e = readdir(d)) != NULL) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..") continue;
+    std::string rel = dir.empty() ? name : dir + "/" + name;
+    struct stat st;
+    if (stat((root + "/" + rel).c_str(), &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) findModels(root, rel, found);
+    else if (rel.size() > 5 && rel.compare(rel.size() - 5, 5, ".json") == 0) found.push_back(rel);
+  }
+  closedir(d);
+}
+
+static int pack(std::string const &root, std::string const &out, std::vector<float> const &sampleRates) {
+  std::vector<std::string> paths;
+  findModels(root, "", paths);
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<ModelLibraryItem> items;
+  for (unsigned int i = 0; i < paths.size(); ++i) {
+    ModelLoader model;
+    if (!loadModel(root + "/" + paths[i], model)) {
+      printf("[ModelConvert] Skipping \'%s\'\n", paths[i].c_str());
+      continue;
+    }
+    ModelLibraryItem item;
+    item.names.push_back(paths[i]);
+    item.model = ModelBinary::encode(model.getNameUTF8(), model.getFundamental(), getParams(model), sampleRates);
+    items.push_back(item);
+  }
+
+  if (!ModelLibrary::write(out, items)) return 1;
+  printf("[ModelConvert] Wrote \'%s\' (%d models, %d coefficient sets each)\n", out.c_str(), (int) items.size(), (int) sampleRates.size());
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  bool packing = argc > 1 && std::string(argv[1]) == "--pack";
+  int first = packing ? 2 : 1;
+  if (argc < first + 2) {
+    printf("usage: %s <model.json> <model.resm> [sampleRate ...]\n", argv[0]);
+    printf("       %s --pack <models dir> <library.resl> [sampleRate ...]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<float> sampleRates;
+  for (int i = first + 2; i < argc; ++i) {
+    float sampleRate = atof(argv[i]);
+    if (sampleRate <= 0) {
+      printf("[ModelConvert] Error: invalid sample rate \'%s\'\n", argv[i]);
+      return 1;
+    }
+    sampleRates.push_back(sampleRate);
+  }
+
+  if (packing) return pack(argv[first], argv[first + 1], sampleRates);
+
+  ModelLoader model;
+  if (!loadModel(argv[first], model)) return 1;
+  if (!ModelBinary::write(argv[first + 1], model.getNameUTF8(), model.getFundamental(), getParams(model), sampleRates)) return 1;
+
+  printf("[ModelConvert] Wrote \'%s\' (%d resonators, %d coefficient sets)\n", argv[first + 1], model.getSize(), (int) sampleRates.size());
+  return 0;
+}
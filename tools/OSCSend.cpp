@@ -0,0 +1,48 @@
+/*
+ * Resonators
+ * OSCSend
+ * https://github.com/jarmitage/resonators
+ *
+ * Sends one OSC message over UDP, e.g. to a Bela project listening with
+ * ResonatorsOSC (see cpp/ResonatorsOSC.h). Arguments are typed by prefix:
+ *
+ *   resonators-oscsend 192.168.7.2 7562 /resonators/gain i:0 f:0.5
+ *   resonators-oscsend 127.0.0.1 7562 /resonators/resonators i:0 i:3 i:1 f:0.2
+ *   resonators-oscsend 127.0.0.1 7562 /resonators/pitch i:1 s:g3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ResonatorsOSC.h"
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    printf("Usage: %s <host> <port> <address> [i:<int> | f:<float> | s:<string>] ...\n", argv[0]);
+    return 1;
+  }
+
+  OSCMessage message(argv[3]);
+  for (int i = 4; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strlen(arg) < 2 || arg[1] != ':') {
+      printf("[OSCSend] Error: argument \'%s\' needs a type prefix\n", arg);
+      return 1;
+    }
+    switch (arg[0]) {
+      case 'i': message.addInt(atoi(arg + 2)); break;
+      case 'f': message.addFloat(atof(arg + 2)); break;
+      case 's': message.addString(arg + 2); break;
+      default:
+        printf("[OSCSend] Error: unknown type \'%c\'\n", arg[0]);
+        return 1;
+    }
+  }
+
+  if (!ResonatorsOSC::send(argv[1], atoi(argv[2]), message)) {
+    printf("[OSCSend] Error: could not send to %s:%s\n", argv[1], argv[2]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Resonators
+ * test_osc
+ * https://github.com/jarmitage/resonators
+ *
+ * Sends OSC over loopback to a ResonatorsOSC listening on a free port, and
+ * checks the commands that come out of its ResonatorsCommandQueue, and that
+ * malformed packets are counted as errors. Run from the repository root:
+ *
+ *   test_osc [models/marimba.json]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "ResonatorsOSC.h"
+
+static const char* kHost = "127.0.0.1";
+static const int kTimeout = 2000; // ms
+
+static bool check(const char* name, bool ok) {
+  printf("%s %s\n", ok ? "[ OK ]" : "[FAIL]", name);
+  return ok;
+}
+
+// The receive thread is asynchronous, so poll
+static bool waitPop(ResonatorsCommandQueue &queue, ResonatorsCommand &cmd) {
+  for (int t = 0; t < kTimeout; ++t) {
+    if (queue.pop(cmd)) return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+static bool waitErrors(ResonatorsOSC &osc, unsigned int errors) {
+  for (int t = 0; t < kTimeout && osc.getErrors() < errors; ++t) usleep(1000);
+  return osc.getErrors() == errors;
+}
+
+static void appendWord(std::vector<char> &packet, uint32_t word) {
+  word = htonl(word);
+  packet.insert(packet.end(), (const char*) &word, (const char*) &word + 4);
+}
+
+// "#bundle", an immediate time tag, then each message with its size
+static std::vector<char> bundle(std::vector<OSCMessage*> const &messages) {
+  std::vector<char> packet(8, 0);
+  memcpy(packet.data(), "#bundle", 8);
+  appendWord(packet, 0);
+  appendWord(packet, 1);
+  for (unsigned int i = 0; i < messages.size(); ++i) {
+    appendWord(packet, messages[i]->size());
+    packet.insert(packet.end(), messages[i]->data(), messages[i]->data() + messages[i]->size());
+  }
+  return packet;
+}
+
+int main(int argc, char** argv) {
+  std::string modelPath = (argc > 1) ? argv[1] : "models/marimba.json";
+  bool ok = true;
+
+  std::vector<std::string> paths = {modelPath, modelPath};
+  std::vector<std::string> pitches = {"c4", "e4"};
+  Resonators res;
+  res.setup(paths, pitches, 44100.0f, 16);
+  ModelLoadServiceOptions loaderOpt;
+  loaderOpt.v = false;
+  ModelLoadService loader;
+  loader.setup(res.getTotalBanks(), 44100.0f, 16, loaderOpt);
+  ResonatorsCommandQueue commands;
+  commands.setup(64);
+
+  ResonatorsOSCOptions opt;
+  opt.port = 0;
+  opt.v = false;
+  ResonatorsOSC osc;
+  if (!check("listen on a free port", osc.setup(res, commands, loader, opt) && osc.getPort() > 0)) return 1;
+  int port = osc.getPort();
+  ResonatorsCommand cmd;
+
+  {
+    OSCMessage msg("/resonators/pitch");
+    msg.addInt(1).addString("g3");
+    bool got = ResonatorsOSC::send(kHost, port, msg) && waitPop(commands, cmd);
+    ok = check("pitch", got && cmd.type == ResonatorsCommand::kPitch && cmd.bank == 1 && strcmp(cmd.pitch, "g3") == 0) && ok;
+  }
+  {
+    OSCMessage msg("/resonators/gain");
+    msg.addFloat(0).addFloat(0.5f); // floats for integers, as many senders do
+    bool got = ResonatorsOSC::send(kHost, port, msg) && waitPop(commands, cmd);
+    ok = check("gain", got && cmd.type == ResonatorsCommand::kGain && cmd.bank == 0 && cmd.value == 0.5f) && ok;
+  }
+  {
+    OSCMessage msg("/resonators/note");
+    msg.addInt(0).addFloat(0.8f).addString("a4");
+    bool got = ResonatorsOSC::send(kHost, port, msg) && waitPop(commands, cmd);
+    ok = check("note", got && cmd.type == ResonatorsCommand::kNote && cmd.bank == 0 && cmd.value == 0.8f && strcmp(cmd.pitch, "a4") == 0) && ok;
+  }
+  {
+    // Ten resonators, with gain and decay of resonator 0 sharing a delta,
+    // are more than one command holds
+    OSCMessage msg("/resonators/resonators");
+    msg.addInt(1);
+    msg.addInt(0).addInt(Resonator::kGain).addFloat(0.25f);
+    msg.addInt(0).addInt(Resonator::kDecay).addFloat(0.75f);
+    for (int r = 1; r < 10; ++r) msg.addInt(r).addInt(Resonator::kFreq).addFloat(100.0f * r);
+    bool got = ResonatorsOSC::send(kHost, port, msg) && waitPop(commands, cmd);
+    bool first = got && cmd.type == ResonatorsCommand::kResonators && cmd.bank == 1 && cmd.length == ResonatorsCommand::kMaxDeltas
+      && cmd.deltas[0].index == 0 && cmd.deltas[0].mask == 6 && cmd.deltas[0].params.gain == 0.25f && cmd.deltas[0].params.decay == 0.75f
+      && cmd.deltas[7].index == 7 && cmd.deltas[7].mask == 1 && cmd.deltas[7].params.freq == 700.0f;
+    got = waitPop(commands, cmd);
+    bool second = got && cmd.type == ResonatorsCommand::kResonators && cmd.bank == 1 && cmd.length == 2
+      && cmd.deltas[0].index == 8 && cmd.deltas[1].index == 9 && cmd.deltas[1].params.freq == 900.0f;
+    ok = check("resonators, split over two commands", first && second) && ok;
+  }
+  {
+    OSCMessage gain("/resonators/gain");
+    gain.addInt(1).addFloat(0.1f);
+    OSCMessage note("/resonators/note");
+    note.addInt(1).addFloat(1.0f);
+    std::vector<char> packet = bundle({&gain, &note});
+    bool sent = ResonatorsOSC::send(kHost, port, packet.data(), packet.size());
+    bool first = sent && waitPop(commands, cmd) && cmd.type == ResonatorsCommand::kGain && cmd.value == 0.1f;
+    bool second = sent && waitPop(commands, cmd) && cmd.type == ResonatorsCommand::kNote && cmd.bank == 1 && cmd.pitch[0] == 0;
+    ok = check("bundle", first && second) && ok;
+  }
+  ok = check("no errors from valid messages", osc.getErrors() == 0 && osc.getReceived() == 6) && ok;
+
+  {
+    unsigned int errors = 0;
+    OSCMessage unknown("/resonators/unknown");
+    unknown.addInt(0);
+    ResonatorsOSC::send(kHost, port, unknown);
+    ok = check("malformed: unknown address", waitErrors(osc, ++errors)) && ok;
+
+    OSCMessage bank("/resonators/gain");
+    bank.addInt(2).addFloat(0.5f);
+    ResonatorsOSC::send(kHost, port, bank);
+    ok = check("malformed: bank out of range", waitErrors(osc, ++errors)) && ok;
+
+    OSCMessage nan("/resonators/gain");
+    nan.addFloat(NAN).addFloat(0.5f);
+    ResonatorsOSC::send(kHost, port, nan);
+    ok = check("malformed: bank NaN", waitErrors(osc, ++errors)) && ok;
+
+    OSCMessage huge("/resonators/gain");
+    huge.addFloat(1e10f).addFloat(0.5f);
+    ResonatorsOSC::send(kHost, port, huge);
+    ok = check("malformed: bank beyond int32", waitErrors(osc, ++errors)) && ok;
+
+    OSCMessage triples("/resonators/resonators");
+    triples.addInt(0).addInt(1).addInt(Resonator::kGain);
+    ResonatorsOSC::send(kHost, port, triples);
+    ok = check("malformed: incomplete triple", waitErrors(osc, ++errors)) && ok;
+
+    OSCMessage gain("/resonators/gain");
+    gain.addInt(0).addFloat(0.5f);
+    ResonatorsOSC::send(kHost, port, gain.data(), gain.size() - 4);
+    ok = check("malformed: truncated", waitErrors(osc, ++errors)) && ok;
+
+    const char types[] = "/resonators/gain\0\0\0\0,ib\0\0\0\0\0\0\0\0\0";
+    ResonatorsOSC::send(kHost, port, types, 32);
+    ok = check("malformed: unknown type tag", waitErrors(osc, ++errors)) && ok;
+
+    std::vector<char> packet = bundle({&gain});
+    packet[19] = 64; // an element larger than the bundle
+    ResonatorsOSC::send(kHost, port, packet.data(), packet.size());
+    ok = check("malformed: bundle element size", waitErrors(osc, ++errors)) && ok;
+
+    usleep(20000);
+    ok = check("nothing queued from malformed packets", !commands.pop(cmd)) && ok;
+  }
+
+  osc.cleanup();
+  loader.cleanup();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+/*
+ * Resonators
+ * test_rt_safety
+ * https://github.com/jarmitage/resonators
+ *
+ * Fails if the real-time paths allocate, free, lock or print: everything a render()
+ * callback calls is run inside an RTCheck::Scope (see cpp/RTCheck.h).
+ * Run from the repository root:
+ *
+ *   test_rt_safety [models/marimba.json]
+ */
+
+#define RESONATORS_RT_CHECK_HOOKS
+#include "RTCheck.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "Resonators.h"
+#include "ModelLoadService.h"
+#include "ResonatorsCoalescer.h"
+#include "ResonatorsScheduler.h"
+#include "ResonatorsAutomation.h"
+#include "ResonatorsModulation.h"
+#include "ResonatorsTelemetry.h"
+#include "ResonatorConvolver.h"
+#include "ResonatorMultirate.h"
+#include "ResonatorBankMIMO.h"
+
+static const int kFrames = 16;
+static const float kSampleRate = 44100.0f;
+
+static bool check(const char* name) {
+  unsigned int mallocs = RTCheck::getViolations(RTCheck::kMalloc);
+  unsigned int frees   = RTCheck::getViolations(RTCheck::kFree);
+  unsigned int locks   = RTCheck::getViolations(RTCheck::kLock);
+  unsigned int writes  = RTCheck::getViolations(RTCheck::kWrite);
+  RTCheck::reset();
+  bool ok = mallocs + frees + locks + writes == 0;
+  printf("%s %s (malloc: %u, free: %u, lock: %u, write: %u)\n", ok ? "[ OK ]" : "[FAIL]", name, mallocs, frees, locks, writes);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  std::string modelPath = (argc > 1) ? argv[1] : "models/marimba.json";
+  bool ok = true;
+
+  // The hooks have to see an allocation and a write, or the checks below prove
+  // nothing
+  {
+    void* (*volatile allocate)(size_t) = malloc;
+    ssize_t (*volatile output)(int, const void*, size_t) = write;
+    RTCheck::Scope rt;
+    free(allocate(16));
+    output(STDOUT_FILENO, "", 0);
+  }
+  if (RTCheck::getViolations() != 3) {
+    printf("[FAIL] hooks are not installed\n");
+    return 1;
+  }
+  RTCheck::reset();
+
+  // Setup may allocate
+  std::vector<std::string> paths = {modelPath, modelPath};
+  std::vector<std::string> pitches = {"c4", "e4"};
+  Resonators res;
+  res.setup(paths, pitches, kSampleRate, kFrames);
+
+  ModelLoadService loader;
+  loader.setup(res.getTotalBanks(), kSampleRate, kFrames);
+  ResonatorsCommandQueue commands;
+  commands.setup(64);
+  ResonatorsCoalescer coalescer;
+  coalescer.setup(res.getTotalBanks());
+  ResonatorsSchedulerOptions schedulerOpt;
+  schedulerOpt.v = false;
+  ResonatorsScheduler scheduler;
+  scheduler.setup(res, &loader, schedulerOpt);
+  ResonatorsAutomation automation;
+  automation.setup(res.getTotalBanks(), kSampleRate);
+  ResonatorsModulation modulation;
+  modulation.setup(res.getTotalBanks(), kSampleRate);
+  modulation.setLFO(0, ResonatorsModulation::kSine, 5.0f);
+  modulation.setEnvelope(1, 0.01f, 0.1f);
+  modulation.route(0, 1, Resonator::kFreq, 0.5f);
+  modulation.route(1, 1, Resonator::kDecay, 0.2f);
+  modulation.route(2, 1, Resonator::kGain, -6.0f);
+  float frameInputs[2 * kFrames] = {0}, frameOutputs[2 * kFrames];
+  ResonatorsTelemetry telemetry;
+  ResonatorsTelemetryOptions telemetryOpt;
+  telemetryOpt.rate = 1000.0f;
+  telemetry.setup(res.getTotalBanks(), kSampleRate, telemetryOpt);
+  telemetry.start([](int id, const float* data, int length) {});
+
+  ModelLoader model;
+  model.setVerbose(false);
+  model.load(modelPath);
+  model.reserve(40);
+  ResonatorBankOptions bankOpt = {};
+  bankOpt.v = false;
+  bankOpt.total = bankOpt.maxSize;
+  ResonatorBank bank;
+  bank.setup(bankOpt, kSampleRate, kFrames);
+  std::vector<ResonatorParams> shifted(bankOpt.maxSize);
+  std::vector<float> values(bankOpt.maxSize, 0.5f);
+  ResonatorConvolver convolver;
+  ResonatorConvolverOptions convolverOpt;
+  convolverOpt.partitionSize = kFrames;
+  convolverOpt.maxLength = 0.5f;
+  convolverOpt.pollInterval = 1;
+  convolverOpt.v = false;
+  convolver.setup(bank, kSampleRate, convolverOpt);
+  while (convolver.getBuilds() == 0) usleep(1000);
+  ResonatorMultirate multirate;
+  ResonatorMultirateOptions multirateOpt;
+  multirateOpt.v = false;
+  multirate.setup(bank, kSampleRate, kFrames, multirateOpt);
+  ResonatorBankMIMOOptions mimoOpt;
+  mimoOpt.v = false;
+  ResonatorBankMIMO mimo;
+  mimo.setup(mimoOpt, bankOpt, kSampleRate, kFrames);
+  mimo.getBank().setBank(model.getModel());
+  mimo.getBank().update();
+  float mimoInputs[2 * kFrames] = {0}, mimoOutputs[2 * kFrames];
+  Resonator single; // rendered a few samples at a time
+  single.setup(ResonatorOptions(), kSampleRate, kFrames);
+  single.initParams(440, 0.1, 0.5);
+
+  float inputs[2] = {0, 0}, outputs[2];
+  float block[kFrames] = {0};
+  block[1] = 1.0f;
+  res.render(inputs, outputs);
+  printf("\n");
+
+  // Rendering
+  {
+    RTCheck::Scope rt;
+    for (int n = 0; n < 4 * kFrames; ++n) {
+      inputs[0] = inputs[1] = (n == 1) ? 1.0f : 0.0f;
+      res.render(inputs, outputs);
+    }
+    bank.render(block, block, kFrames);
+    convolver.render(block, block, kFrames);
+    multirate.render(block, block, kFrames);
+    mimo.setInputPosition(1, 0.25f);
+    mimo.render(mimoInputs, mimoOutputs, kFrames);
+    telemetry.process(res, kFrames);
+  }
+  ok = check("render") && ok;
+
+  // Parameter changes through the command queue
+  ResonatorsCommand cmd = {};
+  cmd.bank = 0;
+  cmd.type = ResonatorsCommand::kResonators;
+  cmd.length = 2;
+  cmd.deltas[0].index = 0; cmd.deltas[0].mask = 1 << Resonator::kGain; cmd.deltas[0].params.gain = 0.3f;
+  cmd.deltas[1].index = 1; cmd.deltas[1].mask = 1 << Resonator::kFreq; cmd.deltas[1].params.freq = 900.0f;
+  commands.push(cmd);
+  cmd.type = ResonatorsCommand::kPitch; strcpy(cmd.pitch, "g4"); commands.push(cmd);
+  cmd.type = ResonatorsCommand::kGain;  cmd.value = 0.5f;        commands.push(cmd);
+  cmd.type = ResonatorsCommand::kNote;  cmd.value = 1.0f;        commands.push(cmd);
+  {
+    RTCheck::Scope rt;
+    coalescer.applyCommands(commands, res);
+    res.render(inputs, outputs);
+  }
+  ok = check("commands") && ok;
+
+  // The same, stamped with samples within the next block
+  uint64_t now = scheduler.getTime();
+  cmd.type = ResonatorsCommand::kResonators; cmd.time = now + 3; scheduler.schedule(cmd);
+  cmd.type = ResonatorsCommand::kGain;       cmd.time = now + 1; scheduler.schedule(cmd);
+  cmd.type = ResonatorsCommand::kNote;       cmd.time = now + 7; scheduler.schedule(cmd);
+  cmd.type = ResonatorsCommand::kImpulse;    cmd.time = now + 7; cmd.value = 0.05f; scheduler.schedule(cmd);
+  {
+    RTCheck::Scope rt;
+    scheduler.render(frameInputs, frameOutputs, kFrames);
+  }
+  ok = check("scheduled commands") && ok;
+
+  // Ramps, stepped by the audio thread until they finish
+  commands.push(ResonatorsAutomation::ramp(0, -1, Resonator::kFreq, 1.5f, 0.01f, ResonatorsCommand::kExponential));
+  commands.push(ResonatorsAutomation::ramp(0, 2, Resonator::kGain, 0.1f, 0.01f, ResonatorsCommand::kSmooth));
+  commands.push(ResonatorsAutomation::ramp(1, 0, Resonator::kDecay, 0.5f, 0.005f));
+  {
+    RTCheck::Scope rt;
+    automation.applyCommands(commands, res);
+    for (int n = 0; n < 64; ++n) {
+      automation.process(res, kFrames);
+      res.render(inputs, outputs);
+    }
+  }
+  ok = check("automation") && ok;
+
+  // Modulation, with sources changed from the audio thread too
+  {
+    RTCheck::Scope rt;
+    modulation.trigger(1);
+    for (int n = 0; n < 64; ++n) {
+      modulation.setValue(2, n / 64.0f);
+      modulation.process(res, kFrames);
+      res.render(inputs, outputs);
+    }
+  }
+  ok = check("modulation") && ok;
+  if (automation.getActive() != 0) {
+    printf("[FAIL] automation: %i ramps still running\n", automation.getActive());
+    ok = false;
+  }
+
+  // Updates and parameter sets
+  {
+    RTCheck::Scope rt;
+    int size = model.getShiftedToNote("d4", shifted.data(), shifted.size());
+    bank.setSize(size);
+    bank.setBank(shifted.data(), size);
+    bank.setParams(Resonator::kGain, values.data(), size);
+    bank.update();
+    bank.updateResonator(0);
+    bank.setBank(model.getModel());
+    model.setModel(shifted.data(), size, 293.66f);
+    res.setPitch(1, "a4");
+    res.render(inputs, outputs);
+    multirate.render(block, block, kFrames); // regroups the changed bank
+  }
+  ok = check("update") && ok;
+
+  // The same paths through every kernel this processor supports (see ResonatorKernels.h)
+  std::vector<std::string> isas = ResonatorKernels::getSupported();
+  for (unsigned int i = 0; i < isas.size(); ++i) {
+    ResonatorKernels::select(isas[i]);
+    {
+      RTCheck::Scope rt;
+      bank.update();
+      bank.render(block, block, kFrames);
+      single.render(block, block, kFrames);
+      mimo.render(mimoInputs, mimoOutputs, kFrames);
+      res.render(inputs, outputs);
+    }
+    ok = check(("kernels: " + isas[i]).c_str()) && ok;
+  }
+  ResonatorKernels::select("auto");
+
+  // A model loaded off the audio thread and swapped in, and the convolver
+  // crossfading to the response rebuilt after the updates above
+  loader.loadAsync(modelPath, 1, "c5");
+  bool applied = false;
+  for (int attempt = 0; attempt < 200 && !(applied && convolver.getBuilds() > 1); ++attempt) {
+    usleep(5000);
+    RTCheck::Scope rt;
+    if (!applied) applied = loader.apply(res) > 0;
+    convolver.render(block, block, kFrames);
+  }
+  {
+    RTCheck::Scope rt;
+    convolver.render(block, block, kFrames);
+  }
+  ok = check("model swap") && applied && ok;
+
+  telemetry.stop();
+  convolver.cleanup();
+  loader.cleanup();
+  printf("\n%s\n", ok ? "Real-time paths are allocation, lock and output free" : "Real-time paths allocate, lock or print");
+  return ok ? 0 : 1;
+}
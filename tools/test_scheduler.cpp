@@ -0,0 +1,92 @@
+/*
+ * Resonators
+ * test_scheduler
+ * https://github.com/jarmitage/resonators
+ *
+ * Schedules impulses and gains at stamps inside a block, in the past and
+ * alike, renders them through a ResonatorsScheduler, and checks the sample
+ * each bank starts to sound at. Run from the repository root:
+ *
+ *   test_scheduler [models/marimba.json]
+ */
+
+#include <stdio.h>
+
+#include "ResonatorsScheduler.h"
+#include "ResonatorsAutomation.h"
+
+static const int kFrames = 16;
+static const int kBlocks = 16;
+static const float kAmount = 0.05f; // Resonator::impulse() ignores 0.1 and over
+
+static bool check(const char* name, bool ok) {
+  printf("%s %s\n", ok ? "[ OK ]" : "[FAIL]", name);
+  return ok;
+}
+
+static ResonatorsCommand command(int type, int bank, float value, uint64_t time) {
+  ResonatorsCommand cmd = {};
+  cmd.type = type;
+  cmd.bank = bank;
+  cmd.value = value;
+  cmd.time = time;
+  return cmd;
+}
+
+// The first sample `bank` is not silent at, or -1
+static int firstSound(std::vector<float> const &outputs, int banks, int bank) {
+  for (int n = 0; n < (int) outputs.size() / banks; ++n)
+    if (outputs[n * banks + bank] != 0.0f) return n;
+  return -1;
+}
+
+int main(int argc, char** argv) {
+  std::string modelPath = (argc > 1) ? argv[1] : "models/marimba.json";
+  bool ok = true;
+
+  const int banks = 4;
+  std::vector<std::string> paths(banks, modelPath);
+  std::vector<std::string> pitches = {"c4", "e4", "g4", "c5"};
+  Resonators res;
+  res.setup(paths, pitches, 44100.0f, kFrames);
+  ResonatorsSchedulerOptions opt;
+  opt.v = false;
+  ResonatorsScheduler scheduler;
+  scheduler.setup(res, NULL, opt);
+
+  std::vector<float> inputs(kFrames * banks, 0.0f), outputs(kFrames * kBlocks * banks);
+
+  // Bank 0 halfway through the third block; bank 1 when the second block is
+  // rendered, stamped at a sample already gone. Banks 2 and 3 take an impulse
+  // and two gains at one stamp, in opposite orders, with a command stamped
+  // earlier scheduled among them: the last gain scheduled holds.
+  scheduler.schedule(command(ResonatorsCommand::kImpulse, 0, kAmount, 2 * kFrames + 7));
+  scheduler.schedule(command(ResonatorsCommand::kImpulse, 2, kAmount, 100));
+  scheduler.schedule(command(ResonatorsCommand::kImpulse, 3, kAmount, 100));
+  scheduler.schedule(command(ResonatorsCommand::kGain, 2, 0.0f, 100));
+  scheduler.schedule(command(ResonatorsCommand::kGain, 3, 1.0f, 100));
+  scheduler.schedule(command(ResonatorsCommand::kGain, 0, 1.0f, 50));
+  scheduler.schedule(command(ResonatorsCommand::kGain, 2, 1.0f, 100));
+  scheduler.schedule(command(ResonatorsCommand::kGain, 3, 0.0f, 100));
+
+  // A ramp is ResonatorsAutomation's to step: dropped, and bank 0's gain left as scheduled
+  scheduler.schedule(ResonatorsAutomation::ramp(0, -1, Resonator::kGain, 0.5f, 0.01f));
+
+  for (int b = 0; b < kBlocks; ++b) {
+    if (b == 1) scheduler.schedule(command(ResonatorsCommand::kImpulse, 1, kAmount, 3));
+    scheduler.render(inputs.data(), &outputs[b * kFrames * banks], kFrames);
+  }
+
+  ok = check("stamped inside a block: sounds at its sample", firstSound(outputs, banks, 0) == 2 * kFrames + 7) && ok;
+  ok = check("stamped in the past: sounds at the next block", firstSound(outputs, banks, 1) == kFrames) && ok;
+  ok = check("stamped alike: applied in the order scheduled", firstSound(outputs, banks, 2) == 100 && firstSound(outputs, banks, 3) == -1) && ok;
+  ok = check("gains left as last scheduled", res.getGain(2) == 1.0f && res.getGain(3) == 0.0f) && ok;
+
+  ResonatorsSchedulerStats stats = scheduler.getStats();
+  ok = check("every command applied, one late", stats.applied == 9 && stats.late == 1) && ok;
+  ok = check("ramp dropped", stats.dropped == 1 && res.getGain(0) == 1.0f) && ok;
+  ok = check("clock", scheduler.getTime() == (uint64_t) (kFrames * kBlocks)) && ok;
+
+  printf("\n%s\n", ok ? "Every command applied when it was due" : "A command was applied when it was not due");
+  return ok ? 0 : 1;
+}